@@ -27,6 +27,7 @@
 #include "render/color.h"
 #include "types/wlr_output.h"
 #include "util/env.h"
+#include "util/trace.h"
 #include "config.h"
 
 #if HAVE_LIBLIFTOFF
@@ -1989,6 +1990,8 @@ static void handle_page_flip(int fd, unsigned seq,
 		unsigned tv_sec, unsigned tv_usec, unsigned crtc_id, void *data) {
 	struct wlr_drm_page_flip *page_flip = data;
 
+	TRACE_INSTANT(TRACE_DRM_PAGE_FLIP, crtc_id);
+
 	struct wlr_drm_connector *conn = drm_page_flip_pop(page_flip, crtc_id);
 	if (conn != NULL) {
 		conn->pending_page_flip = NULL;
@@ -2,7 +2,6 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <wlr/interfaces/wlr_output.h>
-#include <wlr/types/wlr_output_layer.h>
 #include <wlr/util/log.h>
 #include "backend/headless.h"
 #include "types/wlr_output.h"
@@ -44,12 +43,6 @@ static bool output_test(struct wlr_output *wlr_output,
 		assert(state->mode_type == WLR_OUTPUT_STATE_MODE_CUSTOM);
 	}
 
-	if (state->committed & WLR_OUTPUT_STATE_LAYERS) {
-		for (size_t i = 0; i < state->layers_len; i++) {
-			state->layers[i].accepted = true;
-		}
-	}
-
 	return true;
 }
 
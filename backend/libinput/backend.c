@@ -7,6 +7,7 @@
 #include <wlr/util/log.h>
 #include "backend/libinput.h"
 #include "util/env.h"
+#include "util/trace.h"
 
 static struct wlr_libinput_backend *get_libinput_backend_from_backend(
 		struct wlr_backend *wlr_backend) {
@@ -54,11 +55,13 @@ static int handle_libinput_readable(int fd, uint32_t mask, void *_backend) {
 		wlr_backend_destroy(&backend->backend);
 		return 0;
 	}
+	TRACE_BEGIN(TRACE_INPUT_DISPATCH, 0);
 	struct libinput_event *event;
 	while ((event = libinput_get_event(backend->libinput_context))) {
 		handle_libinput_event(backend, event);
 		libinput_event_destroy(event);
 	}
+	TRACE_END(TRACE_INPUT_DISPATCH, 0);
 	return 0;
 }
 
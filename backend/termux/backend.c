@@ -3,6 +3,7 @@
 #include <string.h>
 #include <wlr/util/log.h>
 #include "backend/termux.h"
+#include "util/env.h"
 
 struct wlr_termux_backend *termux_backend_from_backend(struct wlr_backend *b) {
 	assert(wlr_backend_is_termux(b));
@@ -56,6 +57,7 @@ struct wlr_backend *wlr_termux_backend_create(struct wl_event_loop *loop, const
 	backend->backend.buffer_caps = WLR_BUFFER_CAP_DATA_PTR | WLR_BUFFER_CAP_SHM;
 	backend->event_loop = loop;
 	backend->socket_path = socket_path ? strdup(socket_path) : NULL;
+	backend->rgb565 = env_parse_bool("WLR_TERMUX_RGB565");
 	wl_list_init(&backend->outputs);
 	wl_signal_init(&backend->events_unicode);
 	backend->event_loop_destroy.notify = handle_event_loop_destroy;
@@ -7,6 +7,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include <wayland-server-protocol.h>
@@ -22,6 +23,7 @@
 
 #include "backend/termux.h"
 #include "util/time.h"
+#include "util/trace.h"
 #include <wlr/types/wlr_output.h>
 
 /* Match termux-display-client include/render.h eventType enum */
@@ -31,6 +33,14 @@
 #define LORIE_EVENT_KEY    8
 #define LORIE_EVENT_UNICODE 10
 
+/* Resize reconnect: the first attempt runs right after the input batch, failed
+ * ones are retried a few times before going back to the previous size */
+#define RESIZE_FIRST_DELAY_MS 1
+#define RESIZE_RETRY_DELAY_MS 16
+#define RESIZE_MAX_ATTEMPTS 8
+/* Interval between attempts to restore the previous size */
+#define RESIZE_RESTORE_DELAY_MS 1000
+
 /* Layout matches lorieEvent.touch / .mouse in render.h (no Android deps here) */
 typedef struct {
 	uint8_t t;
@@ -80,6 +90,35 @@ typedef struct {
  * check; we use 64-bit layout size (union has pointer in screenSize). */
 #define LORIE_EVENT_SIZE 32
 
+static_assert(sizeof(lorie_screen_size_ev) <= LORIE_EVENT_SIZE,
+	"lorie_screen_size_ev must fit in a lorieEvent");
+static_assert(TERMUX_INPUT_BUFFER_SIZE % LORIE_EVENT_SIZE == 0,
+	"input buffer must hold whole lorieEvents");
+
+/* Upper bound of touch ids with pending coalesced motion in one batch */
+#define TERMUX_TOUCH_MOTION_CAP 10
+
+/**
+ * Events dispatched for a single conn_fd wakeup. Motion is coalesced and only
+ * emitted before an event which depends on ordering (buttons, touch down/up,
+ * keys) or at the end of the batch, followed by a single frame per device.
+ */
+struct termux_input_batch {
+	uint32_t time_msec;
+	bool pointer_frame, touch_frame;
+
+	bool has_rel;
+	double rel_dx, rel_dy;
+	bool has_abs;
+	double abs_x, abs_y;
+
+	struct {
+		int32_t id;
+		double x, y;
+	} touch_motion[TERMUX_TOUCH_MOTION_CAP];
+	size_t n_touch_motion;
+};
+
 static const struct wlr_pointer_impl termux_pointer_impl = {
 	.name = "termux-pointer",
 };
@@ -110,113 +149,178 @@ static struct wlr_termux_output *termux_backend_first_output(struct wlr_termux_b
 	return NULL;
 }
 
-static void handle_lorie_mouse(struct wlr_termux_backend *backend,
-		const lorie_mouse_ev *ev) {
-	if (!backend->pointer) {
-		return;
-	}
-	struct wlr_pointer *pointer = &backend->pointer->wlr_pointer;
+static void output_normalize(struct wlr_termux_backend *backend,
+		double x, double y, double *nx, double *ny) {
 	struct wlr_termux_output *out = termux_backend_first_output(backend);
-	double nx = 0.5, ny = 0.5;
 	if (out && out->wlr_output.width > 0 && out->wlr_output.height > 0) {
-		nx = (double)ev->x / (double)out->wlr_output.width;
-		ny = (double)ev->y / (double)out->wlr_output.height;
-		if (nx < 0.0) nx = 0.0;
-		if (nx > 1.0) nx = 1.0;
-		if (ny < 0.0) ny = 0.0;
-		if (ny > 1.0) ny = 1.0;
+		*nx = x / (double)out->wlr_output.width;
+		*ny = y / (double)out->wlr_output.height;
+		if (*nx < 0.0) *nx = 0.0;
+		if (*nx > 1.0) *nx = 1.0;
+		if (*ny < 0.0) *ny = 0.0;
+		if (*ny > 1.0) *ny = 1.0;
 	}
-	uint32_t time_msec = (uint32_t)get_current_time_msec();
+}
 
-	if (ev->relative) {
+static void batch_flush_pointer_motion(struct wlr_termux_backend *backend,
+		struct termux_input_batch *batch) {
+	if (!backend->pointer) {
+		return;
+	}
+	struct wlr_pointer *pointer = &backend->pointer->wlr_pointer;
+	if (batch->has_rel) {
 		struct wlr_pointer_motion_event motion = {
 			.pointer = pointer,
-			.time_msec = time_msec,
-			.delta_x = (double)ev->x,
-			.delta_y = (double)ev->y,
-			.unaccel_dx = (double)ev->x,
-			.unaccel_dy = (double)ev->y,
+			.time_msec = batch->time_msec,
+			.delta_x = batch->rel_dx,
+			.delta_y = batch->rel_dy,
+			.unaccel_dx = batch->rel_dx,
+			.unaccel_dy = batch->rel_dy,
 		};
 		wl_signal_emit_mutable(&pointer->events.motion, &motion);
-	} else {
+		batch->has_rel = false;
+		batch->rel_dx = batch->rel_dy = 0.0;
+		batch->pointer_frame = true;
+	}
+	if (batch->has_abs) {
 		struct wlr_pointer_motion_absolute_event abs = {
 			.pointer = pointer,
-			.time_msec = time_msec,
-			.x = nx,
-			.y = ny,
+			.time_msec = batch->time_msec,
+			.x = batch->abs_x,
+			.y = batch->abs_y,
 		};
 		wl_signal_emit_mutable(&pointer->events.motion_absolute, &abs);
+		batch->has_abs = false;
+		batch->pointer_frame = true;
+	}
+}
+
+static void batch_flush_touch_motion(struct wlr_termux_backend *backend,
+		struct termux_input_batch *batch) {
+	if (!backend->touch) {
+		batch->n_touch_motion = 0;
+		return;
+	}
+	struct wlr_touch *touch = &backend->touch->wlr_touch;
+	for (size_t i = 0; i < batch->n_touch_motion; i++) {
+		struct wlr_touch_motion_event motion = {
+			.touch = touch,
+			.time_msec = batch->time_msec,
+			.touch_id = batch->touch_motion[i].id,
+			.x = batch->touch_motion[i].x,
+			.y = batch->touch_motion[i].y,
+		};
+		wl_signal_emit_mutable(&touch->events.motion, &motion);
+		batch->touch_frame = true;
+	}
+	batch->n_touch_motion = 0;
+}
+
+/** Emit coalesced motion, preserving ordering with the event about to be dispatched. */
+static void batch_flush_motion(struct wlr_termux_backend *backend,
+		struct termux_input_batch *batch) {
+	batch_flush_pointer_motion(backend, batch);
+	batch_flush_touch_motion(backend, batch);
+}
+
+static void handle_lorie_mouse(struct wlr_termux_backend *backend,
+		const lorie_mouse_ev *ev, struct termux_input_batch *batch) {
+	if (!backend->pointer) {
+		return;
+	}
+	struct wlr_pointer *pointer = &backend->pointer->wlr_pointer;
+
+	/* Consecutive moves collapse into one motion: relative deltas add up, the
+	 * last absolute position wins. */
+	if (ev->relative) {
+		if (batch->has_abs) {
+			batch_flush_pointer_motion(backend, batch);
+		}
+		batch->rel_dx += (double)ev->x;
+		batch->rel_dy += (double)ev->y;
+		batch->has_rel = true;
+	} else {
+		if (batch->has_rel) {
+			batch_flush_pointer_motion(backend, batch);
+		}
+		batch->abs_x = 0.5;
+		batch->abs_y = 0.5;
+		output_normalize(backend, ev->x, ev->y, &batch->abs_x, &batch->abs_y);
+		batch->has_abs = true;
 	}
 
 	if (ev->detail != 0) {
+		batch_flush_motion(backend, batch);
 		uint32_t button = lorie_button_to_linux(ev->detail);
 		enum wl_pointer_button_state state = ev->down ?
 			WL_POINTER_BUTTON_STATE_PRESSED : WL_POINTER_BUTTON_STATE_RELEASED;
 		struct wlr_pointer_button_event btn = {
 			.pointer = pointer,
-			.time_msec = time_msec,
+			.time_msec = batch->time_msec,
 			.button = button,
 			.state = state,
 		};
 		wlr_pointer_notify_button(pointer, &btn);
+		batch->pointer_frame = true;
 	}
-
-	wl_signal_emit_mutable(&pointer->events.frame, pointer);
 }
 
 static void handle_lorie_touch(struct wlr_termux_backend *backend,
-		const lorie_touch_ev *ev, uint32_t time_msec) {
+		const lorie_touch_ev *ev, struct termux_input_batch *batch) {
 	if (!backend->touch) {
 		return;
 	}
 	struct wlr_touch *touch = &backend->touch->wlr_touch;
-	struct wlr_termux_output *out = termux_backend_first_output(backend);
 	double nx = 0.0, ny = 0.0;
-	if (out && out->wlr_output.width > 0 && out->wlr_output.height > 0) {
-		nx = (double)ev->x / (double)out->wlr_output.width;
-		ny = (double)ev->y / (double)out->wlr_output.height;
-		if (nx < 0.0) nx = 0.0;
-		if (nx > 1.0) nx = 1.0;
-		if (ny < 0.0) ny = 0.0;
-		if (ny > 1.0) ny = 1.0;
-	}
+	output_normalize(backend, ev->x, ev->y, &nx, &ny);
 
 	switch (ev->type) {
 	case 0: { /* ACTION_DOWN */
+		batch_flush_motion(backend, batch);
 		struct wlr_touch_down_event down = {
 			.touch = touch,
-			.time_msec = time_msec,
+			.time_msec = batch->time_msec,
 			.touch_id = (int32_t)ev->id,
 			.x = nx,
 			.y = ny,
 		};
 		wl_signal_emit_mutable(&touch->events.down, &down);
+		batch->touch_frame = true;
 		break;
 	}
 	case 1: { /* ACTION_UP */
+		batch_flush_motion(backend, batch);
 		struct wlr_touch_up_event up = {
 			.touch = touch,
-			.time_msec = time_msec,
+			.time_msec = batch->time_msec,
 			.touch_id = (int32_t)ev->id,
 		};
 		wl_signal_emit_mutable(&touch->events.up, &up);
+		batch->touch_frame = true;
 		break;
 	}
-	case 2: { /* ACTION_MOVE */
-		struct wlr_touch_motion_event motion = {
-			.touch = touch,
-			.time_msec = time_msec,
-			.touch_id = (int32_t)ev->id,
-			.x = nx,
-			.y = ny,
-		};
-		wl_signal_emit_mutable(&touch->events.motion, &motion);
+	case 2: { /* ACTION_MOVE: only the last position per touch id is kept */
+		size_t i;
+		for (i = 0; i < batch->n_touch_motion; i++) {
+			if (batch->touch_motion[i].id == (int32_t)ev->id) {
+				break;
+			}
+		}
+		if (i == TERMUX_TOUCH_MOTION_CAP) {
+			batch_flush_touch_motion(backend, batch);
+			i = 0;
+		}
+		if (i == batch->n_touch_motion) {
+			batch->n_touch_motion++;
+		}
+		batch->touch_motion[i].id = (int32_t)ev->id;
+		batch->touch_motion[i].x = nx;
+		batch->touch_motion[i].y = ny;
 		break;
 	}
 	default:
 		break;
 	}
-	wl_signal_emit_mutable(&touch->events.frame, NULL);
 }
 
 static void handle_lorie_key(struct wlr_termux_backend *backend,
@@ -243,14 +347,57 @@ static void handle_lorie_unicode(struct wlr_termux_backend *backend,
 	wl_signal_emit_mutable(&backend->events_unicode, &codepoint);
 }
 
-/** Drain exactly size bytes from fd (e.g. optional name after EVENT_SCREEN_SIZE). */
-static void drain_fd(int fd, size_t size) {
-	char buf[256];
-	while (size > 0) {
-		ssize_t n = read(fd, buf, size < sizeof(buf) ? size : sizeof(buf));
-		if (n <= 0) break;
-		size -= (size_t)n;
+static int termux_input_readable(int fd, uint32_t mask, void *data);
+
+static bool input_attach_conn_fd(struct wlr_termux_backend *backend) {
+	int conn_fd = termux_render_get_conn_fd();
+	if (conn_fd < 0) {
+		wlr_log(WLR_DEBUG, "termux: no conn_fd for input");
+		return false;
 	}
+	backend->input_event = wl_event_loop_add_fd(backend->event_loop, conn_fd,
+		WL_EVENT_READABLE, termux_input_readable, backend);
+	if (!backend->input_event) {
+		wlr_log(WLR_ERROR, "termux: failed to add conn_fd to event loop");
+		return false;
+	}
+	return true;
+}
+
+static void input_detach_conn_fd(struct wlr_termux_backend *backend) {
+	if (backend->input_event) {
+		wl_event_source_remove(backend->input_event);
+		backend->input_event = NULL;
+	}
+	backend->input_buffer.len = 0;
+	backend->input_buffer.skip = 0;
+}
+
+static void resize_cancel(struct wlr_termux_backend *backend) {
+	if (backend->resize_pending.timer) {
+		wl_event_source_remove(backend->resize_pending.timer);
+		backend->resize_pending.timer = NULL;
+	}
+	backend->resize_pending.attempts = 0;
+	backend->resize_pending.restoring = false;
+}
+
+/**
+ * Replace the connection with one for the given size. The input devices stay
+ * alive, only the conn_fd event source is replaced.
+ */
+static bool resize_reconnect(struct wlr_termux_backend *backend,
+		int width, int height, int refresh) {
+	input_detach_conn_fd(backend);
+	termux_render_disconnect();
+	if (termux_render_connect(width, height, refresh) != 0) {
+		return false;
+	}
+	if (!input_attach_conn_fd(backend)) {
+		termux_render_disconnect();
+		return false;
+	}
+	return true;
 }
 
 static int resize_timer_handler(void *data) {
@@ -258,92 +405,211 @@ static int resize_timer_handler(void *data) {
 	int w = backend->resize_pending.width;
 	int h = backend->resize_pending.height;
 	int refresh = backend->resize_pending.framerate > 0 ? backend->resize_pending.framerate : 60;
+	struct wlr_termux_output *out = termux_backend_first_output(backend);
 
-	backend->resize_pending.timer = NULL;
-
-	termux_input_destroy(backend);
-	termux_render_disconnect();
-	sleep(1);
-	if (termux_render_connect(w, h, refresh) != 0) {
-		wlr_log(WLR_ERROR, "termux: resize reconnect failed");
+	if (!resize_reconnect(backend, w, h, refresh)) {
+		if (backend->resize_pending.restoring) {
+			wl_event_source_timer_update(backend->resize_pending.timer,
+				RESIZE_RESTORE_DELAY_MS);
+			return 0;
+		}
+		if (++backend->resize_pending.attempts < RESIZE_MAX_ATTEMPTS) {
+			wl_event_source_timer_update(backend->resize_pending.timer,
+				RESIZE_RETRY_DELAY_MS);
+			return 0;
+		}
+		/* The output still has the previous mode: go back to it */
+		if (out) {
+			wlr_log(WLR_ERROR, "termux: failed to resize to %dx%d, restoring %dx%d",
+				w, h, out->wlr_output.width, out->wlr_output.height);
+			backend->resize_pending.width = out->wlr_output.width;
+			backend->resize_pending.height = out->wlr_output.height;
+			backend->resize_pending.framerate = out->wlr_output.refresh;
+		}
+		backend->resize_pending.restoring = true;
+		wl_event_source_timer_update(backend->resize_pending.timer,
+			RESIZE_RETRY_DELAY_MS);
 		return 0;
 	}
+
 	int actual_w = 0, actual_h = 0;
 	termux_render_get_size(&actual_w, &actual_h);
 	if (actual_w > 0 && actual_h > 0) {
 		w = actual_w;
 		h = actual_h;
 	}
-	struct wlr_termux_output *out;
-	wl_list_for_each(out, &backend->outputs, link) {
-		struct wlr_output_state state;
-		wlr_output_state_init(&state);
-		wlr_output_state_set_custom_mode(&state, w, h, refresh);
-		wlr_output_commit_state(&out->wlr_output, &state);
-		wlr_output_state_finish(&state);
-		break;
+	resize_cancel(backend);
+	if (out && (out->wlr_output.width != w || out->wlr_output.height != h)) {
+		termux_output_update_mode(out, w, h, refresh);
+	} else if (out) {
+		/* The new shared buffer needs the whole frame again */
+		wlr_output_schedule_frame(&out->wlr_output);
 	}
-	termux_input_create_devices(backend);
 	wlr_log(WLR_INFO, "termux: resize done %dx%d@%d", w, h, refresh);
 	return 0;
 }
 
-static void schedule_resize_reinit(struct wlr_termux_backend *backend,
-		int width, int height, int framerate) {
-	if (backend->resize_pending.timer) {
-		wl_event_source_remove(backend->resize_pending.timer);
+/**
+ * Apply the last EVENT_SCREEN_SIZE of an input batch. libtermux-render only
+ * sets the shared buffer size when connecting, so unless it already matches,
+ * the connection is replaced from a timer, outside of the conn_fd callback.
+ */
+static void apply_pending_resize(struct wlr_termux_backend *backend) {
+	backend->resize_pending.pending = false;
+	int w = backend->resize_pending.width;
+	int h = backend->resize_pending.height;
+	int refresh = backend->resize_pending.framerate > 0 ? backend->resize_pending.framerate : 60;
+
+	int cur_w = 0, cur_h = 0;
+	termux_render_get_size(&cur_w, &cur_h);
+	if (cur_w == w && cur_h == h) {
+		resize_cancel(backend);
+		struct wlr_termux_output *out = termux_backend_first_output(backend);
+		if (out && (out->wlr_output.width != w || out->wlr_output.height != h)) {
+			termux_output_update_mode(out, w, h, refresh);
+		}
+		return;
 	}
-	backend->resize_pending.width = width;
-	backend->resize_pending.height = height;
-	backend->resize_pending.framerate = framerate;
-	backend->resize_pending.timer = wl_event_loop_add_timer(backend->event_loop,
-		resize_timer_handler, backend);
-	if (backend->resize_pending.timer) {
-		wl_event_source_timer_update(backend->resize_pending.timer, 1000);
+
+	if (!backend->resize_pending.timer) {
+		backend->resize_pending.timer = wl_event_loop_add_timer(backend->event_loop,
+			resize_timer_handler, backend);
+		if (!backend->resize_pending.timer) {
+			wlr_log(WLR_ERROR, "termux: failed to create resize timer");
+			return;
+		}
 	}
+	backend->resize_pending.attempts = 0;
+	backend->resize_pending.restoring = false;
+	wl_event_source_timer_update(backend->resize_pending.timer,
+		RESIZE_FIRST_DELAY_MS);
 }
 
-static int termux_input_readable(int fd, uint32_t mask, void *data) {
-	struct wlr_termux_backend *backend = data;
-	uint8_t buf[LORIE_EVENT_SIZE];
-	ssize_t n = read(fd, buf, sizeof(buf));
-	if (n < 0) {
-		if (errno == EAGAIN || errno == EWOULDBLOCK) {
-			return 0;
+static void dispatch_lorie_event(struct wlr_termux_backend *backend,
+		const uint8_t *data, struct termux_input_batch *batch) {
+	/* Events may sit at any offset once a screen size name has been skipped */
+	union {
+		uint8_t t;
+		lorie_mouse_ev mouse;
+		lorie_touch_ev touch;
+		lorie_key_ev key;
+		lorie_unicode_ev unicode;
+		lorie_screen_size_ev screen_size;
+		uint8_t bytes[LORIE_EVENT_SIZE];
+	} ev;
+	memcpy(ev.bytes, data, LORIE_EVENT_SIZE);
+
+	switch (ev.t) {
+	case LORIE_EVENT_MOUSE:
+		handle_lorie_mouse(backend, &ev.mouse, batch);
+		break;
+	case LORIE_EVENT_TOUCH:
+		handle_lorie_touch(backend, &ev.touch, batch);
+		break;
+	case LORIE_EVENT_KEY:
+		batch_flush_motion(backend, batch);
+		handle_lorie_key(backend, &ev.key);
+		break;
+	case LORIE_EVENT_UNICODE:
+		batch_flush_motion(backend, batch);
+		handle_lorie_unicode(backend, &ev.unicode);
+		break;
+	case LORIE_EVENT_SCREEN_SIZE:
+		if (ev.screen_size.width > 0 && ev.screen_size.height > 0) {
+			/* The optional name follows the event; discard it */
+			backend->input_buffer.skip = ev.screen_size.name_size;
+			/* Only the last size of a batch is applied */
+			backend->resize_pending.pending = true;
+			backend->resize_pending.width = ev.screen_size.width;
+			backend->resize_pending.height = ev.screen_size.height;
+			backend->resize_pending.framerate = ev.screen_size.framerate;
 		}
-		wlr_log(WLR_ERROR, "termux: read conn_fd: %s", strerror(errno));
-		return 0;
+		break;
+	default:
+		break;
 	}
-	if (n != LORIE_EVENT_SIZE) {
-		if (n > 0) {
-			wlr_log(WLR_DEBUG, "termux: expected %d bytes (one lorieEvent), got %zd", LORIE_EVENT_SIZE, (size_t)n);
+}
+
+/** Dispatch every complete lorieEvent in the input buffer, keeping a trailing partial event. */
+static void dispatch_input_buffer(struct wlr_termux_backend *backend,
+		struct termux_input_batch *batch) {
+	uint8_t *data = backend->input_buffer.data;
+	size_t len = backend->input_buffer.len;
+	size_t off = 0;
+	while (true) {
+		if (backend->input_buffer.skip > 0) {
+			size_t n = len - off;
+			if (n > backend->input_buffer.skip) {
+				n = backend->input_buffer.skip;
+			}
+			off += n;
+			backend->input_buffer.skip -= n;
+			if (backend->input_buffer.skip > 0) {
+				break;
+			}
 		}
-		return 0;
+		if (len - off < LORIE_EVENT_SIZE) {
+			break;
+		}
+		dispatch_lorie_event(backend, data + off, batch);
+		off += LORIE_EVENT_SIZE;
 	}
-	uint8_t type = buf[0];
-	uint32_t time_msec = (uint32_t)get_current_time_msec();
-
-	if (type == LORIE_EVENT_MOUSE) {
-		handle_lorie_mouse(backend, (const lorie_mouse_ev *)buf);
-	} else if (type == LORIE_EVENT_TOUCH) {
-		handle_lorie_touch(backend, (const lorie_touch_ev *)buf, time_msec);
-	} else if (type == LORIE_EVENT_KEY) {
-		handle_lorie_key(backend, (const lorie_key_ev *)buf);
-	} else if (type == LORIE_EVENT_UNICODE) {
-		handle_lorie_unicode(backend, (const lorie_unicode_ev *)buf);
-	} else if (type == LORIE_EVENT_SCREEN_SIZE) {
-		const lorie_screen_size_ev *ev = (const lorie_screen_size_ev *)buf;
-		if (ev->width > 0 && ev->height > 0) {
-			drain_fd(fd, ev->name_size);
-			schedule_resize_reinit(backend, (int)ev->width, (int)ev->height, (int)ev->framerate);
+	memmove(data, data + off, len - off);
+	backend->input_buffer.len = len - off;
+}
+
+static int termux_input_readable(int fd, uint32_t mask, void *data) {
+	struct wlr_termux_backend *backend = data;
+	struct termux_input_batch batch = {
+		.time_msec = (uint32_t)get_current_time_msec(),
+	};
+
+	TRACE_BEGIN(TRACE_INPUT_DISPATCH, 0);
+
+	/* Drain everything queued on conn_fd so that a burst of touch or mouse
+	 * moves is handled in a single wakeup and coalesced. FIONREAD keeps the
+	 * loop from blocking in case conn_fd is in blocking mode. */
+	while (true) {
+		size_t space = sizeof(backend->input_buffer.data) - backend->input_buffer.len;
+		ssize_t n = read(fd, backend->input_buffer.data + backend->input_buffer.len, space);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			if (errno != EAGAIN && errno != EWOULDBLOCK) {
+				wlr_log(WLR_ERROR, "termux: read conn_fd: %s", strerror(errno));
+			}
+			break;
+		}
+		if (n == 0) {
+			break;
+		}
+		backend->input_buffer.len += (size_t)n;
+		dispatch_input_buffer(backend, &batch);
+
+		int pending = 0;
+		if (ioctl(fd, FIONREAD, &pending) != 0 || pending <= 0) {
+			break;
 		}
 	}
+
+	batch_flush_motion(backend, &batch);
+	if (batch.pointer_frame && backend->pointer) {
+		wl_signal_emit_mutable(&backend->pointer->wlr_pointer.events.frame,
+			&backend->pointer->wlr_pointer);
+	}
+	if (batch.touch_frame && backend->touch) {
+		wl_signal_emit_mutable(&backend->touch->wlr_touch.events.frame, NULL);
+	}
+	if (backend->resize_pending.pending) {
+		apply_pending_resize(backend);
+	}
+	TRACE_END(TRACE_INPUT_DISPATCH, 0);
 	return 0;
 }
 
 void termux_input_create_devices(struct wlr_termux_backend *backend) {
-	int conn_fd = termux_render_get_conn_fd();
-	if (conn_fd < 0) {
+	if (termux_render_get_conn_fd() < 0) {
 		wlr_log(WLR_DEBUG, "termux: no conn_fd for input");
 		return;
 	}
@@ -400,10 +666,7 @@ void termux_input_create_devices(struct wlr_termux_backend *backend) {
 	wlr_keyboard_set_repeat_info(&backend->keyboard->wlr_keyboard, 25, 600);
 	wl_signal_emit_mutable(&backend->backend.events.new_input, &backend->keyboard->wlr_keyboard.base);
 
-	backend->input_event = wl_event_loop_add_fd(backend->event_loop, conn_fd,
-		WL_EVENT_READABLE, termux_input_readable, backend);
-	if (!backend->input_event) {
-		wlr_log(WLR_ERROR, "termux: failed to add conn_fd to event loop");
+	if (!input_attach_conn_fd(backend)) {
 		wlr_keyboard_finish(&backend->keyboard->wlr_keyboard);
 		free(backend->keyboard);
 		backend->keyboard = NULL;
@@ -421,14 +684,9 @@ void termux_input_create_devices(struct wlr_termux_backend *backend) {
 }
 
 void termux_input_destroy(struct wlr_termux_backend *backend) {
-	if (backend->resize_pending.timer) {
-		wl_event_source_remove(backend->resize_pending.timer);
-		backend->resize_pending.timer = NULL;
-	}
-	if (backend->input_event) {
-		wl_event_source_remove(backend->input_event);
-		backend->input_event = NULL;
-	}
+	resize_cancel(backend);
+	backend->resize_pending.pending = false;
+	input_detach_conn_fd(backend);
 	if (backend->keyboard) {
 		wlr_keyboard_finish(&backend->keyboard->wlr_keyboard);
 		free(backend->keyboard);
@@ -1,18 +1,23 @@
 /*
  * Termux output: on commit, copy wlr_buffer to shared buffer via libtermux-render.
  * Frame events use Wayland-native automatic refresh (wlr_output_schedule_frame).
+ * The cursor is a separate plane in the shared server state, so cursor moves
+ * need neither a render nor a frame push.
  */
 #include <assert.h>
+#include <drm_fourcc.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <wlr/interfaces/wlr_output.h>
+#include <wlr/render/drm_format_set.h>
 #include <wlr/util/log.h>
 #include "backend/termux.h"
 #include "types/wlr_output.h"
 
 static const uint32_t SUPPORTED_OUTPUT_STATE =
+	WLR_OUTPUT_STATE_BACKEND_OPTIONAL |
 	WLR_OUTPUT_STATE_BUFFER |
 	WLR_OUTPUT_STATE_ENABLED |
 	WLR_OUTPUT_STATE_MODE;
@@ -37,12 +42,14 @@ static bool copy_buffer_to_lorie(struct wlr_termux_output *output, const struct
 		return true;
 	}
 	struct wlr_buffer *buf = state->buffer;
+	const pixman_region32_t *damage =
+		(state->committed & WLR_OUTPUT_STATE_DAMAGE) ? &state->damage : NULL;
 	void *data = NULL;
 	uint32_t format = 0;
 	size_t stride = 0;
 	bool ok = false;
 	if (wlr_buffer_begin_data_ptr_access(buf, WLR_BUFFER_DATA_PTR_ACCESS_READ, &data, &format, &stride)) {
-		ok = termux_render_push_frame(data, stride) == 0;
+		ok = termux_render_push_frame(data, format, stride, buf->width, buf->height, damage) == 0;
 		wlr_buffer_end_data_ptr_access(buf);
 	} else {
 		struct wlr_shm_attributes shm;
@@ -51,7 +58,9 @@ static bool copy_buffer_to_lorie(struct wlr_termux_output *output, const struct
 				* (size_t)shm.height;
 			void *ptr = mmap(NULL, s, PROT_READ, MAP_SHARED, shm.fd, shm.offset);
 			if (ptr != MAP_FAILED) {
-				ok = termux_render_push_frame(ptr, (size_t)(shm.stride > 0 ? shm.stride : buf->width * 4)) == 0;
+				ok = termux_render_push_frame(ptr, shm.format,
+					(size_t)(shm.stride > 0 ? shm.stride : buf->width * 4),
+					buf->width, buf->height, damage) == 0;
 				munmap(ptr, s);
 			}
 		}
@@ -81,16 +90,54 @@ static bool output_commit(struct wlr_output *wlr_output, const struct wlr_output
 	return true;
 }
 
+void termux_output_update_mode(struct wlr_termux_output *output,
+		int width, int height, int refresh) {
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_custom_mode(&state, width, height, refresh);
+	if (!wlr_output_commit_state(&output->wlr_output, &state)) {
+		wlr_log(WLR_ERROR, "termux: failed to set mode %dx%d", width, height);
+	}
+	wlr_output_state_finish(&state);
+	/* The compositor reallocates its swapchain on the next frame */
+	wlr_output_schedule_frame(&output->wlr_output);
+}
+
 static bool output_set_cursor(struct wlr_output *wlr_output, struct wlr_buffer *buffer, int hx, int hy) {
-	return true;
+	if (!termux_render_connected()) {
+		return false;
+	}
+	if (!buffer) {
+		return termux_render_set_cursor(NULL, 0, 0, 0, 0, 0) == 0;
+	}
+	void *data = NULL;
+	uint32_t format = 0;
+	size_t stride = 0;
+	if (!wlr_buffer_begin_data_ptr_access(buffer, WLR_BUFFER_DATA_PTR_ACCESS_READ,
+			&data, &format, &stride)) {
+		return false;
+	}
+	/* Anything the display client cannot draw falls back to software cursors */
+	bool ok = format == DRM_FORMAT_ARGB8888 &&
+		termux_render_set_cursor(data, stride, buffer->width, buffer->height, hx, hy) == 0;
+	wlr_buffer_end_data_ptr_access(buffer);
+	return ok;
 }
+
 static bool output_move_cursor(struct wlr_output *wlr_output, int x, int y) {
-	return true;
+	return termux_render_move_cursor(x, y) == 0;
+}
+
+static const struct wlr_drm_format_set *output_get_primary_formats(
+		struct wlr_output *wlr_output, uint32_t buffer_caps) {
+	struct wlr_termux_output *output = termux_output_from_output(wlr_output);
+	return &output->primary_formats;
 }
 
 static void output_destroy(struct wlr_output *wlr_output) {
 	struct wlr_termux_output *output = termux_output_from_output(wlr_output);
 	wlr_output_finish(wlr_output);
+	wlr_drm_format_set_finish(&output->primary_formats);
 	wl_list_remove(&output->link);
 	termux_render_disconnect();
 	free(output);
@@ -102,8 +149,14 @@ static const struct wlr_output_impl output_impl = {
 	.commit = output_commit,
 	.set_cursor = output_set_cursor,
 	.move_cursor = output_move_cursor,
+	.get_primary_formats = output_get_primary_formats,
 };
 
+static void output_add_primary_format(struct wlr_termux_output *output, uint32_t format) {
+	wlr_drm_format_set_add(&output->primary_formats, format, DRM_FORMAT_MOD_INVALID);
+	wlr_drm_format_set_add(&output->primary_formats, format, DRM_FORMAT_MOD_LINEAR);
+}
+
 bool wlr_output_is_termux(struct wlr_output *wlr_output) {
 	return wlr_output->impl == &output_impl;
 }
@@ -117,9 +170,19 @@ struct wlr_output *wlr_termux_add_output(struct wlr_backend *backend,
 		return NULL;
 	}
 	output->backend = termux;
+	/* Formats the display client can take. With RGB565 the renderer draws
+	 * 16-bit frames directly, halving the bytes pushed per frame when the
+	 * display client shares an R5G6B5 buffer. */
+	if (termux->rgb565) {
+		output_add_primary_format(output, DRM_FORMAT_RGB565);
+	} else {
+		output_add_primary_format(output, DRM_FORMAT_XRGB8888);
+		output_add_primary_format(output, DRM_FORMAT_ARGB8888);
+	}
 	/* Tell libtermux-render desired size (setScreenConfig); client creates buffer to match. */
 	if (termux_render_connect((int)width, (int)height, (int)refresh_mhz) != 0) {
 		wlr_log(WLR_ERROR, "termux: failed to connect to display server");
+		wlr_drm_format_set_finish(&output->primary_formats);
 		free(output);
 		return NULL;
 	}
@@ -5,11 +5,55 @@
 #include "backend/termux.h"
 #include <termux/render/render.h>
 #include <termux/render/buffer.h>
+#include <drm_fourcc.h>
 #include <stdlib.h>
 #include <string.h>
+#include <wlr/util/box.h>
 #include <wlr/util/log.h>
+#include "render/pixel_format.h"
+#include "render/pixman.h"
+
+/* LorieBuffer_Desc.format value for AHARDWAREBUFFER_FORMAT_R5G6B5_UNORM */
+#define LORIE_FORMAT_R5G6B5 4
 
 static bool connected;
+/* Whether the shared buffer content is stale and must be fully rewritten */
+static bool full_damage = true;
+
+/* Last cursor sent to the display client, sent again on a new connection */
+static struct {
+	uint32_t *bits; /* width * height ARGB8888 pixels, NULL if hidden */
+	int width, height;
+	int xhot, yhot;
+	int x, y;
+	bool set;
+} cursor;
+
+static void cursor_upload(struct lorie_shared_server_state *state, bool image,
+		bool position) {
+	lorie_mutex_lock(&state->lock, &state->lockingPid);
+	if (image) {
+		if (cursor.bits) {
+			memcpy(state->cursor.bits, cursor.bits,
+				(size_t)cursor.width * cursor.height * 4);
+			state->cursor.width = cursor.width;
+			state->cursor.height = cursor.height;
+			state->cursor.xhot = cursor.xhot;
+			state->cursor.yhot = cursor.yhot;
+		} else {
+			state->cursor.width = 0;
+			state->cursor.height = 0;
+		}
+		state->cursor.updated = 1;
+	}
+	if (position) {
+		state->cursor.x = cursor.x;
+		state->cursor.y = cursor.y;
+		state->cursor.moved = 1;
+	}
+	pthread_cond_signal(&state->cond);
+	lorie_mutex_unlock(&state->lock, &state->lockingPid);
+}
 
 static void on_render_stop(void) {
 	connected = false;
@@ -30,6 +74,11 @@ int termux_render_connect(int width, int height, int refresh) {
 		return -1;
 	}
 	connected = true;
+	full_damage = true;
+	struct lorie_shared_server_state *state = get_serverState();
+	if (cursor.set && state) {
+		cursor_upload(state, true, true);
+	}
 	return 0;
 }
 
@@ -61,12 +110,52 @@ void termux_render_get_size(int *width, int *height) {
 	if (height) *height = desc->height;
 }
 
-int termux_render_push_frame(const void *data, size_t stride_bytes) {
+uint32_t termux_render_get_format(void) {
+	LorieBuffer *buf = get_lorieBuffer();
+	if (!buf) {
+		return DRM_FORMAT_INVALID;
+	}
+	const LorieBuffer_Desc *desc = LorieBuffer_description(buf);
+	return desc->format == LORIE_FORMAT_R5G6B5 ? DRM_FORMAT_RGB565 : DRM_FORMAT_XRGB8888;
+}
+
+static bool copy_region_converted(void *dst, uint32_t dst_format, size_t dst_stride,
+		const void *src, uint32_t src_format, size_t src_stride,
+		int width, int height, const struct wlr_box *box) {
+	pixman_format_code_t dst_fmt = get_pixman_format_from_drm(dst_format);
+	pixman_format_code_t src_fmt = get_pixman_format_from_drm(src_format);
+	if (dst_fmt == 0 || src_fmt == 0) {
+		return false;
+	}
+	pixman_image_t *dst_image = pixman_image_create_bits_no_clear(dst_fmt,
+		width, height, dst, dst_stride);
+	pixman_image_t *src_image = pixman_image_create_bits_no_clear(src_fmt,
+		width, height, (void *)src, src_stride);
+	bool ok = dst_image && src_image;
+	if (ok) {
+		pixman_image_composite32(PIXMAN_OP_SRC, src_image, NULL, dst_image,
+			box->x, box->y, 0, 0, box->x, box->y, box->width, box->height);
+	}
+	if (src_image) {
+		pixman_image_unref(src_image);
+	}
+	if (dst_image) {
+		pixman_image_unref(dst_image);
+	}
+	return ok;
+}
+
+int termux_render_push_frame(const void *data, uint32_t format, size_t stride_bytes,
+		int width, int height, const pixman_region32_t *damage) {
 	LorieBuffer *buf = get_lorieBuffer();
 	struct lorie_shared_server_state *state = get_serverState();
 	if (!connected || !buf || !state || !data) {
 		return -1;
 	}
+	const struct wlr_pixel_format_info *src_info = drm_get_pixel_format_info(format);
+	if (!src_info) {
+		return -1;
+	}
 	lorie_mutex_lock(&state->lock, &state->lockingPid);
 	void *shared_buffer = NULL;
 	if (LorieBuffer_lock(buf, &shared_buffer) != 0) {
@@ -74,24 +163,106 @@ int termux_render_push_frame(const void *data, size_t stride_bytes) {
 		return -1;
 	}
 	const LorieBuffer_Desc *desc = LorieBuffer_description(buf);
-	int w = desc->width;
-	int h = desc->height;
-	int stride = desc->stride > 0 ? desc->stride : w;
-	size_t row_src = stride_bytes > 0 ? stride_bytes : (size_t)w * 4;
-	size_t row_dst = (size_t)stride * 4;
-	if (row_src == row_dst && (size_t)stride * h * 4 <= row_dst * (size_t)h) {
-		memcpy(shared_buffer, data, (size_t)stride * h * 4);
-	} else {
-		for (int y = 0; y < h; y++) {
-			memcpy((uint8_t *)shared_buffer + y * row_dst,
-				(const uint8_t *)data + y * row_src,
-				(size_t)w * 4);
+	uint32_t dst_format = termux_render_get_format();
+	const struct wlr_pixel_format_info *dst_info = drm_get_pixel_format_info(dst_format);
+	size_t dst_bpp = dst_info->bytes_per_block;
+
+	/* Source and shared buffer sizes differ while a resize is in flight */
+	int w = desc->width < width ? desc->width : width;
+	int h = desc->height < height ? desc->height : height;
+	int stride = desc->stride > 0 ? desc->stride : desc->width;
+	size_t row_src = stride_bytes > 0 ? stride_bytes : (size_t)width * src_info->bytes_per_block;
+	size_t row_dst = (size_t)stride * dst_bpp;
+
+	/* The shared buffer holds the previous frame: only the damaged area needs
+	 * to be copied, unless its content is stale. */
+	struct wlr_box box = { .width = w, .height = h };
+	if (damage && !full_damage) {
+		const pixman_box32_t *ext = pixman_region32_extents(damage);
+		struct wlr_box damage_box = {
+			.x = ext->x1,
+			.y = ext->y1,
+			.width = ext->x2 - ext->x1,
+			.height = ext->y2 - ext->y1,
+		};
+		if (!wlr_box_intersection(&box, &box, &damage_box)) {
+			box = (struct wlr_box){0};
 		}
 	}
+
+	bool ok = true;
+	if (wlr_box_empty(&box)) {
+		// Nothing to copy
+	} else if (format == dst_format || src_info->opaque_substitute == dst_format ||
+			dst_info->opaque_substitute == format) {
+		/* Same layout, at most differing in alpha vs padding (e.g. ARGB and
+		 * XRGB): a plain copy will do */
+		if (row_src == row_dst && box.x == 0 && box.width == desc->width) {
+			memcpy((uint8_t *)shared_buffer + box.y * row_dst,
+				(const uint8_t *)data + box.y * row_src,
+				row_dst * (size_t)box.height);
+		} else {
+			for (int y = box.y; y < box.y + box.height; y++) {
+				memcpy((uint8_t *)shared_buffer + y * row_dst + box.x * dst_bpp,
+					(const uint8_t *)data + y * row_src + box.x * dst_bpp,
+					(size_t)box.width * dst_bpp);
+			}
+		}
+	} else {
+		ok = copy_region_converted(shared_buffer, dst_format, row_dst,
+			data, format, row_src, w, h, &box);
+	}
+	if (ok) {
+		full_damage = false;
+	}
 	state->waitForNextFrame = 0;
 	state->drawRequested = 1;
 	pthread_cond_signal(&state->cond);
 	lorie_mutex_unlock(&state->lock, &state->lockingPid);
 	LorieBuffer_unlock(buf);
+	return ok ? 0 : -1;
+}
+
+int termux_render_set_cursor(const void *data, size_t stride_bytes,
+		int width, int height, int hotspot_x, int hotspot_y) {
+	struct lorie_shared_server_state *state = get_serverState();
+	if (!connected || !state) {
+		return -1;
+	}
+	size_t max_pixels = sizeof(state->cursor.bits) / sizeof(state->cursor.bits[0]);
+	if (data && (size_t)width * (size_t)height > max_pixels) {
+		return -1;
+	}
+	free(cursor.bits);
+	cursor.bits = NULL;
+	if (data) {
+		cursor.bits = malloc((size_t)width * height * 4);
+		if (!cursor.bits) {
+			return -1;
+		}
+		for (int y = 0; y < height; y++) {
+			memcpy(&cursor.bits[y * width],
+				(const uint8_t *)data + y * stride_bytes,
+				(size_t)width * 4);
+		}
+		cursor.width = width;
+		cursor.height = height;
+		cursor.xhot = hotspot_x;
+		cursor.yhot = hotspot_y;
+	}
+	cursor.set = true;
+	cursor_upload(state, true, false);
+	return 0;
+}
+
+int termux_render_move_cursor(int x, int y) {
+	struct lorie_shared_server_state *state = get_serverState();
+	if (!connected || !state) {
+		return -1;
+	}
+	cursor.x = x;
+	cursor.y = y;
+	cursor.set = true;
+	cursor_upload(state, false, true);
 	return 0;
 }
@@ -0,0 +1,119 @@
+#include <drm_fourcc.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <wlr/backend.h>
+#include <wlr/backend/headless.h>
+#include <wlr/render/allocator.h>
+#include <wlr/render/drm_format_set.h>
+#include <wlr/render/pixman.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/util/log.h>
+#include "bench.h"
+
+// Each benchmark runs for at least this long
+#define BENCH_MIN_DURATION_NS (200 * 1000 * 1000)
+
+static int64_t get_time_ns(void) {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void bench_run(const char *name, bench_func_t func, void *data) {
+	// Warm up caches and allocator
+	func(data);
+
+	uint64_t iterations = 0;
+	uint64_t batch = 1;
+	int64_t start = get_time_ns();
+	int64_t elapsed;
+	while (true) {
+		for (uint64_t i = 0; i < batch; i++) {
+			func(data);
+		}
+		iterations += batch;
+
+		elapsed = get_time_ns() - start;
+		if (elapsed >= BENCH_MIN_DURATION_NS) {
+			break;
+		}
+		if (batch < (1 << 20)) {
+			batch *= 2;
+		}
+	}
+
+	printf("{\"name\": \"%s\", \"iterations\": %" PRIu64 ", \"ns_per_iter\": %.1f}\n",
+		name, iterations, (double)elapsed / iterations);
+	fflush(stdout);
+}
+
+static volatile uintptr_t sink;
+
+void bench_consume(const void *ptr) {
+	sink ^= (uintptr_t)ptr;
+}
+
+void bench_headless_init(struct bench_headless *headless) {
+	wlr_log_init(WLR_ERROR, NULL);
+
+	*headless = (struct bench_headless){0};
+	headless->loop = wl_event_loop_create();
+	if (headless->loop == NULL) {
+		abort();
+	}
+	headless->backend = wlr_headless_backend_create(headless->loop);
+	if (headless->backend == NULL) {
+		abort();
+	}
+	headless->renderer = wlr_pixman_renderer_create();
+	if (headless->renderer == NULL) {
+		abort();
+	}
+	headless->allocator = wlr_allocator_autocreate(headless->backend,
+		headless->renderer);
+	if (headless->allocator == NULL || !wlr_backend_start(headless->backend)) {
+		abort();
+	}
+}
+
+void bench_headless_finish(struct bench_headless *headless) {
+	wlr_allocator_destroy(headless->allocator);
+	wlr_renderer_destroy(headless->renderer);
+	wlr_backend_destroy(headless->backend);
+	wl_event_loop_destroy(headless->loop);
+}
+
+struct wlr_buffer *bench_headless_create_buffer(struct bench_headless *headless,
+		int width, int height, uint32_t format) {
+	struct wlr_drm_format_set formats = {0};
+	if (!wlr_drm_format_set_add(&formats, format, DRM_FORMAT_MOD_LINEAR)) {
+		abort();
+	}
+	struct wlr_buffer *buffer = wlr_allocator_create_buffer(headless->allocator,
+		width, height, wlr_drm_format_set_get(&formats, format));
+	wlr_drm_format_set_finish(&formats);
+	if (buffer == NULL) {
+		abort();
+	}
+
+	void *data;
+	uint32_t data_format;
+	size_t stride;
+	if (!wlr_buffer_begin_data_ptr_access(buffer,
+			WLR_BUFFER_DATA_PTR_ACCESS_WRITE, &data, &data_format, &stride)) {
+		abort();
+	}
+	for (int y = 0; y < height; y++) {
+		uint32_t *row = (uint32_t *)((char *)data + y * stride);
+		for (int x = 0; x < width; x++) {
+			row[x] = 0xFF000000 | (uint32_t)(x * 0x010203 + y * 0x030201);
+		}
+	}
+	wlr_buffer_end_data_ptr_access(buffer);
+
+	return buffer;
+}
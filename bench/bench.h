@@ -0,0 +1,44 @@
+#ifndef BENCH_BENCH_H
+#define BENCH_BENCH_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef void (*bench_func_t)(void *data);
+
+/**
+ * Run a benchmark function repeatedly for a fixed amount of time and print
+ * the result on stdout, as a single JSON object per line:
+ *
+ *   {"name": "...", "iterations": 1234, "ns_per_iter": 56.7}
+ */
+void bench_run(const char *name, bench_func_t func, void *data);
+
+/**
+ * Prevent the compiler from optimizing away a computed value.
+ */
+void bench_consume(const void *ptr);
+
+/**
+ * A headless backend with the pixman renderer and a shared memory allocator,
+ * to benchmark rendering without a GPU. Aborts on failure.
+ */
+struct bench_headless {
+	struct wl_event_loop *loop;
+	struct wlr_backend *backend;
+	struct wlr_renderer *renderer;
+	struct wlr_allocator *allocator;
+};
+
+void bench_headless_init(struct bench_headless *headless);
+
+void bench_headless_finish(struct bench_headless *headless);
+
+/**
+ * Allocate a buffer filled with an opaque pattern. The format must have 32 bits
+ * per pixel.
+ */
+struct wlr_buffer *bench_headless_create_buffer(struct bench_headless *headless,
+	int width, int height, uint32_t format);
+
+#endif
@@ -0,0 +1,74 @@
+#include <stdlib.h>
+#include <wlr/interfaces/wlr_buffer.h>
+#include <wlr/types/wlr_damage_ring.h>
+#include <wlr/util/box.h>
+#include "bench.h"
+
+/*
+ * An output with a swapchain of three buffers, where a few small surfaces
+ * (a cursor, a blinking caret, a progress bar) are damaged every frame.
+ */
+
+#define BUFFERS_LEN 3
+#define WIDTH 2560
+#define HEIGHT 1440
+
+struct bench_data {
+	struct wlr_damage_ring ring;
+	struct wlr_buffer buffers[BUFFERS_LEN];
+	size_t frame;
+	int boxes_per_frame;
+};
+
+static void buffer_destroy(struct wlr_buffer *buffer) {
+	// Buffers are embedded in struct bench_data, nothing to free
+	wlr_buffer_finish(buffer);
+}
+
+static const struct wlr_buffer_impl buffer_impl = {
+	.destroy = buffer_destroy,
+};
+
+static void bench_rotate(void *_data) {
+	struct bench_data *data = _data;
+	size_t frame = data->frame++;
+
+	for (int i = 0; i < data->boxes_per_frame; i++) {
+		struct wlr_box box = {
+			.x = (int)((frame * 37 + i * 211) % (WIDTH - 64)),
+			.y = (int)((frame * 23 + i * 139) % (HEIGHT - 64)),
+			.width = 16 + i % 48,
+			.height = 16 + i % 32,
+		};
+		wlr_damage_ring_add_box(&data->ring, &box);
+	}
+
+	pixman_region32_t damage;
+	pixman_region32_init(&damage);
+	wlr_damage_ring_rotate_buffer(&data->ring,
+		&data->buffers[frame % BUFFERS_LEN], &damage);
+	bench_consume(pixman_region32_rectangles(&damage, NULL));
+	pixman_region32_fini(&damage);
+}
+
+static void run(const char *name, int boxes_per_frame) {
+	struct bench_data data = { .boxes_per_frame = boxes_per_frame };
+	wlr_damage_ring_init(&data.ring);
+	for (size_t i = 0; i < BUFFERS_LEN; i++) {
+		wlr_buffer_init(&data.buffers[i], &buffer_impl, WIDTH, HEIGHT);
+	}
+
+	bench_run(name, bench_rotate, &data);
+
+	wlr_damage_ring_finish(&data.ring);
+	for (size_t i = 0; i < BUFFERS_LEN; i++) {
+		wlr_buffer_drop(&data.buffers[i]);
+	}
+}
+
+int main(void) {
+	run("damage_ring_rotate_1", 1);
+	run("damage_ring_rotate_8", 8);
+	run("damage_ring_rotate_32", 32);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,154 @@
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wlr/render/drm_format_set.h>
+#include "bench.h"
+
+/*
+ * Format lists resembling what a Vulkan renderer and a DRM primary plane
+ * advertise on a recent discrete GPU: many formats, each with a dozen
+ * vendor-specific tiling modifiers on top of LINEAR and INVALID.
+ */
+
+static const uint32_t render_formats[] = {
+	DRM_FORMAT_ARGB8888, DRM_FORMAT_XRGB8888, DRM_FORMAT_ABGR8888,
+	DRM_FORMAT_XBGR8888, DRM_FORMAT_RGBA8888, DRM_FORMAT_RGBX8888,
+	DRM_FORMAT_BGRA8888, DRM_FORMAT_BGRX8888, DRM_FORMAT_ARGB2101010,
+	DRM_FORMAT_XRGB2101010, DRM_FORMAT_ABGR2101010, DRM_FORMAT_XBGR2101010,
+	DRM_FORMAT_ABGR16161616F, DRM_FORMAT_XBGR16161616F,
+	DRM_FORMAT_ABGR16161616, DRM_FORMAT_XBGR16161616, DRM_FORMAT_RGB565,
+	DRM_FORMAT_BGR565, DRM_FORMAT_ARGB4444, DRM_FORMAT_XRGB4444,
+	DRM_FORMAT_ARGB1555, DRM_FORMAT_XRGB1555, DRM_FORMAT_R8, DRM_FORMAT_GR88,
+	DRM_FORMAT_R16, DRM_FORMAT_GR1616, DRM_FORMAT_RGB888, DRM_FORMAT_BGR888,
+	DRM_FORMAT_NV12, DRM_FORMAT_NV21, DRM_FORMAT_P010, DRM_FORMAT_P012,
+	DRM_FORMAT_P016, DRM_FORMAT_YUV420, DRM_FORMAT_YVU420, DRM_FORMAT_YUYV,
+	DRM_FORMAT_UYVY, DRM_FORMAT_NV16, DRM_FORMAT_YUV444, DRM_FORMAT_AYUV,
+};
+
+static const uint32_t plane_formats[] = {
+	DRM_FORMAT_XRGB8888, DRM_FORMAT_ARGB8888, DRM_FORMAT_XBGR8888,
+	DRM_FORMAT_ABGR8888, DRM_FORMAT_XRGB2101010, DRM_FORMAT_ARGB2101010,
+	DRM_FORMAT_XBGR2101010, DRM_FORMAT_ABGR2101010, DRM_FORMAT_RGB565,
+	DRM_FORMAT_XBGR16161616F, DRM_FORMAT_ABGR16161616F, DRM_FORMAT_NV12,
+	DRM_FORMAT_P010,
+};
+
+#define RENDER_VENDOR_MODIFIERS 16
+#define PLANE_VENDOR_MODIFIERS 6
+
+struct bench_data {
+	struct wlr_drm_format_set render;
+	struct wlr_drm_format_set plane;
+};
+
+static uint64_t vendor_modifier(size_t i) {
+	// AMD-style modifiers: a tiling version with varying block layouts
+	return fourcc_mod_code(AMD, (i << 13) | (i % 4) | 0x100);
+}
+
+struct format_pair {
+	uint32_t format;
+	uint64_t modifier;
+};
+
+/**
+ * Build a format set by adding format/modifier pairs in random order, as
+ * drivers don't report them sorted.
+ */
+static void build_set(struct wlr_drm_format_set *set, const uint32_t *formats,
+		size_t formats_len, size_t vendor_modifiers) {
+	size_t modifiers_len = vendor_modifiers + 2;
+	size_t len = formats_len * modifiers_len;
+	struct format_pair *pairs = calloc(len, sizeof(*pairs));
+	if (pairs == NULL) {
+		abort();
+	}
+
+	size_t n = 0;
+	for (size_t i = 0; i < formats_len; i++) {
+		pairs[n++] = (struct format_pair){ formats[i], DRM_FORMAT_MOD_LINEAR };
+		pairs[n++] = (struct format_pair){ formats[i], DRM_FORMAT_MOD_INVALID };
+		for (size_t j = 0; j < vendor_modifiers; j++) {
+			pairs[n++] = (struct format_pair){ formats[i], vendor_modifier(j) };
+		}
+	}
+
+	for (size_t i = len - 1; i > 0; i--) {
+		size_t j = (size_t)rand() % (i + 1);
+		struct format_pair tmp = pairs[i];
+		pairs[i] = pairs[j];
+		pairs[j] = tmp;
+	}
+
+	for (size_t i = 0; i < len; i++) {
+		if (!wlr_drm_format_set_add(set, pairs[i].format, pairs[i].modifier)) {
+			abort();
+		}
+	}
+
+	free(pairs);
+}
+
+static void bench_build(void *data) {
+	struct wlr_drm_format_set set = {0};
+	build_set(&set, render_formats,
+		sizeof(render_formats) / sizeof(render_formats[0]),
+		RENDER_VENDOR_MODIFIERS);
+	bench_consume(set.formats);
+	wlr_drm_format_set_finish(&set);
+}
+
+static void bench_has(void *_data) {
+	struct bench_data *data = _data;
+	size_t found = 0;
+	for (size_t i = 0; i < sizeof(plane_formats) / sizeof(plane_formats[0]); i++) {
+		for (size_t j = 0; j < PLANE_VENDOR_MODIFIERS; j++) {
+			found += wlr_drm_format_set_has(&data->render,
+				plane_formats[i], vendor_modifier(j));
+		}
+		found += wlr_drm_format_set_has(&data->render,
+			plane_formats[i], DRM_FORMAT_MOD_INVALID);
+	}
+	bench_consume((void *)found);
+}
+
+static void bench_intersect(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_drm_format_set out = {0};
+	if (!wlr_drm_format_set_intersect(&out, &data->plane, &data->render)) {
+		abort();
+	}
+	bench_consume(out.formats);
+	wlr_drm_format_set_finish(&out);
+}
+
+static void bench_union(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_drm_format_set out = {0};
+	if (!wlr_drm_format_set_union(&out, &data->plane, &data->render)) {
+		abort();
+	}
+	bench_consume(out.formats);
+	wlr_drm_format_set_finish(&out);
+}
+
+int main(void) {
+	srand(42);
+
+	struct bench_data data = {0};
+	build_set(&data.render, render_formats,
+		sizeof(render_formats) / sizeof(render_formats[0]),
+		RENDER_VENDOR_MODIFIERS);
+	build_set(&data.plane, plane_formats,
+		sizeof(plane_formats) / sizeof(plane_formats[0]),
+		PLANE_VENDOR_MODIFIERS);
+
+	bench_run("drm_format_set_build", bench_build, &data);
+	bench_run("drm_format_set_has", bench_has, &data);
+	bench_run("drm_format_set_intersect", bench_intersect, &data);
+	bench_run("drm_format_set_union", bench_union, &data);
+
+	wlr_drm_format_set_finish(&data.render);
+	wlr_drm_format_set_finish(&data.plane);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,65 @@
+#include <stdlib.h>
+#include <wlr/interfaces/wlr_keyboard.h>
+#include <wlr/types/wlr_keyboard.h>
+#include <xkbcommon/xkbcommon.h>
+#include "bench.h"
+
+/*
+ * Setting up a keyboard when it's plugged in: compiling the keymap from
+ * RMLVO names, and handing it to wlroots, which serializes it for clients.
+ */
+
+static const struct xkb_rule_names rule_names = {
+	.layout = "us,de",
+	.options = "grp:alt_shift_toggle",
+};
+
+struct bench_data {
+	struct xkb_context *context;
+	struct xkb_keymap *keymap;
+	struct wlr_keyboard keyboard;
+};
+
+static const struct wlr_keyboard_impl keyboard_impl = {
+	.name = "bench-keyboard",
+};
+
+static void bench_compile(void *_data) {
+	struct bench_data *data = _data;
+	struct xkb_keymap *keymap = xkb_keymap_new_from_names(data->context,
+		&rule_names, XKB_KEYMAP_COMPILE_NO_FLAGS);
+	if (keymap == NULL) {
+		abort();
+	}
+	bench_consume(keymap);
+	xkb_keymap_unref(keymap);
+}
+
+static void bench_set_keymap(void *_data) {
+	struct bench_data *data = _data;
+	if (!wlr_keyboard_set_keymap(&data->keyboard, data->keymap)) {
+		abort();
+	}
+}
+
+int main(void) {
+	struct bench_data data = {0};
+	data.context = xkb_context_new(XKB_CONTEXT_NO_FLAGS);
+	if (data.context == NULL) {
+		abort();
+	}
+	data.keymap = xkb_keymap_new_from_names(data.context, &rule_names,
+		XKB_KEYMAP_COMPILE_NO_FLAGS);
+	if (data.keymap == NULL) {
+		abort();
+	}
+	wlr_keyboard_init(&data.keyboard, &keyboard_impl, "bench-keyboard");
+
+	bench_run("keymap_compile", bench_compile, &data);
+	bench_run("keymap_set", bench_set_keymap, &data);
+
+	wlr_keyboard_finish(&data.keyboard);
+	xkb_keymap_unref(data.keymap);
+	xkb_context_unref(data.context);
+	return EXIT_SUCCESS;
+}
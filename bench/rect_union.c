@@ -0,0 +1,64 @@
+#include <pixman.h>
+#include <stdlib.h>
+#include "bench.h"
+#include "util/rect_union.h"
+
+/*
+ * Rectangles accumulated by a render pass: many overlapping quads, as when
+ * windows are stacked on top of each other, plus small scattered ones.
+ */
+
+#define WIDTH 3840
+#define HEIGHT 2160
+
+struct bench_data {
+	pixman_box32_t *boxes;
+	size_t boxes_len;
+};
+
+static void bench_evaluate(void *_data) {
+	struct bench_data *data = _data;
+	struct rect_union r;
+	rect_union_init(&r);
+	for (size_t i = 0; i < data->boxes_len; i++) {
+		rect_union_add(&r, data->boxes[i]);
+	}
+	const pixman_region32_t *region = rect_union_evaluate(&r);
+	bench_consume(pixman_region32_rectangles(region, NULL));
+	rect_union_finish(&r);
+}
+
+static void run(const char *name, size_t boxes_len) {
+	struct bench_data data = { .boxes_len = boxes_len };
+	data.boxes = calloc(boxes_len, sizeof(data.boxes[0]));
+	if (data.boxes == NULL) {
+		abort();
+	}
+
+	for (size_t i = 0; i < boxes_len; i++) {
+		int w, h;
+		if (i % 4 == 0) {
+			w = 400 + rand() % 800;
+			h = 300 + rand() % 600;
+		} else {
+			w = 8 + rand() % 64;
+			h = 8 + rand() % 32;
+		}
+		int x = rand() % (WIDTH - w);
+		int y = rand() % (HEIGHT - h);
+		data.boxes[i] = (pixman_box32_t){ x, y, x + w, y + h };
+	}
+
+	bench_run(name, bench_evaluate, &data);
+
+	free(data.boxes);
+}
+
+int main(void) {
+	srand(42);
+
+	run("rect_union_evaluate_16", 16);
+	run("rect_union_evaluate_128", 128);
+	run("rect_union_evaluate_1024", 1024);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,91 @@
+#include <pixman.h>
+#include <stdlib.h>
+#include <wayland-server-protocol.h>
+#include <wlr/util/region.h>
+#include "bench.h"
+
+/*
+ * Damage resembling a frame with many small updates scattered over a 4K
+ * output: a few hundred disjoint rectangles, as produced when several clients
+ * redraw text or icons.
+ */
+
+#define WIDTH 3840
+#define HEIGHT 2160
+#define RECTS_LEN 256
+
+struct bench_data {
+	pixman_region32_t region;
+	enum wl_output_transform transform;
+};
+
+static void bench_transform(void *_data) {
+	struct bench_data *data = _data;
+	pixman_region32_t dst;
+	pixman_region32_init(&dst);
+	wlr_region_transform(&dst, &data->region, data->transform, WIDTH, HEIGHT);
+	bench_consume(pixman_region32_rectangles(&dst, NULL));
+	pixman_region32_fini(&dst);
+}
+
+static void bench_transform_all(void *_data) {
+	struct bench_data *data = _data;
+	for (int t = WL_OUTPUT_TRANSFORM_NORMAL;
+			t <= WL_OUTPUT_TRANSFORM_FLIPPED_270; t++) {
+		data->transform = t;
+		bench_transform(data);
+	}
+}
+
+static void bench_scale(void *_data) {
+	struct bench_data *data = _data;
+	pixman_region32_t dst;
+	pixman_region32_init(&dst);
+	wlr_region_scale(&dst, &data->region, 1.5);
+	bench_consume(pixman_region32_rectangles(&dst, NULL));
+	pixman_region32_fini(&dst);
+}
+
+static void bench_expand(void *_data) {
+	struct bench_data *data = _data;
+	pixman_region32_t dst;
+	pixman_region32_init(&dst);
+	wlr_region_expand(&dst, &data->region, 2);
+	bench_consume(pixman_region32_rectangles(&dst, NULL));
+	pixman_region32_fini(&dst);
+}
+
+static void bench_rotated_bounds(void *_data) {
+	struct bench_data *data = _data;
+	pixman_region32_t dst;
+	pixman_region32_init(&dst);
+	wlr_region_rotated_bounds(&dst, &data->region, 0.3, WIDTH / 2, HEIGHT / 2);
+	bench_consume(pixman_region32_rectangles(&dst, NULL));
+	pixman_region32_fini(&dst);
+}
+
+int main(void) {
+	srand(42);
+
+	struct bench_data data = {0};
+	pixman_region32_init(&data.region);
+	for (size_t i = 0; i < RECTS_LEN; i++) {
+		pixman_region32_union_rect(&data.region, &data.region,
+			rand() % (WIDTH - 128), rand() % (HEIGHT - 32),
+			8 + rand() % 120, 8 + rand() % 24);
+	}
+
+	data.transform = WL_OUTPUT_TRANSFORM_NORMAL;
+	bench_run("region_transform_normal", bench_transform, &data);
+	data.transform = WL_OUTPUT_TRANSFORM_90;
+	bench_run("region_transform_90", bench_transform, &data);
+	data.transform = WL_OUTPUT_TRANSFORM_FLIPPED_180;
+	bench_run("region_transform_flipped_180", bench_transform, &data);
+	bench_run("region_transform_all", bench_transform_all, &data);
+	bench_run("region_scale", bench_scale, &data);
+	bench_run("region_expand", bench_expand, &data);
+	bench_run("region_rotated_bounds", bench_rotated_bounds, &data);
+
+	pixman_region32_fini(&data.region);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,131 @@
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wayland-server-protocol.h>
+#include <wlr/render/pass.h>
+#include <wlr/render/wlr_texture.h>
+#include <wlr/types/wlr_buffer.h>
+#include "bench.h"
+
+/*
+ * A client buffer composited into a 1080p frame with the pixman renderer, as
+ * a compositor does for a rotated or scaled output, with a few rectangles for
+ * decorations on top.
+ */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define TEXTURE_WIDTH 800
+#define TEXTURE_HEIGHT 600
+
+struct bench_data {
+	struct bench_headless headless;
+	struct wlr_buffer *target;
+	struct wlr_buffer *source;
+	struct wlr_texture *texture;
+
+	enum wl_output_transform transform;
+	float scale;
+	enum wlr_scale_filter_mode filter_mode;
+};
+
+static void bench_upload(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_texture *texture =
+		wlr_texture_from_buffer(data->headless.renderer, data->source);
+	if (texture == NULL) {
+		abort();
+	}
+	bench_consume(texture);
+	wlr_texture_destroy(texture);
+}
+
+static void bench_pass(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_render_pass *pass = wlr_renderer_begin_buffer_pass(
+		data->headless.renderer, data->target, NULL);
+	if (pass == NULL) {
+		abort();
+	}
+
+	wlr_render_pass_add_rect(pass, &(struct wlr_render_rect_options){
+		.box = { .width = WIDTH, .height = HEIGHT },
+		.color = { .r = 0.2, .g = 0.2, .b = 0.2, .a = 1 },
+	});
+
+	int width = TEXTURE_WIDTH, height = TEXTURE_HEIGHT;
+	if (data->transform % 2 != 0) {
+		width = TEXTURE_HEIGHT;
+		height = TEXTURE_WIDTH;
+	}
+	struct wlr_box dst_box = {
+		.x = 100,
+		.y = 50,
+		.width = (int)(width * data->scale),
+		.height = (int)(height * data->scale),
+	};
+	wlr_render_pass_add_texture(pass, &(struct wlr_render_texture_options){
+		.texture = data->texture,
+		.dst_box = dst_box,
+		.transform = data->transform,
+		.filter_mode = data->filter_mode,
+	});
+
+	for (int i = 0; i < 4; i++) {
+		wlr_render_pass_add_rect(pass, &(struct wlr_render_rect_options){
+			.box = { .x = dst_box.x + i * 40, .y = dst_box.y - 24,
+				.width = 32, .height = 20 },
+			.color = { .r = 0.8, .g = 0.3, .b = 0.3, .a = 0.5 },
+		});
+	}
+
+	if (!wlr_render_pass_submit(pass)) {
+		abort();
+	}
+}
+
+static void run(struct bench_data *data, enum wl_output_transform transform,
+		float scale, enum wlr_scale_filter_mode filter_mode) {
+	static const char *const filter_names[] = {
+		[WLR_SCALE_FILTER_BILINEAR] = "bilinear",
+		[WLR_SCALE_FILTER_NEAREST] = "nearest",
+	};
+
+	data->transform = transform;
+	data->scale = scale;
+	data->filter_mode = filter_mode;
+
+	char name[64];
+	snprintf(name, sizeof(name), "render_pass_transform_%d_scale_%.2f_%s",
+		(int)transform, scale, filter_names[filter_mode]);
+	bench_run(name, bench_pass, data);
+}
+
+int main(void) {
+	struct bench_data data = {0};
+	bench_headless_init(&data.headless);
+	data.target = bench_headless_create_buffer(&data.headless,
+		WIDTH, HEIGHT, DRM_FORMAT_XRGB8888);
+	data.source = bench_headless_create_buffer(&data.headless,
+		TEXTURE_WIDTH, TEXTURE_HEIGHT, DRM_FORMAT_ARGB8888);
+	data.texture = wlr_texture_from_buffer(data.headless.renderer, data.source);
+	if (data.texture == NULL) {
+		abort();
+	}
+
+	bench_run("render_texture_upload", bench_upload, &data);
+
+	run(&data, WL_OUTPUT_TRANSFORM_NORMAL, 1, WLR_SCALE_FILTER_BILINEAR);
+	run(&data, WL_OUTPUT_TRANSFORM_90, 1, WLR_SCALE_FILTER_BILINEAR);
+	run(&data, WL_OUTPUT_TRANSFORM_FLIPPED_180, 1, WLR_SCALE_FILTER_BILINEAR);
+	run(&data, WL_OUTPUT_TRANSFORM_NORMAL, 1.25, WLR_SCALE_FILTER_BILINEAR);
+	run(&data, WL_OUTPUT_TRANSFORM_NORMAL, 1.25, WLR_SCALE_FILTER_NEAREST);
+	run(&data, WL_OUTPUT_TRANSFORM_NORMAL, 1.5, WLR_SCALE_FILTER_BILINEAR);
+	run(&data, WL_OUTPUT_TRANSFORM_270, 1.5, WLR_SCALE_FILTER_BILINEAR);
+
+	wlr_texture_destroy(data.texture);
+	wlr_buffer_drop(data.source);
+	wlr_buffer_drop(data.target);
+	bench_headless_finish(&data.headless);
+	return EXIT_SUCCESS;
+}
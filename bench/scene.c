@@ -0,0 +1,170 @@
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <wayland-server-core.h>
+#include <wlr/backend/headless.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/types/wlr_scene.h>
+#include "bench.h"
+
+/*
+ * A desktop with a background and a cascade of windows, each made of a border
+ * and a client buffer, rendered with pixman into a 1080p headless output.
+ */
+
+#define WIDTH 1920
+#define HEIGHT 1080
+#define WINDOW_WIDTH 640
+#define WINDOW_HEIGHT 480
+#define BORDER 2
+#define NODE_AT_POINTS 64
+
+struct bench_data {
+	struct bench_headless headless;
+	struct wlr_output *output;
+	struct wlr_scene *scene;
+	struct wlr_scene_output *scene_output;
+	struct wlr_scene_rect *background;
+	struct wlr_scene_tree *top;
+	struct wlr_buffer *buffer;
+	size_t frame;
+	uint32_t seed;
+};
+
+static void render_frame(struct bench_data *data) {
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	if (!wlr_scene_output_build_state(data->scene_output, &state, NULL)) {
+		abort();
+	}
+	// Every frame must be composited by the renderer: a client buffer
+	// scanned out directly or offloaded to a layer would skip the work
+	// being measured
+	if (state.buffer == data->buffer ||
+			(state.committed & WLR_OUTPUT_STATE_LAYERS)) {
+		abort();
+	}
+	if (!wlr_output_commit_state(data->output, &state)) {
+		abort();
+	}
+	wlr_output_state_finish(&state);
+
+	// Deliver the present event queued by the commit
+	wl_event_loop_dispatch(data->headless.loop, 0);
+}
+
+static void bench_render_full(void *_data) {
+	struct bench_data *data = _data;
+	float shade = (data->frame++ % 2) ? 0.2 : 0.3;
+	wlr_scene_rect_set_color(data->background,
+		(float[4]){ shade, shade, shade, 1 });
+	render_frame(data);
+}
+
+static void bench_render_move(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_scene_node *node = &data->top->node;
+	int dx = (data->frame++ % 2) ? 1 : -1;
+	wlr_scene_node_set_position(node, node->x + dx, node->y);
+	render_frame(data);
+}
+
+static void bench_node_at(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_scene_node *found = NULL;
+	for (size_t i = 0; i < NODE_AT_POINTS; i++) {
+		data->seed = data->seed * 1103515245 + 12345;
+		double lx = (data->seed >> 16) % WIDTH;
+		data->seed = data->seed * 1103515245 + 12345;
+		double ly = (data->seed >> 16) % HEIGHT;
+		double nx, ny;
+		found = wlr_scene_node_at(&data->scene->tree.node, lx, ly, &nx, &ny);
+	}
+	bench_consume(found);
+}
+
+static void setup(struct bench_data *data, int windows_len) {
+	bench_headless_init(&data->headless);
+
+	data->output = wlr_headless_add_output(data->headless.backend,
+		WIDTH, HEIGHT);
+	if (data->output == NULL || !wlr_output_init_render(data->output,
+			data->headless.allocator, data->headless.renderer)) {
+		abort();
+	}
+	struct wlr_output_state state;
+	wlr_output_state_init(&state);
+	wlr_output_state_set_enabled(&state, true);
+	if (!wlr_output_commit_state(data->output, &state)) {
+		abort();
+	}
+	wlr_output_state_finish(&state);
+
+	// Measure rendering, not direct scanout of the topmost window
+	setenv("WLR_SCENE_DISABLE_DIRECT_SCANOUT", "1", 1);
+	data->scene = wlr_scene_create();
+	data->scene_output = wlr_scene_output_create(data->scene, data->output);
+	if (data->scene == NULL || data->scene_output == NULL) {
+		abort();
+	}
+
+	data->background = wlr_scene_rect_create(&data->scene->tree, WIDTH, HEIGHT,
+		(float[4]){ 0.2, 0.2, 0.2, 1 });
+	data->buffer = bench_headless_create_buffer(&data->headless,
+		WINDOW_WIDTH, WINDOW_HEIGHT, DRM_FORMAT_XRGB8888);
+
+	for (int i = 0; i < windows_len; i++) {
+		struct wlr_scene_tree *tree = wlr_scene_tree_create(&data->scene->tree);
+		if (tree == NULL) {
+			abort();
+		}
+		wlr_scene_node_set_position(&tree->node,
+			(i * 29) % (WIDTH - WINDOW_WIDTH),
+			(i * 17) % (HEIGHT - WINDOW_HEIGHT));
+
+		struct wlr_scene_rect *border = wlr_scene_rect_create(tree,
+			WINDOW_WIDTH + 2 * BORDER, WINDOW_HEIGHT + 2 * BORDER,
+			(float[4]){ 0.3, 0.5, 0.8, 1 });
+		struct wlr_scene_buffer *buffer =
+			wlr_scene_buffer_create(tree, data->buffer);
+		if (border == NULL || buffer == NULL) {
+			abort();
+		}
+		wlr_scene_node_set_position(&border->node, -BORDER, -BORDER);
+		data->top = tree;
+	}
+
+	// Start from a fully rendered frame
+	render_frame(data);
+	render_frame(data);
+}
+
+static void teardown(struct bench_data *data) {
+	wlr_scene_node_destroy(&data->scene->tree.node);
+	wlr_buffer_drop(data->buffer);
+	wlr_output_destroy(data->output);
+	bench_headless_finish(&data->headless);
+}
+
+static void run(int windows_len) {
+	struct bench_data data = { .seed = 42 };
+	setup(&data, windows_len);
+
+	char name[64];
+	snprintf(name, sizeof(name), "scene_render_full_%d", windows_len);
+	bench_run(name, bench_render_full, &data);
+	snprintf(name, sizeof(name), "scene_render_move_%d", windows_len);
+	bench_run(name, bench_render_move, &data);
+	snprintf(name, sizeof(name), "scene_node_at_%d", windows_len);
+	bench_run(name, bench_node_at, &data);
+
+	teardown(&data);
+}
+
+int main(void) {
+	run(10);
+	run(100);
+	run(500);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,94 @@
+#include <drm_fourcc.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/render/allocator.h>
+#include <wlr/render/drm_format_set.h>
+#include <wlr/types/wlr_buffer.h>
+#include "bench.h"
+
+/*
+ * Shared memory buffers as used by the pixman renderer: allocating a buffer
+ * for a swapchain, and accessing its pixels for rendering.
+ */
+
+struct bench_data {
+	struct bench_headless headless;
+	struct wlr_drm_format_set formats;
+	int width, height;
+	struct wlr_buffer *buffer;
+};
+
+static void bench_allocate(void *_data) {
+	struct bench_data *data = _data;
+	struct wlr_buffer *buffer = wlr_allocator_create_buffer(
+		data->headless.allocator, data->width, data->height,
+		wlr_drm_format_set_get(&data->formats, DRM_FORMAT_XRGB8888));
+	if (buffer == NULL) {
+		abort();
+	}
+	bench_consume(buffer);
+	wlr_buffer_drop(buffer);
+}
+
+static void bench_access(void *_data) {
+	struct bench_data *data = _data;
+	void *ptr;
+	uint32_t format;
+	size_t stride;
+	if (!wlr_buffer_begin_data_ptr_access(data->buffer,
+			WLR_BUFFER_DATA_PTR_ACCESS_READ | WLR_BUFFER_DATA_PTR_ACCESS_WRITE,
+			&ptr, &format, &stride)) {
+		abort();
+	}
+	bench_consume(ptr);
+	wlr_buffer_end_data_ptr_access(data->buffer);
+}
+
+static void bench_clear(void *_data) {
+	struct bench_data *data = _data;
+	void *ptr;
+	uint32_t format;
+	size_t stride;
+	if (!wlr_buffer_begin_data_ptr_access(data->buffer,
+			WLR_BUFFER_DATA_PTR_ACCESS_WRITE, &ptr, &format, &stride)) {
+		abort();
+	}
+	memset(ptr, 0, stride * data->height);
+	bench_consume(ptr);
+	wlr_buffer_end_data_ptr_access(data->buffer);
+}
+
+static void run(struct bench_data *data, int width, int height) {
+	data->width = width;
+	data->height = height;
+	data->buffer = bench_headless_create_buffer(&data->headless,
+		width, height, DRM_FORMAT_XRGB8888);
+
+	char name[64];
+	snprintf(name, sizeof(name), "shm_allocate_%dx%d", width, height);
+	bench_run(name, bench_allocate, data);
+	snprintf(name, sizeof(name), "shm_access_%dx%d", width, height);
+	bench_run(name, bench_access, data);
+	snprintf(name, sizeof(name), "shm_clear_%dx%d", width, height);
+	bench_run(name, bench_clear, data);
+
+	wlr_buffer_drop(data->buffer);
+}
+
+int main(void) {
+	struct bench_data data = {0};
+	bench_headless_init(&data.headless);
+	if (!wlr_drm_format_set_add(&data.formats, DRM_FORMAT_XRGB8888,
+			DRM_FORMAT_MOD_LINEAR)) {
+		abort();
+	}
+
+	run(&data, 256, 256);
+	run(&data, 1920, 1080);
+	run(&data, 3840, 2160);
+
+	wlr_drm_format_set_finish(&data.formats);
+	bench_headless_finish(&data.headless);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,51 @@
+#include <stdlib.h>
+#include <wlr/xcursor.h>
+#include "bench.h"
+
+/*
+ * Loading the default cursor theme at startup, for a single output and for
+ * outputs with several scales. The result depends on the themes installed
+ * on the system, the built-in fallback is used if there are none.
+ */
+
+#define SIZES_LEN 3
+
+static const int sizes[SIZES_LEN] = { 24, 36, 48 };
+
+static void bench_load(void *data) {
+	struct wlr_xcursor_theme *theme = wlr_xcursor_theme_load(NULL, sizes[0]);
+	if (theme == NULL) {
+		abort();
+	}
+	bench_consume(theme);
+	wlr_xcursor_theme_destroy(theme);
+}
+
+static void bench_load_separately(void *data) {
+	for (size_t i = 0; i < SIZES_LEN; i++) {
+		struct wlr_xcursor_theme *theme = wlr_xcursor_theme_load(NULL, sizes[i]);
+		if (theme == NULL) {
+			abort();
+		}
+		bench_consume(theme);
+		wlr_xcursor_theme_destroy(theme);
+	}
+}
+
+static void bench_load_sizes(void *data) {
+	struct wlr_xcursor_theme *themes[SIZES_LEN];
+	if (!wlr_xcursor_theme_load_sizes(NULL, sizes, SIZES_LEN, themes)) {
+		abort();
+	}
+	for (size_t i = 0; i < SIZES_LEN; i++) {
+		bench_consume(themes[i]);
+		wlr_xcursor_theme_destroy(themes[i]);
+	}
+}
+
+int main(void) {
+	bench_run("xcursor_theme_load", bench_load, NULL);
+	bench_run("xcursor_theme_load_3_separately", bench_load_separately, NULL);
+	bench_run("xcursor_theme_load_3_sizes", bench_load_sizes, NULL);
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,826 @@
+#define _GNU_SOURCE // for memfd_create()
+#include <errno.h>
+#include <getopt.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include <wayland-client.h>
+
+#include "presentation-time-client-protocol.h"
+#include "xdg-shell-client-protocol.h"
+
+/*
+ * A client generating a synthetic load on a compositor, to measure its
+ * throughput and latency without real applications. It opens a number of
+ * toplevels, each with a number of synchronized subsurfaces, and commits
+ * shared memory buffers with a chosen damage pattern, either as fast as frame
+ * callbacks allow or at a fixed rate.
+ *
+ * At exit, it prints a single JSON object on stdout with the number of frames
+ * committed, the latency between a commit and its frame callback, and the
+ * latency between a commit and its presentation if the compositor supports
+ * wp_presentation.
+ *
+ * For a reproducible benchmark without a GPU, run it in tinywl with the
+ * headless backend and the pixman renderer:
+ *
+ *   WLR_BACKENDS=headless WLR_RENDERER=pixman WLR_HEADLESS_OUTPUTS=1 \
+ *     tinywl -s "load-generator -n 10 -d random -t 10"
+ */
+
+#define BUFFERS_LEN 3
+#define SUBSURFACE_SIZE 96
+#define SUBSURFACE_SPACING 16
+#define SCROLL_STEP 4
+#define RANDOM_RECTS_LEN 8
+
+enum damage_pattern {
+	DAMAGE_FULL,
+	DAMAGE_SCROLL,
+	DAMAGE_BLINK,
+	DAMAGE_RANDOM,
+};
+
+static const char *const damage_pattern_names[] = {
+	[DAMAGE_FULL] = "full",
+	[DAMAGE_SCROLL] = "scroll",
+	[DAMAGE_BLINK] = "blink",
+	[DAMAGE_RANDOM] = "random",
+};
+
+struct buffer {
+	struct wl_buffer *wl_buffer;
+	uint32_t *data;
+	bool busy;
+};
+
+struct surface {
+	struct wl_surface *wl_surface;
+	struct wl_subsurface *subsurface; // NULL for the toplevel's surface
+	int width, height;
+	uint32_t id; // seeds the random damage pattern
+
+	struct buffer buffers[BUFFERS_LEN];
+	void *shm_data;
+	size_t shm_size;
+
+	uint64_t frame; // number of frames drawn so far
+};
+
+struct window {
+	struct surface main;
+	struct surface *subsurfaces;
+	int subsurfaces_len;
+
+	struct xdg_surface *xdg_surface;
+	struct xdg_toplevel *xdg_toplevel;
+	bool configured;
+
+	struct wl_callback *frame_callback;
+	int64_t frame_commit_nsec;
+};
+
+struct feedback {
+	struct wp_presentation_feedback *wp_feedback;
+	int64_t commit_nsec;
+	struct wl_list link;
+};
+
+struct latency_stats {
+	struct wl_array samples; // int64_t, in nanoseconds
+};
+
+static struct wl_display *display = NULL;
+static struct wl_compositor *compositor = NULL;
+static struct wl_subcompositor *subcompositor = NULL;
+static struct wl_shm *shm = NULL;
+static struct xdg_wm_base *wm_base = NULL;
+static struct wp_presentation *presentation = NULL;
+static clockid_t presentation_clock = CLOCK_MONOTONIC;
+
+static int windows_len = 1;
+static int subsurfaces_len = 0;
+static int width = 640, height = 480;
+static enum damage_pattern damage_pattern = DAMAGE_FULL;
+static int rate = 0; // frames per second, 0 to follow frame callbacks
+static int duration_sec = 10;
+
+static bool running = true;
+static struct window *windows = NULL;
+static struct wl_list feedbacks;
+
+static size_t frames_committed = 0;
+static size_t frames_skipped = 0;
+static size_t frames_presented = 0;
+static size_t frames_discarded = 0;
+static struct latency_stats frame_latency = {0};
+static struct latency_stats present_latency = {0};
+
+static int64_t get_time_nsec(void) {
+	struct timespec ts;
+	clock_gettime(presentation_clock, &ts);
+	return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static void latency_stats_add(struct latency_stats *stats, int64_t nsec) {
+	int64_t *sample = wl_array_add(&stats->samples, sizeof(*sample));
+	if (sample != NULL) {
+		*sample = nsec;
+	}
+}
+
+static int compare_samples(const void *a, const void *b) {
+	int64_t sa = *(const int64_t *)a, sb = *(const int64_t *)b;
+	return (sa > sb) - (sa < sb);
+}
+
+static void latency_stats_print(const char *name, struct latency_stats *stats) {
+	size_t len = stats->samples.size / sizeof(int64_t);
+	if (len == 0) {
+		printf("\"%s\": null", name);
+		return;
+	}
+
+	int64_t *samples = stats->samples.data;
+	qsort(samples, len, sizeof(samples[0]), compare_samples);
+	printf("\"%s\": {\"p50\": %.1f, \"p90\": %.1f, \"p99\": %.1f, \"max\": %.1f}",
+		name, samples[len / 2] / 1000.0, samples[len * 9 / 10] / 1000.0,
+		samples[len * 99 / 100] / 1000.0, samples[len - 1] / 1000.0);
+}
+
+static void fill_rect(struct surface *surface, uint32_t *data,
+		int x, int y, int w, int h, uint32_t color) {
+	int x1 = x < 0 ? 0 : x;
+	int y1 = y < 0 ? 0 : y;
+	int x2 = x + w > surface->width ? surface->width : x + w;
+	int y2 = y + h > surface->height ? surface->height : y + h;
+	for (int row = y1; row < y2; row++) {
+		uint32_t *line = data + row * surface->width;
+		for (int col = x1; col < x2; col++) {
+			line[col] = color;
+		}
+	}
+}
+
+static uint32_t frame_color(uint64_t frame) {
+	return 0xFF000000 | (uint32_t)((frame * 7) & 0xFF) << 16 |
+		(uint32_t)((frame * 13) & 0xFF) << 8 | (uint32_t)((frame * 29) & 0xFF);
+}
+
+static uint32_t random_next(uint32_t *state) {
+	// xorshift32
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
+
+static void random_rects_damage(struct surface *surface, uint64_t frame,
+		uint32_t *data) {
+	uint32_t state = (uint32_t)(frame * 2654435761u) ^ surface->id ^ 0x9E3779B9;
+	if (state == 0) {
+		state = 1;
+	}
+	for (int i = 0; i < RANDOM_RECTS_LEN; i++) {
+		int w = 4 + (int)(random_next(&state) % 60);
+		int h = 4 + (int)(random_next(&state) % 60);
+		int x = (int)(random_next(&state) % (uint32_t)surface->width);
+		int y = (int)(random_next(&state) % (uint32_t)surface->height);
+		if (data != NULL) {
+			fill_rect(surface, data, x, y, w, h, frame_color(frame + i));
+		} else {
+			wl_surface_damage_buffer(surface->wl_surface, x, y, w, h);
+		}
+	}
+}
+
+/**
+ * Paint the whole buffer as a function of the frame number, so that any
+ * buffer can be reused regardless of its age, and damage only what changed
+ * since the previous frame. The client does the same amount of work for all
+ * patterns, only the damage sent to the compositor differs.
+ */
+static void surface_paint(struct surface *surface, struct buffer *buffer) {
+	uint64_t frame = surface->frame;
+	int w = surface->width, h = surface->height;
+	int header = h / 8 < 32 ? h / 8 : 32;
+	struct wl_surface *wl_surface = surface->wl_surface;
+
+	switch (damage_pattern) {
+	case DAMAGE_FULL:
+		fill_rect(surface, buffer->data, 0, 0, w, h, frame_color(frame));
+		wl_surface_damage_buffer(wl_surface, 0, 0, w, h);
+		break;
+	case DAMAGE_SCROLL:
+		fill_rect(surface, buffer->data, 0, 0, w, header, 0xFF404040);
+		for (int y = header; y < h; y++) {
+			uint64_t line = (y + frame * SCROLL_STEP) / 16;
+			fill_rect(surface, buffer->data, 0, y, w, 1, frame_color(line));
+		}
+		wl_surface_damage_buffer(wl_surface, 0, header, w, h - header);
+		break;
+	case DAMAGE_BLINK:
+		fill_rect(surface, buffer->data, 0, 0, w, h, 0xFF202020);
+		if (frame % 2 == 0) {
+			fill_rect(surface, buffer->data, w / 4, h / 4, 2, 20, 0xFFFFFFFF);
+		}
+		wl_surface_damage_buffer(wl_surface, w / 4, h / 4, 2, 20);
+		break;
+	case DAMAGE_RANDOM:
+		fill_rect(surface, buffer->data, 0, 0, w, h, 0xFF202020);
+		random_rects_damage(surface, frame, buffer->data);
+		random_rects_damage(surface, frame, NULL);
+		if (frame > 0) {
+			random_rects_damage(surface, frame - 1, NULL);
+		}
+		break;
+	}
+
+	if (frame == 0) {
+		wl_surface_damage_buffer(wl_surface, 0, 0, w, h);
+	}
+}
+
+static struct buffer *surface_next_buffer(struct surface *surface) {
+	for (size_t i = 0; i < BUFFERS_LEN; i++) {
+		if (!surface->buffers[i].busy) {
+			return &surface->buffers[i];
+		}
+	}
+	return NULL;
+}
+
+static bool surface_draw(struct surface *surface) {
+	struct buffer *buffer = surface_next_buffer(surface);
+	if (buffer == NULL) {
+		return false;
+	}
+
+	surface_paint(surface, buffer);
+	surface->frame++;
+
+	wl_surface_attach(surface->wl_surface, buffer->wl_buffer, 0, 0);
+	buffer->busy = true;
+	return true;
+}
+
+static void buffer_handle_release(void *data, struct wl_buffer *wl_buffer) {
+	struct buffer *buffer = data;
+	buffer->busy = false;
+}
+
+static const struct wl_buffer_listener buffer_listener = {
+	.release = buffer_handle_release,
+};
+
+static bool surface_init_buffers(struct surface *surface) {
+	int stride = surface->width * 4;
+	size_t buffer_size = (size_t)stride * surface->height;
+	surface->shm_size = buffer_size * BUFFERS_LEN;
+
+	int fd = memfd_create("load-generator", MFD_CLOEXEC);
+	if (fd < 0) {
+		perror("memfd_create failed");
+		return false;
+	}
+	if (ftruncate(fd, surface->shm_size) != 0) {
+		perror("ftruncate failed");
+		close(fd);
+		return false;
+	}
+
+	surface->shm_data = mmap(NULL, surface->shm_size,
+		PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (surface->shm_data == MAP_FAILED) {
+		perror("mmap failed");
+		surface->shm_data = NULL;
+		close(fd);
+		return false;
+	}
+
+	struct wl_shm_pool *pool = wl_shm_create_pool(shm, fd, surface->shm_size);
+	close(fd);
+	for (size_t i = 0; i < BUFFERS_LEN; i++) {
+		struct buffer *buffer = &surface->buffers[i];
+		buffer->wl_buffer = wl_shm_pool_create_buffer(pool, i * buffer_size,
+			surface->width, surface->height, stride, WL_SHM_FORMAT_XRGB8888);
+		buffer->data = (uint32_t *)((char *)surface->shm_data + i * buffer_size);
+		wl_buffer_add_listener(buffer->wl_buffer, &buffer_listener, buffer);
+	}
+	wl_shm_pool_destroy(pool);
+
+	return true;
+}
+
+static bool surface_init(struct surface *surface, int w, int h) {
+	static uint32_t next_id = 1;
+
+	surface->width = w;
+	surface->height = h;
+	surface->id = next_id++;
+	surface->wl_surface = wl_compositor_create_surface(compositor);
+	return surface_init_buffers(surface);
+}
+
+static void surface_finish(struct surface *surface) {
+	for (size_t i = 0; i < BUFFERS_LEN; i++) {
+		if (surface->buffers[i].wl_buffer != NULL) {
+			wl_buffer_destroy(surface->buffers[i].wl_buffer);
+		}
+	}
+	if (surface->shm_data != NULL) {
+		munmap(surface->shm_data, surface->shm_size);
+	}
+	if (surface->subsurface != NULL) {
+		wl_subsurface_destroy(surface->subsurface);
+	}
+	wl_surface_destroy(surface->wl_surface);
+}
+
+static void window_draw(struct window *window);
+
+static void frame_handle_done(void *data, struct wl_callback *callback,
+		uint32_t time) {
+	struct window *window = data;
+	latency_stats_add(&frame_latency, get_time_nsec() - window->frame_commit_nsec);
+
+	wl_callback_destroy(callback);
+	window->frame_callback = NULL;
+
+	if (rate == 0 && running) {
+		window_draw(window);
+	}
+}
+
+static const struct wl_callback_listener frame_listener = {
+	.done = frame_handle_done,
+};
+
+static void feedback_destroy(struct feedback *feedback) {
+	wp_presentation_feedback_destroy(feedback->wp_feedback);
+	wl_list_remove(&feedback->link);
+	free(feedback);
+}
+
+static void feedback_handle_sync_output(void *data,
+		struct wp_presentation_feedback *wp_feedback, struct wl_output *output) {
+	// No-op
+}
+
+static void feedback_handle_presented(void *data,
+		struct wp_presentation_feedback *wp_feedback, uint32_t tv_sec_hi,
+		uint32_t tv_sec_lo, uint32_t tv_nsec, uint32_t refresh,
+		uint32_t seq_hi, uint32_t seq_lo, uint32_t flags) {
+	struct feedback *feedback = data;
+	int64_t sec = ((int64_t)tv_sec_hi << 32) | tv_sec_lo;
+	int64_t presented_nsec = sec * 1000000000 + tv_nsec;
+	latency_stats_add(&present_latency, presented_nsec - feedback->commit_nsec);
+	frames_presented++;
+	feedback_destroy(feedback);
+}
+
+static void feedback_handle_discarded(void *data,
+		struct wp_presentation_feedback *wp_feedback) {
+	struct feedback *feedback = data;
+	frames_discarded++;
+	feedback_destroy(feedback);
+}
+
+static const struct wp_presentation_feedback_listener feedback_listener = {
+	.sync_output = feedback_handle_sync_output,
+	.presented = feedback_handle_presented,
+	.discarded = feedback_handle_discarded,
+};
+
+static void window_draw(struct window *window) {
+	if (!window->configured) {
+		return;
+	}
+	if (rate == 0 && window->frame_callback != NULL) {
+		return;
+	}
+	if (surface_next_buffer(&window->main) == NULL) {
+		// The compositor still holds all of our buffers
+		frames_skipped++;
+		return;
+	}
+
+	// Subsurfaces are synchronized, their state is applied along with the
+	// toplevel's next commit
+	for (int i = 0; i < window->subsurfaces_len; i++) {
+		struct surface *sub = &window->subsurfaces[i];
+		if (surface_draw(sub)) {
+			wl_surface_commit(sub->wl_surface);
+		}
+	}
+
+	surface_draw(&window->main);
+
+	int64_t now = get_time_nsec();
+	if (window->frame_callback == NULL) {
+		window->frame_callback = wl_surface_frame(window->main.wl_surface);
+		wl_callback_add_listener(window->frame_callback, &frame_listener, window);
+		window->frame_commit_nsec = now;
+	}
+
+	if (presentation != NULL) {
+		struct feedback *feedback = calloc(1, sizeof(*feedback));
+		if (feedback != NULL) {
+			feedback->wp_feedback = wp_presentation_feedback(presentation,
+				window->main.wl_surface);
+			feedback->commit_nsec = now;
+			wp_presentation_feedback_add_listener(feedback->wp_feedback,
+				&feedback_listener, feedback);
+			wl_list_insert(&feedbacks, &feedback->link);
+		}
+	}
+
+	wl_surface_commit(window->main.wl_surface);
+	frames_committed++;
+}
+
+static void xdg_surface_handle_configure(void *data,
+		struct xdg_surface *xdg_surface, uint32_t serial) {
+	struct window *window = data;
+	xdg_surface_ack_configure(xdg_surface, serial);
+	if (!window->configured) {
+		window->configured = true;
+		window_draw(window);
+	}
+}
+
+static const struct xdg_surface_listener xdg_surface_listener = {
+	.configure = xdg_surface_handle_configure,
+};
+
+static void xdg_toplevel_handle_configure(void *data,
+		struct xdg_toplevel *xdg_toplevel, int32_t w, int32_t h,
+		struct wl_array *states) {
+	// The requested size is ignored, to keep the load the same
+}
+
+static void xdg_toplevel_handle_close(void *data,
+		struct xdg_toplevel *xdg_toplevel) {
+	running = false;
+}
+
+static const struct xdg_toplevel_listener xdg_toplevel_listener = {
+	.configure = xdg_toplevel_handle_configure,
+	.close = xdg_toplevel_handle_close,
+};
+
+static bool window_init(struct window *window) {
+	if (!surface_init(&window->main, width, height)) {
+		return false;
+	}
+
+	window->subsurfaces = calloc(subsurfaces_len, sizeof(window->subsurfaces[0]));
+	if (subsurfaces_len > 0 && window->subsurfaces == NULL) {
+		return false;
+	}
+
+	int step = SUBSURFACE_SIZE + SUBSURFACE_SPACING;
+	int cols = (width - SUBSURFACE_SPACING) / step;
+	if (cols < 1) {
+		cols = 1;
+	}
+	for (int i = 0; i < subsurfaces_len; i++) {
+		struct surface *sub = &window->subsurfaces[i];
+		window->subsurfaces_len++;
+		if (!surface_init(sub, SUBSURFACE_SIZE, SUBSURFACE_SIZE)) {
+			return false;
+		}
+
+		sub->subsurface = wl_subcompositor_get_subsurface(subcompositor,
+			sub->wl_surface, window->main.wl_surface);
+		wl_subsurface_set_position(sub->subsurface,
+			SUBSURFACE_SPACING + (i % cols) * step,
+			SUBSURFACE_SPACING + (i / cols) * step);
+	}
+
+	window->xdg_surface = xdg_wm_base_get_xdg_surface(wm_base,
+		window->main.wl_surface);
+	xdg_surface_add_listener(window->xdg_surface, &xdg_surface_listener, window);
+	window->xdg_toplevel = xdg_surface_get_toplevel(window->xdg_surface);
+	xdg_toplevel_add_listener(window->xdg_toplevel, &xdg_toplevel_listener,
+		window);
+	xdg_toplevel_set_title(window->xdg_toplevel, "load-generator");
+	wl_surface_commit(window->main.wl_surface);
+
+	return true;
+}
+
+static void window_finish(struct window *window) {
+	if (window->frame_callback != NULL) {
+		wl_callback_destroy(window->frame_callback);
+	}
+	for (int i = 0; i < window->subsurfaces_len; i++) {
+		surface_finish(&window->subsurfaces[i]);
+	}
+	free(window->subsurfaces);
+	if (window->xdg_toplevel != NULL) {
+		xdg_toplevel_destroy(window->xdg_toplevel);
+	}
+	if (window->xdg_surface != NULL) {
+		xdg_surface_destroy(window->xdg_surface);
+	}
+	if (window->main.wl_surface != NULL) {
+		surface_finish(&window->main);
+	}
+}
+
+static void wm_base_handle_ping(void *data, struct xdg_wm_base *wm_base,
+		uint32_t serial) {
+	xdg_wm_base_pong(wm_base, serial);
+}
+
+static const struct xdg_wm_base_listener wm_base_listener = {
+	.ping = wm_base_handle_ping,
+};
+
+static void presentation_handle_clock_id(void *data,
+		struct wp_presentation *presentation, uint32_t clock_id) {
+	presentation_clock = clock_id;
+}
+
+static const struct wp_presentation_listener presentation_listener = {
+	.clock_id = presentation_handle_clock_id,
+};
+
+static void registry_handle_global(void *data, struct wl_registry *registry,
+		uint32_t name, const char *interface, uint32_t version) {
+	if (strcmp(interface, wl_compositor_interface.name) == 0) {
+		compositor = wl_registry_bind(registry, name,
+			&wl_compositor_interface, 4);
+	} else if (strcmp(interface, wl_subcompositor_interface.name) == 0) {
+		subcompositor = wl_registry_bind(registry, name,
+			&wl_subcompositor_interface, 1);
+	} else if (strcmp(interface, wl_shm_interface.name) == 0) {
+		shm = wl_registry_bind(registry, name, &wl_shm_interface, 1);
+	} else if (strcmp(interface, xdg_wm_base_interface.name) == 0) {
+		wm_base = wl_registry_bind(registry, name, &xdg_wm_base_interface, 1);
+		xdg_wm_base_add_listener(wm_base, &wm_base_listener, NULL);
+	} else if (strcmp(interface, wp_presentation_interface.name) == 0) {
+		presentation = wl_registry_bind(registry, name,
+			&wp_presentation_interface, 1);
+		wp_presentation_add_listener(presentation, &presentation_listener, NULL);
+	}
+}
+
+static void registry_handle_global_remove(void *data,
+		struct wl_registry *registry, uint32_t name) {
+	// Who cares?
+}
+
+static const struct wl_registry_listener registry_listener = {
+	.global = registry_handle_global,
+	.global_remove = registry_handle_global_remove,
+};
+
+static int create_rate_timer(void) {
+	int fd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+	if (fd < 0) {
+		perror("timerfd_create failed");
+		return -1;
+	}
+
+	long interval_nsec = 1000000000L / rate;
+	struct itimerspec spec = {
+		.it_interval = { interval_nsec / 1000000000L, interval_nsec % 1000000000L },
+		.it_value = { interval_nsec / 1000000000L, interval_nsec % 1000000000L },
+	};
+	if (timerfd_settime(fd, 0, &spec, NULL) != 0) {
+		perror("timerfd_settime failed");
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+/**
+ * Dispatch Wayland events, and draw all windows at the fixed rate if one was
+ * requested, until the duration elapses or the connection fails.
+ */
+static void run(int64_t end_nsec) {
+	int timer_fd = -1;
+	if (rate > 0) {
+		timer_fd = create_rate_timer();
+		if (timer_fd < 0) {
+			return;
+		}
+	}
+
+	struct pollfd fds[] = {
+		{ .fd = wl_display_get_fd(display), .events = POLLIN },
+		{ .fd = timer_fd, .events = POLLIN },
+	};
+	nfds_t nfds = timer_fd >= 0 ? 2 : 1;
+
+	while (running) {
+		int64_t remaining_nsec = end_nsec - get_time_nsec();
+		if (remaining_nsec <= 0) {
+			break;
+		}
+
+		while (wl_display_prepare_read(display) != 0) {
+			if (wl_display_dispatch_pending(display) < 0) {
+				goto out;
+			}
+		}
+		if (wl_display_flush(display) < 0 && errno != EAGAIN) {
+			wl_display_cancel_read(display);
+			break;
+		}
+
+		int timeout = (int)(remaining_nsec / 1000000) + 1;
+		if (poll(fds, nfds, timeout) < 0) {
+			wl_display_cancel_read(display);
+			if (errno == EINTR) {
+				continue;
+			}
+			perror("poll failed");
+			break;
+		}
+
+		if (fds[0].revents & POLLIN) {
+			if (wl_display_read_events(display) < 0) {
+				break;
+			}
+		} else {
+			wl_display_cancel_read(display);
+		}
+		if (fds[0].revents & (POLLERR | POLLHUP)) {
+			fprintf(stderr, "Lost connection to the compositor\n");
+			break;
+		}
+		if (wl_display_dispatch_pending(display) < 0) {
+			break;
+		}
+
+		if (nfds > 1 && (fds[1].revents & POLLIN)) {
+			uint64_t expirations;
+			if (read(timer_fd, &expirations, sizeof(expirations)) > 0) {
+				for (int i = 0; i < windows_len; i++) {
+					window_draw(&windows[i]);
+				}
+			}
+		}
+	}
+
+out:
+	if (timer_fd >= 0) {
+		close(timer_fd);
+	}
+}
+
+static bool parse_damage_pattern(const char *name, enum damage_pattern *out) {
+	for (size_t i = 0; i < sizeof(damage_pattern_names) /
+			sizeof(damage_pattern_names[0]); i++) {
+		if (strcmp(name, damage_pattern_names[i]) == 0) {
+			*out = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+static void print_usage(const char *argv0) {
+	fprintf(stderr, "Usage: %s [options]\n"
+		"  -n <count>   Number of toplevels (default: 1)\n"
+		"  -s <count>   Number of subsurfaces per toplevel (default: 0)\n"
+		"  -g <WxH>     Toplevel size (default: 640x480)\n"
+		"  -d <damage>  Damage pattern: full, scroll, blink or random "
+			"(default: full)\n"
+		"  -r <rate>    Frames per second, 0 to follow frame callbacks "
+			"(default: 0)\n"
+		"  -t <secs>    Duration (default: 10)\n", argv0);
+}
+
+int main(int argc, char *argv[]) {
+	int c;
+	while ((c = getopt(argc, argv, "n:s:g:d:r:t:h")) != -1) {
+		switch (c) {
+		case 'n':
+			windows_len = atoi(optarg);
+			break;
+		case 's':
+			subsurfaces_len = atoi(optarg);
+			break;
+		case 'g':
+			if (sscanf(optarg, "%dx%d", &width, &height) != 2) {
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'd':
+			if (!parse_damage_pattern(optarg, &damage_pattern)) {
+				print_usage(argv[0]);
+				return EXIT_FAILURE;
+			}
+			break;
+		case 'r':
+			rate = atoi(optarg);
+			break;
+		case 't':
+			duration_sec = atoi(optarg);
+			break;
+		default:
+			print_usage(argv[0]);
+			return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+		}
+	}
+	if (optind < argc || windows_len < 1 || subsurfaces_len < 0 ||
+			width < 1 || height < 1 || rate < 0 || duration_sec < 1) {
+		print_usage(argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	display = wl_display_connect(NULL);
+	if (display == NULL) {
+		fprintf(stderr, "Failed to connect to the Wayland display\n");
+		return EXIT_FAILURE;
+	}
+
+	struct wl_registry *registry = wl_display_get_registry(display);
+	wl_registry_add_listener(registry, &registry_listener, NULL);
+	wl_display_roundtrip(display);
+	// Get the presentation clock
+	wl_display_roundtrip(display);
+
+	if (compositor == NULL || subcompositor == NULL || shm == NULL ||
+			wm_base == NULL) {
+		fprintf(stderr, "Compositor doesn't support wl_compositor, "
+			"wl_subcompositor, wl_shm or xdg_wm_base\n");
+		return EXIT_FAILURE;
+	}
+	if (presentation == NULL) {
+		fprintf(stderr, "Compositor doesn't support wp_presentation, "
+			"presentation latency won't be measured\n");
+	}
+
+	wl_list_init(&feedbacks);
+	wl_array_init(&frame_latency.samples);
+	wl_array_init(&present_latency.samples);
+
+	int ret = EXIT_FAILURE;
+	windows = calloc(windows_len, sizeof(windows[0]));
+	if (windows == NULL) {
+		goto out;
+	}
+	for (int i = 0; i < windows_len; i++) {
+		if (!window_init(&windows[i])) {
+			fprintf(stderr, "Failed to create window\n");
+			goto out;
+		}
+	}
+
+	int64_t start_nsec = get_time_nsec();
+	run(start_nsec + (int64_t)duration_sec * 1000000000);
+	double elapsed_sec = (get_time_nsec() - start_nsec) / 1e9;
+
+	printf("{\"name\": \"load_generator\", \"windows\": %d, \"subsurfaces\": %d, "
+		"\"size\": \"%dx%d\", \"damage\": \"%s\", \"rate\": %d, "
+		"\"duration_s\": %.3f, \"frames\": %zu, \"fps\": %.1f, "
+		"\"skipped\": %zu, \"presented\": %zu, \"discarded\": %zu, ",
+		windows_len, subsurfaces_len, width, height,
+		damage_pattern_names[damage_pattern], rate, elapsed_sec,
+		frames_committed, frames_committed / elapsed_sec, frames_skipped,
+		frames_presented, frames_discarded);
+	latency_stats_print("frame_latency_us", &frame_latency);
+	printf(", ");
+	latency_stats_print("present_latency_us", &present_latency);
+	printf("}\n");
+	ret = EXIT_SUCCESS;
+
+out:
+	if (windows != NULL) {
+		for (int i = 0; i < windows_len; i++) {
+			window_finish(&windows[i]);
+		}
+		free(windows);
+	}
+	struct feedback *feedback, *tmp;
+	wl_list_for_each_safe(feedback, tmp, &feedbacks, link) {
+		feedback_destroy(feedback);
+	}
+	wl_array_release(&frame_latency.samples);
+	wl_array_release(&present_latency.samples);
+
+	if (presentation != NULL) {
+		wp_presentation_destroy(presentation);
+	}
+	xdg_wm_base_destroy(wm_base);
+	wl_shm_destroy(shm);
+	wl_subcompositor_destroy(subcompositor);
+	wl_compositor_destroy(compositor);
+	wl_registry_destroy(registry);
+	wl_display_disconnect(display);
+	return ret;
+}
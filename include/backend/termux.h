@@ -3,13 +3,19 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+#include <pixman.h>
 #include <wayland-server-core.h>
 #include <wlr/backend/termux.h>
 #include <wlr/backend/interface.h>
+#include <wlr/render/drm_format_set.h>
 #include <wlr/types/wlr_keyboard.h>
 #include <wlr/types/wlr_pointer.h>
 #include <wlr/types/wlr_touch.h>
 
+/* Size of the conn_fd read buffer, a multiple of sizeof(lorieEvent) */
+#define TERMUX_INPUT_BUFFER_SIZE 4096
+
 struct wlr_termux_backend {
 	struct wlr_backend backend;
 	struct wl_event_loop *event_loop;
@@ -17,20 +23,35 @@ struct wlr_termux_backend {
 	struct wl_listener event_loop_destroy;
 	bool started;
 	char *socket_path;
+	bool rgb565; /* WLR_TERMUX_RGB565: advertise RGB565 as primary format */
 
 	struct wl_event_source *input_event;
 	struct wlr_termux_pointer *pointer;
 	struct wlr_termux_touch *touch;
 	struct wlr_termux_keyboard *keyboard;
 
+	/** Bytes read from conn_fd which do not form a complete lorieEvent yet. */
+	struct {
+		uint8_t data[TERMUX_INPUT_BUFFER_SIZE];
+		size_t len;
+		size_t skip; /* trailing screen size name bytes still to discard */
+	} input_buffer;
+
 	/** Emitted when a Unicode codepoint is received (EVENT_UNICODE). data: const uint32_t* codepoint. Compositor may forward via wlr_text_input_v3_send_commit_string. */
 	struct wl_signal events_unicode;
 
-	/** Pending resize from EVENT_SCREEN_SIZE; timer triggers reinit (disconnect, sleep, connect, update output, recreate input). */
+	/** Pending resize from EVENT_SCREEN_SIZE, applied after the input batch.
+	 * The shared buffer size can only change when connecting, so the timer
+	 * replaces the connection outside of the conn_fd callback. The input
+	 * devices stay alive, only the conn_fd event source is replaced. Failed
+	 * attempts are retried a few times, then the previous size is restored. */
 	struct {
+		bool pending;
 		int width;
 		int height;
 		int framerate;
+		int attempts;
+		bool restoring; /* width/height hold the size being restored */
 		struct wl_event_source *timer;
 	} resize_pending;
 };
@@ -44,6 +65,7 @@ struct wlr_termux_output {
 	struct wlr_output wlr_output;
 	struct wlr_termux_backend *backend;
 	struct wl_list link;
+	struct wlr_drm_format_set primary_formats;
 };
 
 struct wlr_termux_pointer {
@@ -61,10 +83,28 @@ struct wlr_termux_backend *termux_backend_from_backend(struct wlr_backend *wlr_b
 void termux_input_create_devices(struct wlr_termux_backend *backend);
 void termux_input_destroy(struct wlr_termux_backend *backend);
 
+void termux_output_update_mode(struct wlr_termux_output *output,
+	int width, int height, int refresh);
+
 /* libtermux-render wrapper; use <termux/render/render.h> and <termux/render/buffer.h> where you need library types. */
 int termux_render_connect(int width, int height, int refresh);
 void termux_render_disconnect(void);
-int termux_render_push_frame(const void *data, size_t stride_bytes);
+/**
+ * Copy a frame into the shared buffer, converting if its format differs from
+ * the shared buffer's. Only the damaged area is copied (damage may be NULL).
+ */
+int termux_render_push_frame(const void *data, uint32_t format, size_t stride_bytes,
+	int width, int height, const pixman_region32_t *damage);
+/** DRM format of the shared buffer (RGB565 or XRGB8888). */
+uint32_t termux_render_get_format(void);
+/**
+ * Ship the cursor image (ARGB8888, NULL to hide) and its position to the
+ * display client through the shared server state; the client draws it as an
+ * overlay on top of the last frame.
+ */
+int termux_render_set_cursor(const void *data, size_t stride_bytes,
+	int width, int height, int hotspot_x, int hotspot_y);
+int termux_render_move_cursor(int x, int y);
 void termux_render_get_size(int *width, int *height);
 bool termux_render_connected(void);
 int termux_render_get_conn_fd(void);
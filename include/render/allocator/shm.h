@@ -1,18 +1,57 @@
 #ifndef RENDER_ALLOCATOR_SHM_H
 #define RENDER_ALLOCATOR_SHM_H
 
+#include <wayland-util.h>
 #include <wlr/render/allocator.h>
 #include <wlr/types/wlr_buffer.h>
 
+struct wlr_shm_allocator;
+
+/**
+ * A free range of an arena.
+ */
+struct wlr_shm_extent {
+	size_t offset, size;
+};
+
+/**
+ * A large shared memory file mapped once, from which buffers are
+ * sub-allocated. Offsets are page-aligned so that consumers can mmap a single
+ * buffer.
+ *
+ * All buffers of an arena share its fd: whoever receives the fd of one buffer
+ * can map the others too.
+ */
+struct wlr_shm_arena {
+	struct wlr_shm_allocator *allocator;
+	struct wl_list link; // wlr_shm_allocator.arenas
+
+	int fd;
+	void *data;
+	size_t size;
+
+	size_t n_buffers;
+	size_t high_water; // end of the range ever handed out
+	struct wl_array free; // struct wlr_shm_extent, sorted by offset
+};
+
 struct wlr_shm_buffer {
 	struct wlr_buffer base;
 	struct wlr_shm_attributes shm;
+	struct wlr_shm_arena *arena;
 	void *data;
-	size_t size;
+	size_t size; // size of the slot in the arena, page-aligned
 };
 
 struct wlr_shm_allocator {
 	struct wlr_allocator base;
+
+	struct wl_list arenas; // wlr_shm_arena.link, most recent first
+	// The allocator outlives wlr_allocator_destroy() until all of its
+	// buffers have been released
+	bool destroyed;
+
+	struct wlr_shm_allocator_stats stats;
 };
 
 /**
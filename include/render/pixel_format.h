@@ -1,6 +1,8 @@
 #ifndef RENDER_PIXEL_FORMAT_H
 #define RENDER_PIXEL_FORMAT_H
 
+#include <stdatomic.h>
+#include <stddef.h>
 #include <wayland-server-protocol.h>
 
 /**
@@ -68,4 +70,23 @@ bool pixel_format_has_alpha(uint32_t fmt);
  */
 bool pixel_format_is_ycbcr(uint32_t fmt);
 
+#define PIXEL_FORMAT_INDEX_SIZE 256
+
+/**
+ * Hash index of a static table whose entries are keyed by DRM FourCC,
+ * built on first lookup. Zero-initialize to use.
+ */
+struct pixel_format_index {
+	atomic_int state; // 0 if not built, 1 while building, 2 once built
+	uint16_t slots[PIXEL_FORMAT_INDEX_SIZE]; // table index + 1, 0 if empty
+};
+
+/**
+ * Find the first entry of a table with the given DRM FourCC. The table has
+ * len entries of stride bytes, each with its FourCC as an uint32_t at offset
+ * bytes. Returns NULL if there is none.
+ */
+const void *pixel_format_index_find(struct pixel_format_index *index,
+	const void *table, size_t len, size_t stride, size_t offset, uint32_t fmt);
+
 #endif
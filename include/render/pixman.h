@@ -13,12 +13,14 @@ struct wlr_pixman_pixel_format {
 };
 
 struct wlr_pixman_buffer;
+struct wlr_pixman_color_transform;
 
 struct wlr_pixman_renderer {
 	struct wlr_renderer wlr_renderer;
 
 	struct wl_list buffers; // wlr_pixman_buffer.link
 	struct wl_list textures; // wlr_pixman_texture.link
+	struct wl_list color_transforms; // wlr_pixman_color_transform.link
 
 	struct wlr_drm_format_set drm_formats;
 };
@@ -33,6 +35,24 @@ struct wlr_pixman_buffer {
 	struct wl_list link; // wlr_pixman_renderer.buffers
 };
 
+// Number of pre-scaled copies kept per texture, e.g. one per output scale
+#define PIXMAN_TEXTURE_SCALED_LEN 4
+
+/**
+ * Copy of a texture scaled and transformed as in a previous draw, so that
+ * further draws with the same parameters are blits.
+ */
+struct wlr_pixman_scaled_texture {
+	pixman_image_t *image; // NULL until drawn twice the same way
+	struct wlr_box src_box;
+	int width, height;
+	enum wl_output_transform transform;
+	enum wlr_scale_filter_mode filter_mode;
+	// Texture-local damage which hasn't been re-scaled yet
+	pixman_region32_t damage;
+	uint64_t last_used; // 0 if the entry is unused
+};
+
 struct wlr_pixman_texture {
 	struct wlr_texture wlr_texture;
 	struct wlr_pixman_renderer *renderer;
@@ -44,21 +64,45 @@ struct wlr_pixman_texture {
 
 	void *data; // if created via texture_from_pixels
 	struct wlr_buffer *buffer; // if created via texture_from_buffer
+
+	struct wlr_pixman_scaled_texture scaled[PIXMAN_TEXTURE_SCALED_LEN];
+	uint64_t scaled_seq; // incremented on each scaled draw
 };
 
 struct wlr_pixman_render_pass {
 	struct wlr_render_pass base;
 	struct wlr_pixman_buffer *buffer;
+
+	// Applied to the area drawn by the pass on submit, NULL if none
+	struct wlr_pixman_color_transform *color_transform;
+	pixman_region32_t damage;
 };
 
 pixman_format_code_t get_pixman_format_from_drm(uint32_t fmt);
 uint32_t get_drm_format_from_pixman(pixman_format_code_t fmt);
 const uint32_t *get_pixman_drm_formats(size_t *len);
 
+void pixman_scaled_texture_reset(struct wlr_pixman_scaled_texture *scaled);
+
 bool begin_pixman_data_ptr_access(struct wlr_buffer *buffer, pixman_image_t **image_ptr,
 	uint32_t flags);
 
 struct wlr_pixman_render_pass *begin_pixman_render_pass(
-	struct wlr_pixman_buffer *buffer);
+	struct wlr_pixman_buffer *buffer,
+	struct wlr_pixman_color_transform *color_transform);
+
+/**
+ * Get the compiled form of a color transform for the renderer, compiling it
+ * on first use. Returns NULL on allocation failure.
+ */
+struct wlr_pixman_color_transform *pixman_color_transform_get(
+	struct wlr_pixman_renderer *renderer, struct wlr_color_transform *tr);
+void pixman_color_transform_destroy(struct wlr_pixman_color_transform *tr);
+bool pixman_color_transform_is_identity(struct wlr_pixman_color_transform *tr);
+/**
+ * Apply a color transform to a region of an image, in place.
+ */
+void pixman_color_transform_apply(struct wlr_pixman_color_transform *tr,
+	pixman_image_t *image, const pixman_region32_t *region);
 
 #endif
@@ -60,7 +60,7 @@ struct wlr_client_buffer *wlr_client_buffer_create(struct wlr_buffer *buffer,
  * Try to update the buffer's content.
  *
  * Fails if there's more than one reference to the buffer or if the texture
- * isn't mutable.
+ * isn't mutable. On success, the client buffer's source becomes next.
  */
 bool wlr_client_buffer_apply_damage(struct wlr_client_buffer *client_buffer,
 	struct wlr_buffer *next, const pixman_region32_t *damage);
@@ -70,5 +70,12 @@ bool wlr_client_buffer_apply_damage(struct wlr_client_buffer *client_buffer,
  * memory or a DMA-BUF, returns DRM_FORMAT_INVALID.
  */
 uint32_t buffer_get_drm_format(struct wlr_buffer *buffer);
+/**
+ * Return the pixel format information of the buffer, resolved once per
+ * buffer. Returns NULL if the format is unknown, or if this buffer isn't
+ * shared memory or a DMA-BUF.
+ */
+const struct wlr_pixel_format_info *buffer_get_format_info(
+	struct wlr_buffer *buffer);
 
 #endif
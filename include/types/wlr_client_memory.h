@@ -0,0 +1,58 @@
+#ifndef TYPES_WLR_CLIENT_MEMORY_H
+#define TYPES_WLR_CLIENT_MEMORY_H
+
+#include <wlr/types/wlr_client_memory.h>
+
+struct wlr_buffer;
+struct wlr_texture;
+
+enum wlr_client_memory_kind {
+	WLR_CLIENT_MEMORY_SHM,
+	WLR_CLIENT_MEMORY_DMABUF,
+	WLR_CLIENT_MEMORY_TEXTURE,
+};
+
+/**
+ * Per-client accounting record.
+ *
+ * Records are reference-counted: objects which charge memory keep a reference
+ * until they release it, so that records outlive both the client and the
+ * tracker.
+ */
+struct wlr_client_memory {
+	struct wlr_client_memory_tracker *tracker; // NULL if destroyed
+	struct wl_client *client; // NULL if destroyed
+	struct wlr_client_memory_usage usage;
+	size_t n_refs;
+
+	struct wl_list link; // wlr_client_memory_tracker.clients
+	struct wl_listener client_destroy;
+};
+
+/**
+ * Get the accounting record of a client and take a reference to it.
+ *
+ * Returns NULL if no tracker has been created for the client's display.
+ */
+struct wlr_client_memory *client_memory_get(struct wl_client *client);
+void client_memory_unref(struct wlr_client_memory *memory);
+
+/**
+ * Check whether a client may pin size more bytes without exceeding the
+ * budget. Accepts NULL.
+ */
+bool client_memory_check_budget(struct wlr_client_memory *memory, size_t size);
+
+void client_memory_charge(struct wlr_client_memory *memory,
+	enum wlr_client_memory_kind kind, size_t size);
+void client_memory_release(struct wlr_client_memory *memory,
+	enum wlr_client_memory_kind kind, size_t size);
+
+/**
+ * Estimate the number of bytes a texture created from a buffer occupies on
+ * top of the buffer's own storage.
+ */
+size_t client_memory_estimate_texture_size(struct wlr_texture *texture,
+	struct wlr_buffer *source);
+
+#endif
@@ -70,7 +70,7 @@ struct wlr_tablet_tool_client_v2 {
 	struct wlr_tablet_v2_tablet_tool *tool;
 	struct wlr_tablet_seat_client_v2 *seat;
 
-	struct wl_event_source *frame_source;
+	struct sched_task *frame_source;
 };
 
 struct wlr_tablet_client_v2 *tablet_client_from_resource(struct wl_resource *resource);
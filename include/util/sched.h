@@ -0,0 +1,70 @@
+#ifndef UTIL_SCHED_H
+#define UTIL_SCHED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+/**
+ * A small scheduling layer on top of the event loop's idle queue.
+ *
+ * Work posted with wl_event_loop_add_idle() runs in posting order, so a frame
+ * which should be rendered right after vblank can end up waiting behind
+ * protocol traffic. Tasks posted here carry a class and an optional deadline
+ * instead, and are dispatched from a single idle source per event loop:
+ *
+ * 1. Frame-critical tasks
+ * 2. Tasks of any other class whose deadline has passed, earliest first
+ * 3. Input, then protocol tasks
+ * 4. Background tasks, as long as the dispatch stays within its time budget;
+ *    the rest are deferred to the next event loop iteration so that pending
+ *    file descriptor events get serviced first
+ *
+ * Within a class, tasks with a deadline run earliest deadline first, before
+ * tasks without one, which run in posting order.
+ */
+enum sched_class {
+	SCHED_CLASS_FRAME,
+	SCHED_CLASS_INPUT,
+	SCHED_CLASS_PROTOCOL,
+	SCHED_CLASS_BACKGROUND,
+};
+
+#define SCHED_CLASS_COUNT (SCHED_CLASS_BACKGROUND + 1)
+
+struct sched_class_stats {
+	uint64_t tasks; // tasks run
+	uint64_t deadline_misses; // tasks run after their deadline
+	// Time between posting and running a task
+	int64_t total_latency_nsec, max_latency_nsec;
+};
+
+struct sched_task;
+
+typedef void (*sched_func_t)(void *data);
+
+/**
+ * Post a task to the event loop. The task runs once and is then destroyed.
+ *
+ * The deadline is an absolute CLOCK_MONOTONIC time in nanoseconds, or 0 for
+ * none.
+ *
+ * Returns NULL on allocation failure.
+ */
+struct sched_task *sched_post(struct wl_event_loop *loop,
+	enum sched_class class, int64_t deadline_nsec,
+	sched_func_t func, void *data);
+
+/**
+ * Cancel a task which hasn't run yet.
+ */
+void sched_task_cancel(struct sched_task *task);
+
+/**
+ * Get the latency statistics of a class. Returns false if nothing has been
+ * scheduled on this event loop.
+ */
+bool sched_get_stats(struct wl_event_loop *loop, enum sched_class class,
+	struct sched_class_stats *stats);
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef UTIL_TRACE_H
+#define UTIL_TRACE_H
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include "config.h"
+
+/**
+ * Binary tracing of compositor hot paths.
+ *
+ * Tracepoints record a timestamp, an event and a 32-bit argument into a
+ * per-thread ring buffer, which keeps the most recent events. Tracing is
+ * compiled in with the "tracing" build option and enabled at runtime by
+ * setting WLR_TRACE to a file path: the recorded events are written there at
+ * exit, in the Chrome trace event JSON format (which Perfetto and
+ * chrome://tracing can load).
+ *
+ * Without the build option, tracepoints compile to nothing and their
+ * arguments aren't evaluated.
+ */
+enum trace_event {
+	TRACE_SURFACE_COMMIT,
+	TRACE_SCENE_NODE_UPDATE,
+	TRACE_SCENE_RENDER_LIST,
+	TRACE_RENDER_PASS_BEGIN,
+	TRACE_RENDER_PASS_SUBMIT,
+	TRACE_RENDER_TEXTURE,
+	TRACE_RENDER_RECT,
+	TRACE_OUTPUT_FRAME,
+	TRACE_OUTPUT_COMMIT,
+	TRACE_OUTPUT_PRESENT,
+	TRACE_DRM_PAGE_FLIP,
+	TRACE_XWM_EVENT,
+	TRACE_INPUT_DISPATCH,
+};
+
+#define TRACE_EVENT_COUNT (TRACE_INPUT_DISPATCH + 1)
+
+enum trace_phase {
+	TRACE_PHASE_BEGIN,
+	TRACE_PHASE_END,
+	TRACE_PHASE_INSTANT,
+};
+
+#if HAVE_TRACING
+
+// 1 if enabled, 0 if disabled, -1 if WLR_TRACE hasn't been checked yet
+extern atomic_int trace_state;
+
+void trace_record(enum trace_event event, enum trace_phase phase, uint32_t arg);
+
+#define TRACE(event, phase, arg) \
+	do { \
+		if (atomic_load_explicit(&trace_state, memory_order_relaxed) != 0) { \
+			trace_record(event, phase, arg); \
+		} \
+	} while (0)
+
+#else
+
+#define TRACE(event, phase, arg) do {} while (0)
+
+#endif
+
+#define TRACE_BEGIN(event, arg) TRACE(event, TRACE_PHASE_BEGIN, arg)
+#define TRACE_END(event, arg) TRACE(event, TRACE_PHASE_END, arg)
+#define TRACE_INSTANT(event, arg) TRACE(event, TRACE_PHASE_INSTANT, arg)
+
+#endif
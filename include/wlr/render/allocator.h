@@ -9,6 +9,7 @@
 #ifndef WLR_ALLOCATOR_H
 #define WLR_ALLOCATOR_H
 
+#include <stddef.h>
 #include <wayland-server-core.h>
 
 struct wlr_allocator;
@@ -77,4 +78,28 @@ void wlr_allocator_destroy(struct wlr_allocator *alloc);
 struct wlr_buffer *wlr_allocator_create_buffer(struct wlr_allocator *alloc,
 	int width, int height, const struct wlr_drm_format *format);
 
+/**
+ * Statistics of a shared memory allocator.
+ *
+ * Buffers are sub-allocated from large shared memory arenas, and the space of
+ * released buffers is recycled for later allocations.
+ */
+struct wlr_shm_allocator_stats {
+	size_t arenas, arena_bytes;
+	size_t live_buffers, live_bytes;
+
+	// Cumulative counters
+	size_t allocations; // buffers created
+	size_t recycled; // buffers placed in previously released space
+	size_t arena_allocations; // shared memory files created
+};
+
+/**
+ * Get the statistics of a shared memory allocator.
+ *
+ * Returns false if the allocator isn't a shared memory allocator.
+ */
+bool wlr_allocator_get_shm_stats(struct wlr_allocator *alloc,
+	struct wlr_shm_allocator_stats *stats);
+
 #endif
@@ -21,7 +21,7 @@ struct wlr_drm_format {
 	size_t len;
 	// The capacity of the array; do not use.
 	size_t capacity;
-	// The actual modifiers
+	// The actual modifiers, sorted in ascending order
 	uint64_t *modifiers;
 };
 
@@ -47,6 +47,9 @@ void wlr_drm_format_finish(struct wlr_drm_format *format);
  *
  * Users must not assume that implicit modifiers are supported unless INVALID
  * is listed in the modifier list.
+ *
+ * Formats are kept sorted by format code, and the modifiers of each format in
+ * ascending order. Sets must only be modified with the functions below.
  */
 struct wlr_drm_format_set {
 	// The number of formats
@@ -16,6 +16,8 @@
 
 struct wlr_buffer;
 struct wlr_renderer;
+struct wlr_client_memory;
+struct wlr_pixel_format_info;
 
 /**
  * Shared-memory attributes for a buffer.
@@ -63,6 +65,12 @@ struct wlr_buffer {
 	} events;
 
 	struct wlr_addon_set addons;
+
+	struct {
+		// Cached by buffer_get_drm_format(), a buffer's format never changes
+		uint32_t drm_format; // DRM_FORMAT_INVALID if not resolved yet
+		const struct wlr_pixel_format_info *format_info;
+	} WLR_PRIVATE;
 };
 
 /**
@@ -172,6 +180,9 @@ struct wlr_client_buffer {
 		struct wl_listener renderer_destroy;
 
 		size_t n_ignore_locks;
+
+		struct wlr_client_memory *memory; // may be NULL
+		size_t memory_size;
 	} WLR_PRIVATE;
 };
 
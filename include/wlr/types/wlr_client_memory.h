@@ -0,0 +1,83 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_CLIENT_MEMORY_H
+#define WLR_TYPES_WLR_CLIENT_MEMORY_H
+
+#include <stddef.h>
+#include <wayland-server-core.h>
+
+/**
+ * Memory pinned by a single client, in bytes.
+ */
+struct wlr_client_memory_usage {
+	size_t shm; // mapped wl_shm pools
+	size_t dmabuf; // imported linux-dmabuf buffers
+	size_t texture; // renderer textures backing the client's surfaces
+
+	size_t total;
+};
+
+/**
+ * Per-client memory accounting.
+ *
+ * Once created, wlr_shm, wlr_linux_dmabuf_v1 and wlr_compositor report the
+ * memory pinned by each client to the tracker. Texture sizes are estimated
+ * from the buffer format and size, depending on whether the renderer copies
+ * the buffer contents or imports them directly.
+ *
+ * If a budget is set, new wl_shm pools, pool resizes and dmabuf imports which
+ * would bring a client over the budget fail with a no_memory protocol error.
+ *
+ * Only one tracker can exist per display.
+ */
+struct wlr_client_memory_tracker {
+	// Maximum total number of bytes a single client may pin, 0 if unlimited
+	size_t budget;
+
+	struct {
+		struct wl_signal update; // struct wlr_client_memory_update_event
+		struct wl_signal destroy;
+	} events;
+
+	void *data;
+
+	struct {
+		struct wl_list clients; // wlr_client_memory.link
+
+		struct wl_listener display_destroy;
+	} WLR_PRIVATE;
+};
+
+struct wlr_client_memory_update_event {
+	struct wl_client *client;
+	const struct wlr_client_memory_usage *usage;
+};
+
+struct wlr_client_memory_tracker *wlr_client_memory_tracker_create(
+	struct wl_display *display);
+
+/**
+ * Set the per-client memory budget in bytes. Zero disables the budget.
+ *
+ * Clients already over the budget are not disconnected, but further
+ * allocations will fail.
+ */
+void wlr_client_memory_tracker_set_budget(
+	struct wlr_client_memory_tracker *tracker, size_t budget);
+
+/**
+ * Get the current memory usage of a client.
+ *
+ * Returns false if nothing has been accounted for this client so far, in which
+ * case the usage is zeroed.
+ */
+bool wlr_client_memory_tracker_get_usage(struct wlr_client_memory_tracker *tracker,
+	const struct wl_client *client, struct wlr_client_memory_usage *usage);
+
+#endif
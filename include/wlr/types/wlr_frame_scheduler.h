@@ -0,0 +1,99 @@
+/*
+ * This an unstable interface of wlroots. No guarantees are made regarding the
+ * future consistency of this API.
+ */
+#ifndef WLR_USE_UNSTABLE
+#error "Add -DWLR_USE_UNSTABLE to enable unstable wlroots features"
+#endif
+
+#ifndef WLR_TYPES_WLR_FRAME_SCHEDULER_H
+#define WLR_TYPES_WLR_FRAME_SCHEDULER_H
+
+#include <stdint.h>
+#include <wayland-server-core.h>
+
+struct wlr_output;
+
+#define WLR_FRAME_SCHEDULER_SAMPLES 32
+
+/**
+ * Helper to start rendering as late as possible before the next vblank.
+ *
+ * By default compositors render on the struct wlr_output frame event, which
+ * is emitted right after the previous frame has been presented, so a whole
+ * refresh cycle worth of input is left waiting. The frame scheduler learns
+ * how long the compositor takes to produce a frame, and delays its own frame
+ * event to the predicted start time: the next vblank minus the predicted
+ * render time minus a safety margin.
+ *
+ * Compositors listen to the frame event of the scheduler instead of the one
+ * of the output. The time between the frame event and the output commit is
+ * measured automatically. Compositors measuring GPU time with
+ * struct wlr_render_timer or struct wlr_scene_timer should report it with
+ * wlr_frame_scheduler_add_render_time().
+ *
+ * The frame event is emitted right away when the refresh cycle isn't known
+ * (no presentation feedback, adaptive sync), while the render time is still
+ * being learned, and for a while after frames have missed their vblank.
+ *
+ * The scheduler is destroyed with its output.
+ */
+struct wlr_frame_scheduler {
+	struct wlr_output *output;
+
+	// Time left between the predicted end of rendering and the vblank
+	int64_t margin_nsec;
+
+	struct {
+		struct wl_signal frame;
+		struct wl_signal destroy;
+	} events;
+
+	struct {
+		struct wl_event_source *timer;
+
+		int64_t samples[WLR_FRAME_SCHEDULER_SAMPLES]; // nsec
+		size_t samples_len, samples_next;
+
+		int64_t frame_nsec; // frame event of the frame in flight, 0 if none
+		int64_t target_nsec; // vblank targeted by the frame in flight
+		uint32_t target_commit_seq;
+		bool target_pending;
+
+		int64_t last_present_nsec, refresh_nsec;
+		int missed; // consecutive missed vblanks
+		int fallback_frames; // frames left without delay
+
+		struct wl_listener output_frame;
+		struct wl_listener output_commit;
+		struct wl_listener output_present;
+		struct wl_listener output_destroy;
+	} WLR_PRIVATE;
+};
+
+/**
+ * Create a frame scheduler for an output.
+ */
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(struct wlr_output *output);
+
+/**
+ * Destroy the frame scheduler.
+ */
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler);
+
+/**
+ * Report the render time of the last frame, for instance the GPU time
+ * measured with struct wlr_render_timer. The longest of this and the
+ * automatically measured time is used for prediction.
+ */
+void wlr_frame_scheduler_add_render_time(struct wlr_frame_scheduler *scheduler,
+	int64_t duration_nsec);
+
+/**
+ * Get the predicted render time, in nanoseconds. Returns -1 if not enough
+ * frames have been measured yet.
+ */
+int64_t wlr_frame_scheduler_get_predicted_render_time(
+	struct wlr_frame_scheduler *scheduler);
+
+#endif
@@ -17,6 +17,7 @@
 #include <wlr/render/drm_format_set.h>
 
 struct wlr_surface;
+struct wlr_client_memory;
 
 struct wlr_dmabuf_v1_buffer {
 	struct wlr_buffer base;
@@ -26,6 +27,9 @@ struct wlr_dmabuf_v1_buffer {
 
 	struct {
 		struct wl_listener release;
+
+		struct wlr_client_memory *memory; // may be NULL
+		size_t memory_size;
 	} WLR_PRIVATE;
 };
 
@@ -59,6 +63,7 @@ struct wlr_linux_dmabuf_v1 {
 		struct wlr_linux_dmabuf_feedback_v1_compiled *default_feedback;
 		struct wlr_drm_format_set default_formats; // for legacy clients
 		struct wl_list surfaces; // wlr_linux_dmabuf_v1_surface.link
+		struct wl_list compiled_feedbacks; // wlr_linux_dmabuf_feedback_v1_compiled.link
 
 		int main_device_fd; // to sanity check FDs sent by clients, -1 if unavailable
 
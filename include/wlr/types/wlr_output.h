@@ -245,9 +245,6 @@ struct wlr_output {
 		struct wl_signal destroy;
 	} events;
 
-	struct wl_event_source *idle_frame;
-	struct wl_event_source *idle_done;
-
 	int attach_render_locks; // number of locks forcing rendering
 
 	struct wl_list cursors; // wlr_output_cursor.link
@@ -271,6 +268,9 @@ struct wlr_output {
 		struct wlr_output_image_description image_description_value;
 		struct wlr_color_transform *color_transform;
 		struct wlr_color_primaries default_primaries_value;
+
+		struct sched_task *idle_frame;
+		struct sched_task *idle_done;
 	} WLR_PRIVATE;
 };
 
@@ -39,6 +39,7 @@ struct wlr_surface;
 struct wlr_scene_node;
 struct wlr_scene_buffer;
 struct wlr_scene_output_layout;
+struct wlr_scene_output_layers;
 
 struct wlr_presentation;
 struct wlr_linux_dmabuf_v1;
@@ -92,6 +93,15 @@ struct wlr_scene_tree {
 	struct wlr_scene_node node;
 
 	struct wl_list children; // wlr_scene_node.link
+
+	struct {
+		// Union of the boxes of all enabled descendants, relative to the tree
+		pixman_region32_t bounds;
+		// Extents of the visible regions of all enabled descendants, in
+		// scene-layout coordinates. May be larger than necessary.
+		pixman_box32_t visible_extents;
+		bool bounds_dirty, visible_dirty;
+	} WLR_PRIVATE;
 };
 
 /** The root scene-graph node. */
@@ -106,6 +116,21 @@ struct wlr_scene {
 	struct wlr_color_manager_v1 *color_manager_v1;
 
 	bool restack_xwayland_surfaces;
+	/**
+	 * If true, wlr_scene_output_send_frame_done() only visits buffers which
+	 * requested a frame_done event via wlr_scene_buffer_request_frame_done(),
+	 * instead of walking the whole scene-graph. Its cost then depends on the
+	 * number of surfaces waiting for frame callbacks rather than on the size
+	 * of the scene-graph.
+	 *
+	 * Scene surfaces request frame_done events automatically. Compositors
+	 * which listen to frame_done on their own buffers must call
+	 * wlr_scene_buffer_request_frame_done() for them before each frame, or
+	 * they stop receiving the event. Because of this, the option defaults to
+	 * false. Compositors which only rely on scene surfaces, or which request
+	 * frame_done events for their other buffers, should set it.
+	 */
+	bool frame_done_on_request;
 
 	struct {
 		struct wl_listener linux_dmabuf_v1_destroy;
@@ -117,6 +142,11 @@ struct wlr_scene {
 		bool direct_scanout;
 		bool calculate_visibility;
 		bool highlight_transparent_region;
+
+		int transaction_depth;
+		pixman_region32_t transaction_update_region;
+		pixman_region32_t transaction_damage;
+		struct wl_array transaction_nodes; // struct wlr_scene_node *
 	} WLR_PRIVATE;
 };
 
@@ -128,6 +158,13 @@ struct wlr_scene_surface {
 	struct {
 		struct wlr_box clip;
 
+		// Surface geometry last applied to the scene buffer, used to skip
+		// reconfiguring it on commits which only change the contents
+		bool geometry_valid;
+		int width, height;
+		int buffer_width, buffer_height;
+		bool has_buffer, opaque;
+
 		struct wlr_addon addon;
 
 		struct wl_listener outputs_update;
@@ -200,6 +237,8 @@ struct wlr_scene_buffer {
 
 	struct {
 		uint64_t active_outputs;
+		// Bitmask of wlr_scene_output.index with a pending frame done request
+		uint64_t frame_done_outputs;
 		struct wlr_texture *texture;
 		struct wlr_linux_dmabuf_feedback_v1_init_options prev_feedback_options;
 
@@ -250,6 +289,14 @@ struct wlr_scene_output {
 		uint8_t dmabuf_feedback_debounce;
 		bool prev_scanout;
 
+		// DMA-BUF feedback shared by all buffers on this output, for
+		// composition and for direct scan-out respectively
+		struct {
+			bool valid;
+			struct wlr_renderer *renderer;
+			struct wlr_linux_dmabuf_feedback_v1 feedback;
+		} dmabuf_feedback_cache[2];
+
 		bool gamma_lut_changed;
 		struct wlr_gamma_control_v1 *gamma_lut;
 		struct wlr_color_transform *gamma_lut_color_transform;
@@ -265,6 +312,10 @@ struct wlr_scene_output {
 		struct wl_list damage_highlight_regions;
 
 		struct wl_array render_list;
+		struct wl_array frame_done_buffers; // struct wlr_scene_buffer *
+
+		// Output layers used to offload the topmost buffers, may be NULL
+		struct wlr_scene_output_layers *layers;
 
 		struct wlr_drm_syncobj_timeline *in_timeline;
 		uint64_t in_point;
@@ -356,6 +407,24 @@ struct wlr_scene_node *wlr_scene_node_at(struct wlr_scene_node *node,
  * destroyed through wlr_scene_node_destroy().
  */
 struct wlr_scene *wlr_scene_create(void);
+/**
+ * Start a transaction on the scene-graph.
+ *
+ * Until the transaction is committed, changes to the scene-graph do not
+ * update node visibility, output enter/leave events and output damage one
+ * change at a time: the affected regions are accumulated and processed at
+ * once by wlr_scene_transaction_commit(). This avoids redundant work when
+ * many nodes are updated together, e.g. when re-arranging a layout.
+ *
+ * Transactions can be nested, only the outermost commit applies the changes.
+ * Node visibility is stale while a transaction is open, so the scene-graph
+ * must not be rendered before it is committed.
+ */
+void wlr_scene_transaction_begin(struct wlr_scene *scene);
+/**
+ * Commit a transaction started with wlr_scene_transaction_begin().
+ */
+void wlr_scene_transaction_commit(struct wlr_scene *scene);
 
 /**
  * Handles linux_dmabuf_v1 feedback for all surfaces in the scene.
@@ -576,6 +645,17 @@ void wlr_scene_buffer_set_color_range(struct wlr_scene_buffer *scene_buffer,
 void wlr_scene_buffer_send_frame_done(struct wlr_scene_buffer *scene_buffer,
 	struct wlr_scene_frame_done_event *event);
 
+/**
+ * Request a frame_done event on the next call to
+ * wlr_scene_output_send_frame_done() for the given output in which the buffer
+ * is visible. Does nothing unless wlr_scene.frame_done_on_request is set.
+ *
+ * Scene surfaces request frame_done events automatically when the surface has
+ * pending frame callbacks.
+ */
+void wlr_scene_buffer_request_frame_done(struct wlr_scene_buffer *scene_buffer,
+	struct wlr_scene_output *scene_output);
+
 /**
  * Add a viewport for the specified output to the scene-graph.
  *
@@ -608,6 +688,17 @@ struct wlr_scene_output_state_options {
 	 * wlr_output_state or output size if not specified.
 	 */
 	struct wlr_swapchain *swapchain;
+
+	/**
+	 * Display the topmost buffers on output layers when direct scan-out isn't
+	 * possible, and composite the rest. Only set this if the backend actually
+	 * presents the output layers it accepts, since each attempt costs a test
+	 * commit. The Wayland backend presents them as sub-surfaces of the output
+	 * window when the parent compositor supports the buffer, so nested
+	 * compositors should set this for outputs where wlr_output_is_wl() is
+	 * true. The DRM backend presents them as KMS planes with libliftoff.
+	 */
+	bool offload_layers;
 };
 
 /**
@@ -641,6 +732,10 @@ void wlr_scene_timer_finish(struct wlr_scene_timer *timer);
  * Call wlr_surface_send_frame_done() on all surfaces in the scene rendered by
  * wlr_scene_output_commit() for which wlr_scene_surface.primary_output
  * matches the given scene_output.
+ *
+ * If wlr_scene.frame_done_on_request is set, only buffers which have
+ * requested a frame_done event for this output via
+ * wlr_scene_buffer_request_frame_done() are visited.
  */
 void wlr_scene_output_send_frame_done(struct wlr_scene_output *scene_output,
 	struct timespec *now);
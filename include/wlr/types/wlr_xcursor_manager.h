@@ -31,6 +31,16 @@ struct wlr_xcursor_manager {
 	char *name;
 	uint32_t size;
 	struct wl_list scaled_themes; // wlr_xcursor_manager_theme.link
+
+	struct {
+		// Emitted when themes loaded by wlr_xcursor_manager_load_async()
+		// have been added to scaled_themes
+		struct wl_signal load;
+	} events;
+
+	struct {
+		struct wl_list loads; // xcursor_manager_load.link
+	} WLR_PRIVATE;
 };
 
 /**
@@ -48,6 +58,23 @@ void wlr_xcursor_manager_destroy(struct wlr_xcursor_manager *manager);
 bool wlr_xcursor_manager_load(struct wlr_xcursor_manager *manager,
 	float scale);
 
+/**
+ * Starts loading xcursor themes at the given scale factors in a worker thread,
+ * so that the event loop isn't blocked while the cursor images are decoded.
+ * All scales are loaded together, see wlr_xcursor_theme_load_sizes(). Scales
+ * which are already loaded or being loaded are skipped.
+ *
+ * Once done, the themes are added to the manager from the event loop and the
+ * load event is emitted. Calling wlr_xcursor_manager_load() for a scale which
+ * is still being loaded waits for the worker thread instead; the themes are
+ * then added without emitting the load event. The same happens if the event
+ * loop is destroyed before the worker thread is done.
+ *
+ * Returns false on error.
+ */
+bool wlr_xcursor_manager_load_async(struct wlr_xcursor_manager *manager,
+	struct wl_event_loop *loop, const float *scales, size_t scales_len);
+
 /**
  * Retrieves a wlr_xcursor reference for the given cursor name at the given
  * scale factor, or NULL if this struct wlr_xcursor_manager has not loaded a
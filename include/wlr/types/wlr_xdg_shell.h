@@ -290,7 +290,6 @@ struct wlr_xdg_surface {
 	struct wl_list popups; // wlr_xdg_popup.link
 
 	bool configured;
-	struct wl_event_source *configure_idle;
 	uint32_t scheduled_serial;
 	struct wl_list configure_list;
 
@@ -317,6 +316,7 @@ struct wlr_xdg_surface {
 
 	struct {
 		struct wlr_surface_synced synced;
+		struct sched_task *configure_idle;
 
 		struct wl_listener role_resource_destroy;
 	} WLR_PRIVATE;
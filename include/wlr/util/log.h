@@ -18,6 +18,7 @@
 
 #include <stdbool.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <string.h>
 #include <errno.h>
 
@@ -48,6 +49,36 @@ void wlr_log_init(enum wlr_log_importance verbosity, wlr_log_func_t callback);
  */
 enum wlr_log_importance wlr_log_get_verbosity(void);
 
+/**
+ * Log callback writing to stderr from a background thread, with the same
+ * output as the default logger. Pass it to wlr_log_init() to use it.
+ *
+ * Messages are formatted on the calling thread and queued in a lock-free
+ * ring, so logging never waits for stderr. Messages logged while the ring is
+ * full are dropped and counted. Messages longer than 1 KiB are truncated.
+ *
+ * If the background thread can't be started, messages are written directly.
+ */
+void wlr_log_async_stderr(enum wlr_log_importance importance,
+	const char *fmt, va_list args);
+
+/**
+ * Write out messages queued by wlr_log_async_stderr() from the calling
+ * thread, without waiting for the background thread.
+ *
+ * This only uses async-signal-safe functions and can be called from a crash
+ * handler. Messages the background thread is still writing may be lost.
+ * Queued messages are flushed automatically at exit, after waiting for the
+ * background thread.
+ */
+void wlr_log_async_flush(void);
+
+/**
+ * Get the number of messages dropped by wlr_log_async_stderr() because the
+ * queue was full.
+ */
+uint64_t wlr_log_async_get_dropped(void);
+
 #ifdef __GNUC__
 #define _WLR_ATTRIB_PRINTF(start, end) __attribute__((format(printf, start, end)))
 #else
@@ -41,6 +41,8 @@
 #ifndef WLR_XCURSOR_H
 #define WLR_XCURSOR_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <wlr/util/edges.h>
 
@@ -72,6 +74,10 @@ struct wlr_xcursor {
 	struct wlr_xcursor_image **images;
 	char *name;
 	uint32_t total_delay; /* total duration of the animation in ms */
+
+	struct {
+		size_t n_refs; /* number of themes holding the cursor */
+	} WLR_PRIVATE;
 };
 
 /**
@@ -101,6 +107,20 @@ struct wlr_xcursor_theme {
  */
 struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size);
 
+/**
+ * Loads the named Xcursor theme at several sizes at once, and stores the theme
+ * loaded at sizes[i] in themes[i].
+ *
+ * This is faster than loading each size separately: each cursor file is only
+ * read once, and cursors whose file provides the same images for several of
+ * the sizes are shared between the themes.
+ *
+ * This function doesn't use any global state, so it may be called from any
+ * thread. Returns false on error.
+ */
+bool wlr_xcursor_theme_load_sizes(const char *name, const int *sizes,
+	size_t sizes_len, struct wlr_xcursor_theme **themes);
+
 /**
  * Destroy a cursor theme.
  *
@@ -10,6 +10,7 @@
 #define WLR_XWAYLAND_SERVER_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <time.h>
 #include <wayland-server-core.h>
@@ -20,6 +21,10 @@ struct wlr_xwayland_server_options {
 	bool no_touch_pointer_emulation;
 	bool force_xrandr_emulation;
 	int terminate_delay; // in seconds, 0 to terminate immediately
+	// In lazy mode, start Xwayland in the background after this delay in
+	// milliseconds even if no X11 client has connected yet, so that the first
+	// one doesn't wait for Xwayland to start. 0 to only start on demand.
+	int prespawn_delay;
 };
 
 struct wlr_xwayland_server {
@@ -53,6 +58,11 @@ struct wlr_xwayland_server {
 	struct {
 		struct wl_listener client_destroy;
 		struct wl_listener display_destroy;
+
+		struct wl_event_source *prespawn_timer;
+
+		// Startup timestamps in CLOCK_MONOTONIC nanoseconds, 0 if not reached
+		int64_t start_nsec, spawned_nsec, ready_nsec;
 	} WLR_PRIVATE;
 };
 
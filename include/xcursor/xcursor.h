@@ -26,6 +26,7 @@
 #ifndef XCURSOR_H
 #define XCURSOR_H
 
+#include <stddef.h>
 #include <stdint.h>
 
 struct xcursor_image {
@@ -51,8 +52,11 @@ struct xcursor_images {
 void
 xcursor_images_destroy(struct xcursor_images *images);
 
+typedef void (*xcursor_load_callback_t)(struct xcursor_images **images,
+					void *user_data);
+
 void
-xcursor_load_theme(const char *theme, int size,
-		   void (*load_callback)(struct xcursor_images *, void *),
+xcursor_load_theme(const char *theme, const int *sizes, size_t nsizes,
+		   xcursor_load_callback_t load_callback,
 		   void *user_data);
 #endif
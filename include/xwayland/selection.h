@@ -5,7 +5,10 @@
 #include <xcb/xfixes.h>
 #include <wayland-util.h>
 
+// Selection data is sent in chunks as large as the X server accepts in a
+// single request, between these bounds
 #define INCR_CHUNK_SIZE (64 * 1024)
+#define INCR_MAX_CHUNK_SIZE (1024 * 1024)
 
 #define XDND_VERSION 5
 
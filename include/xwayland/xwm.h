@@ -122,6 +122,7 @@ struct wlr_xwm {
 	xcb_render_pictformat_t render_format_id;
 	xcb_cursor_t cursor;
 
+	size_t incr_chunk_size; // largest selection chunk sent in one property
 	struct wlr_xwm_selection clipboard_selection;
 	struct wlr_xwm_selection primary_selection;
 	struct wlr_xwm_selection dnd_selection;
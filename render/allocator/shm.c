@@ -1,6 +1,9 @@
+#undef _POSIX_C_SOURCE
+#define _DEFAULT_SOURCE // for madvise() and MADV_REMOVE
 #include <assert.h>
 #include <drm_fourcc.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <wlr/interfaces/wlr_buffer.h>
@@ -12,8 +15,228 @@
 #include "render/allocator/shm.h"
 #include "util/shm.h"
 
+// Minimum size of a shared memory file holding buffers
+#define ARENA_SIZE (32 * 1024 * 1024)
+
 static const struct wlr_buffer_impl buffer_impl;
 
+static size_t get_page_size(void) {
+	static size_t page_size = 0;
+	if (page_size == 0) {
+		long ret = sysconf(_SC_PAGESIZE);
+		page_size = ret > 0 ? (size_t)ret : 4096;
+	}
+	return page_size;
+}
+
+static struct wlr_shm_arena *arena_create(struct wlr_shm_allocator *allocator,
+		size_t size) {
+	struct wlr_shm_arena *arena = calloc(1, sizeof(*arena));
+	if (arena == NULL) {
+		return NULL;
+	}
+
+	arena->fd = allocate_shm_file(size);
+	if (arena->fd < 0) {
+		free(arena);
+		return NULL;
+	}
+
+	arena->data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		arena->fd, 0);
+	if (arena->data == MAP_FAILED) {
+		wlr_log_errno(WLR_ERROR, "mmap failed");
+		close(arena->fd);
+		free(arena);
+		return NULL;
+	}
+
+	wl_array_init(&arena->free);
+	struct wlr_shm_extent *extent = wl_array_add(&arena->free, sizeof(*extent));
+	if (extent == NULL) {
+		munmap(arena->data, size);
+		close(arena->fd);
+		free(arena);
+		return NULL;
+	}
+	*extent = (struct wlr_shm_extent){ .offset = 0, .size = size };
+
+	arena->allocator = allocator;
+	arena->size = size;
+	wl_list_insert(&allocator->arenas, &arena->link);
+
+	allocator->stats.arenas++;
+	allocator->stats.arena_bytes += size;
+	allocator->stats.arena_allocations++;
+	return arena;
+}
+
+static void arena_destroy(struct wlr_shm_arena *arena) {
+	struct wlr_shm_allocator *allocator = arena->allocator;
+	allocator->stats.arenas--;
+	allocator->stats.arena_bytes -= arena->size;
+
+	munmap(arena->data, arena->size);
+	close(arena->fd);
+	wl_array_release(&arena->free);
+	wl_list_remove(&arena->link);
+	free(arena);
+}
+
+static void arena_take(struct wlr_shm_arena *arena, size_t index, size_t size,
+		size_t *offset) {
+	struct wlr_shm_extent *extents = arena->free.data;
+	struct wlr_shm_extent *extent = &extents[index];
+	*offset = extent->offset;
+
+	extent->offset += size;
+	extent->size -= size;
+	if (extent->size == 0) {
+		size_t n = arena->free.size / sizeof(*extent);
+		memmove(extent, extent + 1, (n - index - 1) * sizeof(*extent));
+		arena->free.size -= sizeof(*extent);
+	}
+	arena->n_buffers++;
+}
+
+/**
+ * Give a range back to the arena, merging it with adjacent free ranges.
+ */
+static bool arena_release(struct wlr_shm_arena *arena, size_t offset,
+		size_t size) {
+	struct wlr_shm_extent *extents = arena->free.data;
+	size_t n = arena->free.size / sizeof(*extents);
+	size_t index = 0;
+	while (index < n && extents[index].offset < offset) {
+		index++;
+	}
+
+	bool merge_prev = index > 0 &&
+		extents[index - 1].offset + extents[index - 1].size == offset;
+	bool merge_next = index < n && offset + size == extents[index].offset;
+	if (merge_prev && merge_next) {
+		extents[index - 1].size += size + extents[index].size;
+		memmove(&extents[index], &extents[index + 1],
+			(n - index - 1) * sizeof(*extents));
+		arena->free.size -= sizeof(*extents);
+	} else if (merge_prev) {
+		extents[index - 1].size += size;
+	} else if (merge_next) {
+		extents[index].offset = offset;
+		extents[index].size += size;
+	} else {
+		if (wl_array_add(&arena->free, sizeof(*extents)) == NULL) {
+			return false;
+		}
+		extents = arena->free.data;
+		memmove(&extents[index + 1], &extents[index],
+			(n - index) * sizeof(*extents));
+		extents[index] = (struct wlr_shm_extent){
+			.offset = offset,
+			.size = size,
+		};
+	}
+
+	arena->n_buffers--;
+	return true;
+}
+
+/**
+ * Give the pages backing a released range back to the kernel. The range reads
+ * back as zeroes once it is handed out again.
+ */
+static void arena_discard(struct wlr_shm_arena *arena, size_t offset,
+		size_t size) {
+#ifdef MADV_REMOVE
+	if (madvise((char *)arena->data + offset, size, MADV_REMOVE) != 0) {
+		wlr_log_errno(WLR_DEBUG, "madvise(MADV_REMOVE) failed");
+	}
+#endif
+}
+
+static void allocator_maybe_finish(struct wlr_shm_allocator *allocator) {
+	if (allocator->destroyed && wl_list_empty(&allocator->arenas)) {
+		free(allocator);
+	}
+}
+
+/**
+ * Find a slot of the requested size, preferring the smallest free range so
+ * that the space of a released buffer goes to a buffer of the same size.
+ */
+static struct wlr_shm_arena *allocator_alloc(struct wlr_shm_allocator *allocator,
+		size_t size, size_t *offset) {
+	struct wlr_shm_arena *best_arena = NULL;
+	size_t best_index = 0, best_size = 0;
+	struct wlr_shm_arena *arena;
+	wl_list_for_each(arena, &allocator->arenas, link) {
+		struct wlr_shm_extent *extents = arena->free.data;
+		size_t n = arena->free.size / sizeof(*extents);
+		for (size_t i = 0; i < n; i++) {
+			if (extents[i].size < size ||
+					(best_arena != NULL && extents[i].size >= best_size)) {
+				continue;
+			}
+			best_arena = arena;
+			best_index = i;
+			best_size = extents[i].size;
+			if (best_size == size) {
+				goto found;
+			}
+		}
+	}
+
+found:
+	if (best_arena != NULL) {
+		struct wlr_shm_extent *extents = best_arena->free.data;
+		bool recycled = extents[best_index].offset < best_arena->high_water;
+		arena_take(best_arena, best_index, size, offset);
+		if (recycled) {
+			allocator->stats.recycled++;
+		}
+	} else {
+		best_arena = arena_create(allocator, size > ARENA_SIZE ? size : ARENA_SIZE);
+		if (best_arena == NULL) {
+			return NULL;
+		}
+		arena_take(best_arena, 0, size, offset);
+	}
+
+	if (*offset + size > best_arena->high_water) {
+		best_arena->high_water = *offset + size;
+	}
+	return best_arena;
+}
+
+static void allocator_free(struct wlr_shm_allocator *allocator,
+		struct wlr_shm_arena *arena, size_t offset, size_t size) {
+	if (!arena_release(arena, offset, size)) {
+		// Leak the range rather than handing it out twice
+		wlr_log(WLR_ERROR, "Failed to release shm buffer range");
+		arena->n_buffers--;
+	}
+
+	if (arena->n_buffers == 0 && allocator->destroyed) {
+		arena_destroy(arena);
+		allocator_maybe_finish(allocator);
+		return;
+	}
+
+	arena_discard(arena, offset, size);
+	if (arena->n_buffers > 0) {
+		return;
+	}
+
+	// Keep a single empty arena around to absorb resize storms, give the
+	// memory of the others back to the kernel
+	struct wlr_shm_arena *other, *tmp;
+	wl_list_for_each_safe(other, tmp, &allocator->arenas, link) {
+		if (other != arena && other->n_buffers == 0) {
+			arena_destroy(other);
+		}
+	}
+}
+
 static struct wlr_shm_buffer *shm_buffer_from_buffer(
 		struct wlr_buffer *wlr_buffer) {
 	assert(wlr_buffer->impl == &buffer_impl);
@@ -23,9 +246,13 @@ static struct wlr_shm_buffer *shm_buffer_from_buffer(
 
 static void buffer_destroy(struct wlr_buffer *wlr_buffer) {
 	struct wlr_shm_buffer *buffer = shm_buffer_from_buffer(wlr_buffer);
+	struct wlr_shm_arena *arena = buffer->arena;
+	struct wlr_shm_allocator *allocator = arena->allocator;
 	wlr_buffer_finish(wlr_buffer);
-	munmap(buffer->data, buffer->size);
-	close(buffer->shm.fd);
+
+	allocator->stats.live_buffers--;
+	allocator->stats.live_bytes -= buffer->size;
+	allocator_free(allocator, arena, buffer->shm.offset, buffer->size);
 	free(buffer);
 }
 
@@ -66,41 +293,55 @@ static struct wlr_buffer *allocator_create_buffer(
 		return NULL;
 	}
 
+	struct wlr_shm_allocator *allocator =
+		wl_container_of(wlr_allocator, allocator, base);
+
+	int stride = pixel_format_info_min_stride(info, width); // TODO: align?
+	size_t page_size = get_page_size();
+	size_t size = (size_t)stride * height;
+	size = (size + page_size - 1) / page_size * page_size;
+
 	struct wlr_shm_buffer *buffer = calloc(1, sizeof(*buffer));
 	if (buffer == NULL) {
 		return NULL;
 	}
-	wlr_buffer_init(&buffer->base, &buffer_impl, width, height);
 
-	// TODO: consider using a single file for multiple buffers
-	int stride = pixel_format_info_min_stride(info, width); // TODO: align?
-	buffer->size = stride * height;
-	buffer->shm.fd = allocate_shm_file(buffer->size);
-	if (buffer->shm.fd < 0) {
+	size_t offset;
+	buffer->arena = allocator_alloc(allocator, size, &offset);
+	if (buffer->arena == NULL) {
 		free(buffer);
 		return NULL;
 	}
+	wlr_buffer_init(&buffer->base, &buffer_impl, width, height);
 
+	buffer->size = size;
+	buffer->data = (char *)buffer->arena->data + offset;
+	buffer->shm.fd = buffer->arena->fd;
 	buffer->shm.format = format->format;
 	buffer->shm.width = width;
 	buffer->shm.height = height;
 	buffer->shm.stride = stride;
-	buffer->shm.offset = 0;
-
-	buffer->data = mmap(NULL, buffer->size, PROT_READ | PROT_WRITE, MAP_SHARED,
-		buffer->shm.fd, 0);
-	if (buffer->data == MAP_FAILED) {
-		wlr_log_errno(WLR_ERROR, "mmap failed");
-		close(buffer->shm.fd);
-		free(buffer);
-		return NULL;
-	}
+	buffer->shm.offset = offset;
 
+	allocator->stats.allocations++;
+	allocator->stats.live_buffers++;
+	allocator->stats.live_bytes += size;
 	return &buffer->base;
 }
 
 static void allocator_destroy(struct wlr_allocator *wlr_allocator) {
-	free(wlr_allocator);
+	struct wlr_shm_allocator *allocator =
+		wl_container_of(wlr_allocator, allocator, base);
+	allocator->destroyed = true;
+
+	// Arenas still holding buffers go away with their last buffer
+	struct wlr_shm_arena *arena, *tmp;
+	wl_list_for_each_safe(arena, tmp, &allocator->arenas, link) {
+		if (arena->n_buffers == 0) {
+			arena_destroy(arena);
+		}
+	}
+	allocator_maybe_finish(allocator);
 }
 
 static const struct wlr_allocator_interface allocator_impl = {
@@ -115,7 +356,19 @@ struct wlr_allocator *wlr_shm_allocator_create(void) {
 	}
 	wlr_allocator_init(&allocator->base, &allocator_impl,
 		WLR_BUFFER_CAP_DATA_PTR | WLR_BUFFER_CAP_SHM);
+	wl_list_init(&allocator->arenas);
 
 	wlr_log(WLR_DEBUG, "Created shm allocator");
 	return &allocator->base;
 }
+
+bool wlr_allocator_get_shm_stats(struct wlr_allocator *wlr_allocator,
+		struct wlr_shm_allocator_stats *stats) {
+	if (wlr_allocator->impl != &allocator_impl) {
+		return false;
+	}
+	struct wlr_shm_allocator *allocator =
+		wl_container_of(wlr_allocator, allocator, base);
+	*stats = allocator->stats;
+	return true;
+}
@@ -27,15 +27,56 @@ void wlr_drm_format_set_finish(struct wlr_drm_format_set *set) {
 	set->formats = NULL;
 }
 
-static struct wlr_drm_format *format_set_get(const struct wlr_drm_format_set *set,
-		uint32_t format) {
-	for (size_t i = 0; i < set->len; ++i) {
-		if (set->formats[i].format == format) {
-			return &set->formats[i];
+/**
+ * Look up a format with a binary search. If the format isn't in the set,
+ * index is set to the position where it should be inserted to keep the set
+ * sorted.
+ */
+static bool format_set_find(const struct wlr_drm_format_set *set,
+		uint32_t format, size_t *index) {
+	size_t lo = 0, hi = set->len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		uint32_t cur = set->formats[mid].format;
+		if (cur == format) {
+			*index = mid;
+			return true;
+		} else if (cur < format) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	*index = lo;
+	return false;
+}
+
+static bool format_find_modifier(const struct wlr_drm_format *fmt,
+		uint64_t modifier, size_t *index) {
+	size_t lo = 0, hi = fmt->len;
+	while (lo < hi) {
+		size_t mid = lo + (hi - lo) / 2;
+		uint64_t cur = fmt->modifiers[mid];
+		if (cur == modifier) {
+			*index = mid;
+			return true;
+		} else if (cur < modifier) {
+			lo = mid + 1;
+		} else {
+			hi = mid;
 		}
 	}
+	*index = lo;
+	return false;
+}
 
-	return NULL;
+static struct wlr_drm_format *format_set_get(const struct wlr_drm_format_set *set,
+		uint32_t format) {
+	size_t idx;
+	if (!format_set_find(set, format, &idx)) {
+		return NULL;
+	}
+	return &set->formats[idx];
 }
 
 const struct wlr_drm_format *wlr_drm_format_set_get(
@@ -52,13 +93,34 @@ bool wlr_drm_format_set_has(const struct wlr_drm_format_set *set,
 	return wlr_drm_format_has(fmt, modifier);
 }
 
+static bool format_set_reserve(struct wlr_drm_format_set *set, size_t len) {
+	if (len <= set->capacity) {
+		return true;
+	}
+
+	size_t capacity = set->capacity ? set->capacity * 2 : 4;
+	while (capacity < len) {
+		capacity *= 2;
+	}
+
+	struct wlr_drm_format *fmts = realloc(set->formats, sizeof(*fmts) * capacity);
+	if (!fmts) {
+		wlr_log_errno(WLR_ERROR, "Allocation failed");
+		return false;
+	}
+
+	set->capacity = capacity;
+	set->formats = fmts;
+	return true;
+}
+
 bool wlr_drm_format_set_add(struct wlr_drm_format_set *set, uint32_t format,
 		uint64_t modifier) {
 	assert(format != DRM_FORMAT_INVALID);
 
-	struct wlr_drm_format *existing = format_set_get(set, format);
-	if (existing) {
-		return wlr_drm_format_add(existing, modifier);
+	size_t idx;
+	if (format_set_find(set, format, &idx)) {
+		return wlr_drm_format_add(&set->formats[idx], modifier);
 	}
 
 	struct wlr_drm_format fmt;
@@ -68,21 +130,15 @@ bool wlr_drm_format_set_add(struct wlr_drm_format_set *set, uint32_t format,
 		return false;
 	}
 
-	if (set->len == set->capacity) {
-		size_t capacity = set->capacity ? set->capacity * 2 : 4;
-
-		struct wlr_drm_format *fmts = realloc(set->formats, sizeof(*fmts) * capacity);
-		if (!fmts) {
-			wlr_log_errno(WLR_ERROR, "Allocation failed");
-			wlr_drm_format_finish(&fmt);
-			return false;
-		}
-
-		set->capacity = capacity;
-		set->formats = fmts;
+	if (!format_set_reserve(set, set->len + 1)) {
+		wlr_drm_format_finish(&fmt);
+		return false;
 	}
 
-	set->formats[set->len++] = fmt;
+	memmove(&set->formats[idx + 1], &set->formats[idx],
+		(set->len - idx) * sizeof(set->formats[0]));
+	set->formats[idx] = fmt;
+	set->len++;
 	return true;
 }
 
@@ -93,14 +149,14 @@ bool wlr_drm_format_set_remove(struct wlr_drm_format_set *set, uint32_t format,
 		return false;
 	}
 
-	for (size_t idx = 0; idx < fmt->len; idx++) {
-		if (fmt->modifiers[idx] == modifier) {
-			memmove(&fmt->modifiers[idx], &fmt->modifiers[idx+1], (fmt->len - idx - 1) * sizeof(fmt->modifiers[0]));
-			fmt->len--;
-			return true;
-		}
+	size_t idx;
+	if (!format_find_modifier(fmt, modifier, &idx)) {
+		return false;
 	}
-	return false;
+
+	memmove(&fmt->modifiers[idx], &fmt->modifiers[idx+1], (fmt->len - idx - 1) * sizeof(fmt->modifiers[0]));
+	fmt->len--;
+	return true;
 }
 
 void wlr_drm_format_init(struct wlr_drm_format *fmt, uint32_t format) {
@@ -110,16 +166,13 @@ void wlr_drm_format_init(struct wlr_drm_format *fmt, uint32_t format) {
 }
 
 bool wlr_drm_format_has(const struct wlr_drm_format *fmt, uint64_t modifier) {
-	for (size_t i = 0; i < fmt->len; ++i) {
-		if (fmt->modifiers[i] == modifier) {
-			return true;
-		}
-	}
-	return false;
+	size_t idx;
+	return format_find_modifier(fmt, modifier, &idx);
 }
 
 bool wlr_drm_format_add(struct wlr_drm_format *fmt, uint64_t modifier) {
-	if (wlr_drm_format_has(fmt, modifier)) {
+	size_t idx;
+	if (format_find_modifier(fmt, modifier, &idx)) {
 		return true;
 	}
 
@@ -136,7 +189,10 @@ bool wlr_drm_format_add(struct wlr_drm_format *fmt, uint64_t modifier) {
 		fmt->modifiers = new_modifiers;
 	}
 
-	fmt->modifiers[fmt->len++] = modifier;
+	memmove(&fmt->modifiers[idx + 1], &fmt->modifiers[idx],
+		(fmt->len - idx) * sizeof(fmt->modifiers[0]));
+	fmt->modifiers[idx] = modifier;
+	fmt->len++;
 	return true;
 }
 
@@ -203,13 +259,18 @@ bool wlr_drm_format_intersect(struct wlr_drm_format *dst,
 		.format = a->format,
 	};
 
-	for (size_t i = 0; i < a->len; i++) {
-		for (size_t j = 0; j < b->len; j++) {
-			if (a->modifiers[i] == b->modifiers[j]) {
-				assert(fmt.len < fmt.capacity);
-				fmt.modifiers[fmt.len++] = a->modifiers[i];
-				break;
-			}
+	// Both modifier arrays are sorted: merge them
+	size_t i = 0, j = 0;
+	while (i < a->len && j < b->len) {
+		if (a->modifiers[i] < b->modifiers[j]) {
+			i++;
+		} else if (a->modifiers[i] > b->modifiers[j]) {
+			j++;
+		} else {
+			assert(fmt.len < fmt.capacity);
+			fmt.modifiers[fmt.len++] = a->modifiers[i];
+			i++;
+			j++;
 		}
 	}
 
@@ -218,6 +279,42 @@ bool wlr_drm_format_intersect(struct wlr_drm_format *dst,
 	return true;
 }
 
+static bool drm_format_union(struct wlr_drm_format *dst,
+		const struct wlr_drm_format *a, const struct wlr_drm_format *b) {
+	assert(a->format == b->format);
+
+	size_t capacity = a->len + b->len;
+	uint64_t *modifiers = malloc(sizeof(*modifiers) * capacity);
+	if (!modifiers) {
+		return false;
+	}
+
+	struct wlr_drm_format fmt = {
+		.capacity = capacity,
+		.len = 0,
+		.modifiers = modifiers,
+		.format = a->format,
+	};
+
+	size_t i = 0, j = 0;
+	while (i < a->len || j < b->len) {
+		uint64_t mod;
+		if (j == b->len || (i < a->len && a->modifiers[i] < b->modifiers[j])) {
+			mod = a->modifiers[i++];
+		} else if (i == a->len || b->modifiers[j] < a->modifiers[i]) {
+			mod = b->modifiers[j++];
+		} else {
+			mod = a->modifiers[i];
+			i++;
+			j++;
+		}
+		fmt.modifiers[fmt.len++] = mod;
+	}
+
+	*dst = fmt;
+	return true;
+}
+
 bool wlr_drm_format_set_intersect(struct wlr_drm_format_set *dst,
 		const struct wlr_drm_format_set *a, const struct wlr_drm_format_set *b) {
 	struct wlr_drm_format_set out = {0};
@@ -228,28 +325,35 @@ bool wlr_drm_format_set_intersect(struct wlr_drm_format_set *dst,
 		return false;
 	}
 
-	for (size_t i = 0; i < a->len; i++) {
-		for (size_t j = 0; j < b->len; j++) {
-			if (a->formats[i].format == b->formats[j].format) {
-				// When the two formats have no common modifier, keep
-				// intersecting the rest of the formats: they may be compatible
-				// with each other
-				out.formats[out.len] = (struct wlr_drm_format){0};
-				if (!wlr_drm_format_intersect(&out.formats[out.len],
-						&a->formats[i], &b->formats[j])) {
-					wlr_drm_format_set_finish(&out);
-					return false;
-				}
-
-				if (out.formats[out.len].len == 0) {
-					wlr_drm_format_finish(&out.formats[out.len]);
-				} else {
-					out.len++;
-				}
-
-				break;
-			}
+	// Both sets are sorted by format: merge them
+	size_t i = 0, j = 0;
+	while (i < a->len && j < b->len) {
+		if (a->formats[i].format < b->formats[j].format) {
+			i++;
+			continue;
+		} else if (a->formats[i].format > b->formats[j].format) {
+			j++;
+			continue;
 		}
+
+		// When the two formats have no common modifier, keep
+		// intersecting the rest of the formats: they may be compatible
+		// with each other
+		out.formats[out.len] = (struct wlr_drm_format){0};
+		if (!wlr_drm_format_intersect(&out.formats[out.len],
+				&a->formats[i], &b->formats[j])) {
+			wlr_drm_format_set_finish(&out);
+			return false;
+		}
+
+		if (out.formats[out.len].len == 0) {
+			wlr_drm_format_finish(&out.formats[out.len]);
+		} else {
+			out.len++;
+		}
+
+		i++;
+		j++;
 	}
 
 	if (out.len == 0) {
@@ -262,36 +366,51 @@ bool wlr_drm_format_set_intersect(struct wlr_drm_format_set *dst,
 	return true;
 }
 
-static bool drm_format_set_extend(struct wlr_drm_format_set *dst,
-		const struct wlr_drm_format_set *src) {
-	for (size_t i = 0; i < src->len; i++) {
-		struct wlr_drm_format *format = &src->formats[i];
-		for (size_t j = 0; j < format->len; j++) {
-			if (!wlr_drm_format_set_add(dst, format->format, format->modifiers[j])) {
-				wlr_log_errno(WLR_ERROR, "Adding format/modifier to set failed");
-				return false;
-			}
-		}
-	}
-
-	return true;
-}
-
 bool wlr_drm_format_set_union(struct wlr_drm_format_set *dst,
 		const struct wlr_drm_format_set *a, const struct wlr_drm_format_set *b) {
 	struct wlr_drm_format_set out = {0};
 	out.capacity = a->len + b->len;
+	if (out.capacity == 0) {
+		wlr_drm_format_set_finish(dst);
+		return true;
+	}
 	out.formats = malloc(sizeof(*out.formats) * out.capacity);
 	if (out.formats == NULL) {
 		wlr_log_errno(WLR_ERROR, "Allocation failed");
 		return false;
 	}
 
-	// Add both a and b sets into out
-	if (!drm_format_set_extend(&out, a) ||
-		!drm_format_set_extend(&out, b)) {
-		wlr_drm_format_set_finish(&out);
-		return false;
+	// Both sets are sorted by format: merge them
+	size_t i = 0, j = 0;
+	while (i < a->len || j < b->len) {
+		// Formats without any modifier don't belong in the union
+		if (i < a->len && a->formats[i].len == 0) {
+			i++;
+			continue;
+		}
+		if (j < b->len && b->formats[j].len == 0) {
+			j++;
+			continue;
+		}
+
+		struct wlr_drm_format *fmt = &out.formats[out.len];
+		*fmt = (struct wlr_drm_format){0};
+
+		bool ok;
+		if (j == b->len || (i < a->len && a->formats[i].format < b->formats[j].format)) {
+			ok = wlr_drm_format_copy(fmt, &a->formats[i++]);
+		} else if (i == a->len || b->formats[j].format < a->formats[i].format) {
+			ok = wlr_drm_format_copy(fmt, &b->formats[j++]);
+		} else {
+			ok = drm_format_union(fmt, &a->formats[i++], &b->formats[j++]);
+		}
+		if (!ok) {
+			wlr_log_errno(WLR_ERROR, "Allocation failed");
+			wlr_drm_format_set_finish(&out);
+			return false;
+		}
+
+		out.len++;
 	}
 
 	wlr_drm_format_set_finish(dst);
@@ -136,12 +136,10 @@ bool is_gles2_pixel_format_supported(const struct wlr_gles2_renderer *renderer,
 }
 
 const struct wlr_gles2_pixel_format *get_gles2_format_from_drm(uint32_t fmt) {
-	for (size_t i = 0; i < sizeof(formats) / sizeof(*formats); ++i) {
-		if (formats[i].drm_format == fmt) {
-			return &formats[i];
-		}
-	}
-	return NULL;
+	static struct pixel_format_index index = {0};
+	return pixel_format_index_find(&index, formats,
+		sizeof(formats) / sizeof(formats[0]), sizeof(formats[0]),
+		offsetof(struct wlr_gles2_pixel_format, drm_format), fmt);
 }
 
 const struct wlr_gles2_pixel_format *get_gles2_format_from_gl(
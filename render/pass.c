@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <string.h>
 #include <wlr/render/interface.h>
+#include "util/trace.h"
 
 void wlr_render_pass_init(struct wlr_render_pass *render_pass,
 		const struct wlr_render_pass_impl *impl) {
@@ -11,7 +12,10 @@ void wlr_render_pass_init(struct wlr_render_pass *render_pass,
 }
 
 bool wlr_render_pass_submit(struct wlr_render_pass *render_pass) {
-	return render_pass->impl->submit(render_pass);
+	TRACE_BEGIN(TRACE_RENDER_PASS_SUBMIT, 0);
+	bool ok = render_pass->impl->submit(render_pass);
+	TRACE_END(TRACE_RENDER_PASS_SUBMIT, ok);
+	return ok;
 }
 
 void wlr_render_pass_add_texture(struct wlr_render_pass *render_pass,
@@ -25,13 +29,17 @@ void wlr_render_pass_add_texture(struct wlr_render_pass *render_pass,
 		(uint32_t)(box->y + box->height) <= options->texture->height);
 	}
 
+	TRACE_BEGIN(TRACE_RENDER_TEXTURE, 0);
 	render_pass->impl->add_texture(render_pass, options);
+	TRACE_END(TRACE_RENDER_TEXTURE, 0);
 }
 
 void wlr_render_pass_add_rect(struct wlr_render_pass *render_pass,
 		const struct wlr_render_rect_options *options) {
 	assert(options->box.width >= 0 && options->box.height >= 0);
+	TRACE_BEGIN(TRACE_RENDER_RECT, 0);
 	render_pass->impl->add_rect(render_pass, options);
+	TRACE_END(TRACE_RENDER_RECT, 0);
 }
 
 void wlr_render_texture_options_get_src_box(const struct wlr_render_texture_options *options,
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <drm_fourcc.h>
+#include <string.h>
 #include <wlr/util/log.h>
 #include "render/pixel_format.h"
 
@@ -223,16 +224,78 @@ static const size_t pixel_format_info_size =
 static const size_t opaque_pixel_formats_size =
 	sizeof(opaque_pixel_formats) / sizeof(opaque_pixel_formats[0]);
 
-const struct wlr_pixel_format_info *drm_get_pixel_format_info(uint32_t fmt) {
-	for (size_t i = 0; i < pixel_format_info_size; ++i) {
-		if (pixel_format_info[i].drm_format == fmt) {
-			return &pixel_format_info[i];
+static size_t pixel_format_hash(uint32_t fmt) {
+	// Fibonacci hashing, FourCCs differ mostly in their low bytes
+	return (uint32_t)(fmt * 2654435769u) >> 24;
+}
+
+static uint32_t table_get_format(const void *table, size_t stride,
+		size_t offset, size_t i) {
+	uint32_t fmt;
+	memcpy(&fmt, (const char *)table + i * stride + offset, sizeof(fmt));
+	return fmt;
+}
+
+static void pixel_format_index_build(struct pixel_format_index *index,
+		const void *table, size_t len, size_t stride, size_t offset) {
+	assert(len < PIXEL_FORMAT_INDEX_SIZE);
+	for (size_t i = 0; i < len; i++) {
+		uint32_t fmt = table_get_format(table, stride, offset, i);
+		size_t slot = pixel_format_hash(fmt);
+		while (index->slots[slot] != 0) {
+			size_t j = index->slots[slot] - 1;
+			if (table_get_format(table, stride, offset, j) == fmt) {
+				break; // keep the first entry, like a linear search
+			}
+			slot = (slot + 1) % PIXEL_FORMAT_INDEX_SIZE;
+		}
+		if (index->slots[slot] == 0) {
+			index->slots[slot] = i + 1;
 		}
 	}
+}
 
+const void *pixel_format_index_find(struct pixel_format_index *index,
+		const void *table, size_t len, size_t stride, size_t offset,
+		uint32_t fmt) {
+	int state = atomic_load_explicit(&index->state, memory_order_acquire);
+	if (state == 0) {
+		int expected = 0;
+		if (atomic_compare_exchange_strong(&index->state, &expected, 1)) {
+			pixel_format_index_build(index, table, len, stride, offset);
+			atomic_store_explicit(&index->state, 2, memory_order_release);
+			state = 2;
+		}
+	}
+
+	if (state != 2) {
+		// Another thread is building the index
+		for (size_t i = 0; i < len; i++) {
+			if (table_get_format(table, stride, offset, i) == fmt) {
+				return (const char *)table + i * stride;
+			}
+		}
+		return NULL;
+	}
+
+	size_t slot = pixel_format_hash(fmt);
+	while (index->slots[slot] != 0) {
+		size_t i = index->slots[slot] - 1;
+		if (table_get_format(table, stride, offset, i) == fmt) {
+			return (const char *)table + i * stride;
+		}
+		slot = (slot + 1) % PIXEL_FORMAT_INDEX_SIZE;
+	}
 	return NULL;
 }
 
+const struct wlr_pixel_format_info *drm_get_pixel_format_info(uint32_t fmt) {
+	static struct pixel_format_index index = {0};
+	return pixel_format_index_find(&index, pixel_format_info,
+		pixel_format_info_size, sizeof(pixel_format_info[0]),
+		offsetof(struct wlr_pixel_format_info, drm_format), fmt);
+}
+
 uint32_t convert_wl_shm_format_to_drm(enum wl_shm_format fmt) {
 	switch (fmt) {
 	case WL_SHM_FORMAT_XRGB8888:
@@ -300,12 +363,10 @@ bool pixel_format_info_check_stride(const struct wlr_pixel_format_info *fmt,
 }
 
 bool pixel_format_has_alpha(uint32_t fmt) {
-	for (size_t i = 0; i < opaque_pixel_formats_size; i++) {
-		if (fmt == opaque_pixel_formats[i]) {
-			return false;
-		}
-	}
-	return true;
+	static struct pixel_format_index index = {0};
+	return pixel_format_index_find(&index, opaque_pixel_formats,
+		opaque_pixel_formats_size, sizeof(opaque_pixel_formats[0]), 0,
+		fmt) == NULL;
 }
 
 bool pixel_format_is_ycbcr(uint32_t format) {
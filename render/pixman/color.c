@@ -0,0 +1,492 @@
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/render/color.h>
+#include <wlr/util/log.h>
+
+#include "render/color.h"
+#include "render/pixman.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// Resolution of the table mapping the square root of linear light to the
+// output encoding. Indexing by the square root keeps dark tones accurate.
+#define POST_LUT_LEN 4096
+#define LUT_3D_DIM 33
+// Pixels converted at once by the matrix kernel
+#define CHUNK_LEN 64
+
+enum pixman_color_transform_type {
+	PIXMAN_COLOR_TRANSFORM_IDENTITY,
+	PIXMAN_COLOR_TRANSFORM_LUT_1D,
+	PIXMAN_COLOR_TRANSFORM_MATRIX,
+	PIXMAN_COLOR_TRANSFORM_LUT_3D,
+};
+
+/**
+ * A struct wlr_color_transform compiled for 8-bit channels.
+ *
+ * Buffers hold content already encoded for a gamma 2.2 display, while the
+ * transform expects linear light, so texels are decoded first. The common
+ * case of the default inverse EOTF alone thus becomes the identity.
+ *
+ * Transforms acting on each channel separately (inverse EOTFs, 3x1D LUTs)
+ * are folded into a single 256-entry table per channel. Pipelines with a
+ * single matrix surrounded by such transforms are split into a table to
+ * linear light, the matrix and a table back to the output encoding. Anything
+ * else is sampled into a 3D LUT.
+ */
+struct wlr_pixman_color_transform {
+	struct wlr_addon addon; // wlr_color_transform.addons
+	struct wl_list link; // wlr_pixman_renderer.color_transforms
+
+	enum pixman_color_transform_type type;
+
+	uint8_t lut_1d[3][256];
+
+	float pre[3][256];
+	float matrix[9];
+	uint8_t post[3][POST_LUT_LEN + 1];
+
+	uint16_t *lut_3d; // LUT_3D_DIM^3 RGB triplets, blue varying fastest
+	// For each channel value, offset of the grid cell in lut_3d and weight
+	// of its upper corner out of 256
+	int lut_3d_offset[3][256];
+	uint16_t lut_3d_weight[256];
+};
+
+static float decode(float x) {
+	return powf(x, 2.2f);
+}
+
+static uint8_t encode_u8(float x) {
+	if (!(x > 0)) {
+		return 0;
+	} else if (x >= 1) {
+		return 0xFF;
+	}
+	return (uint8_t)(x * 0xFF + 0.5f);
+}
+
+static bool color_transform_is_separable(struct wlr_color_transform *tr) {
+	switch (tr->type) {
+	case COLOR_TRANSFORM_INVERSE_EOTF:
+	case COLOR_TRANSFORM_LUT_3X1D:
+		return true;
+	case COLOR_TRANSFORM_MATRIX:
+	case COLOR_TRANSFORM_LCMS2:
+		return false;
+	case COLOR_TRANSFORM_PIPELINE:;
+		struct wlr_color_transform_pipeline *pipeline =
+			wl_container_of(tr, pipeline, base);
+		for (size_t i = 0; i < pipeline->len; i++) {
+			if (!color_transform_is_separable(pipeline->transforms[i])) {
+				return false;
+			}
+		}
+		return true;
+	}
+	abort(); // unreachable
+}
+
+static void eval_range(struct wlr_color_transform **transforms, size_t start,
+		size_t end, float color[static 3]) {
+	for (size_t i = start; i < end; i++) {
+		wlr_color_transform_eval(transforms[i], color, color);
+	}
+}
+
+static void compile_lut_1d(struct wlr_pixman_color_transform *out,
+		struct wlr_color_transform *tr) {
+	bool identity = true;
+	for (int x = 0; x < 256; x++) {
+		float v = decode(x / 255.0f);
+		float color[3] = { v, v, v };
+		wlr_color_transform_eval(tr, color, color);
+		for (int c = 0; c < 3; c++) {
+			out->lut_1d[c][x] = encode_u8(color[c]);
+			identity = identity && out->lut_1d[c][x] == x;
+		}
+	}
+	out->type = identity ?
+		PIXMAN_COLOR_TRANSFORM_IDENTITY : PIXMAN_COLOR_TRANSFORM_LUT_1D;
+}
+
+static bool compile_matrix(struct wlr_pixman_color_transform *out,
+		struct wlr_color_transform *tr) {
+	struct wlr_color_transform **transforms = &tr;
+	size_t len = 1;
+	if (tr->type == COLOR_TRANSFORM_PIPELINE) {
+		struct wlr_color_transform_pipeline *pipeline =
+			wl_container_of(tr, pipeline, base);
+		transforms = pipeline->transforms;
+		len = pipeline->len;
+	}
+
+	size_t matrix_index = len;
+	for (size_t i = 0; i < len; i++) {
+		if (transforms[i]->type == COLOR_TRANSFORM_MATRIX && matrix_index == len) {
+			matrix_index = i;
+		} else if (!color_transform_is_separable(transforms[i])) {
+			return false;
+		}
+	}
+	if (matrix_index == len) {
+		return false;
+	}
+
+	struct wlr_color_transform_matrix *matrix =
+		wl_container_of(transforms[matrix_index], matrix, base);
+	memcpy(out->matrix, matrix->matrix, sizeof(out->matrix));
+
+	for (int x = 0; x < 256; x++) {
+		float v = decode(x / 255.0f);
+		float color[3] = { v, v, v };
+		eval_range(transforms, 0, matrix_index, color);
+		for (int c = 0; c < 3; c++) {
+			out->pre[c][x] = color[c];
+		}
+	}
+
+	for (int i = 0; i <= POST_LUT_LEN; i++) {
+		float u = (float)i / POST_LUT_LEN;
+		float color[3] = { u * u, u * u, u * u };
+		eval_range(transforms, matrix_index + 1, len, color);
+		for (int c = 0; c < 3; c++) {
+			out->post[c][i] = encode_u8(color[c]);
+		}
+	}
+
+	out->type = PIXMAN_COLOR_TRANSFORM_MATRIX;
+	return true;
+}
+
+static bool compile_lut_3d(struct wlr_pixman_color_transform *out,
+		struct wlr_color_transform *tr) {
+	const size_t dim = LUT_3D_DIM;
+	out->lut_3d = malloc(dim * dim * dim * 3 * sizeof(out->lut_3d[0]));
+	if (out->lut_3d == NULL) {
+		return false;
+	}
+
+	uint16_t *entry = out->lut_3d;
+	for (size_t r = 0; r < dim; r++) {
+		for (size_t g = 0; g < dim; g++) {
+			for (size_t b = 0; b < dim; b++) {
+				float color[3] = {
+					decode((float)r / (dim - 1)),
+					decode((float)g / (dim - 1)),
+					decode((float)b / (dim - 1)),
+				};
+				wlr_color_transform_eval(tr, color, color);
+				for (int c = 0; c < 3; c++) {
+					float v = color[c] > 0 ? color[c] : 0;
+					entry[c] = v < 1 ? (uint16_t)(v * UINT16_MAX + 0.5f) : UINT16_MAX;
+				}
+				entry += 3;
+			}
+		}
+	}
+
+	const size_t strides[3] = { dim * dim * 3, dim * 3, 3 };
+	for (int x = 0; x < 256; x++) {
+		int pos = x * (dim - 1) * 256 / 0xFF;
+		int index = pos / 256;
+		if (index >= (int)dim - 1) {
+			index = dim - 2;
+		}
+		for (int c = 0; c < 3; c++) {
+			out->lut_3d_offset[c][x] = index * strides[c];
+		}
+		out->lut_3d_weight[x] = pos - index * 256;
+	}
+
+	out->type = PIXMAN_COLOR_TRANSFORM_LUT_3D;
+	return true;
+}
+
+static void color_transform_destroy(struct wlr_pixman_color_transform *tr) {
+	wlr_addon_finish(&tr->addon);
+	wl_list_remove(&tr->link);
+	free(tr->lut_3d);
+	free(tr);
+}
+
+static void handle_addon_destroy(struct wlr_addon *addon) {
+	struct wlr_pixman_color_transform *tr = wl_container_of(addon, tr, addon);
+	color_transform_destroy(tr);
+}
+
+static const struct wlr_addon_interface color_transform_addon_impl = {
+	.name = "wlr_pixman_color_transform",
+	.destroy = handle_addon_destroy,
+};
+
+struct wlr_pixman_color_transform *pixman_color_transform_get(
+		struct wlr_pixman_renderer *renderer, struct wlr_color_transform *tr) {
+	struct wlr_addon *addon =
+		wlr_addon_find(&tr->addons, renderer, &color_transform_addon_impl);
+	if (addon != NULL) {
+		struct wlr_pixman_color_transform *compiled =
+			wl_container_of(addon, compiled, addon);
+		return compiled;
+	}
+
+	struct wlr_pixman_color_transform *compiled = calloc(1, sizeof(*compiled));
+	if (compiled == NULL) {
+		return NULL;
+	}
+
+	if (color_transform_is_separable(tr)) {
+		compile_lut_1d(compiled, tr);
+	} else if (!compile_matrix(compiled, tr) && !compile_lut_3d(compiled, tr)) {
+		free(compiled);
+		return NULL;
+	}
+
+	wlr_addon_init(&compiled->addon, &tr->addons, renderer,
+		&color_transform_addon_impl);
+	wl_list_insert(&renderer->color_transforms, &compiled->link);
+	return compiled;
+}
+
+void pixman_color_transform_destroy(struct wlr_pixman_color_transform *tr) {
+	color_transform_destroy(tr);
+}
+
+bool pixman_color_transform_is_identity(struct wlr_pixman_color_transform *tr) {
+	return tr->type == PIXMAN_COLOR_TRANSFORM_IDENTITY;
+}
+
+static void apply_lut_1d(const struct wlr_pixman_color_transform *tr,
+		uint32_t *row, int len, const int shift[static 3]) {
+	uint32_t keep = ~((0xFFu << shift[0]) | (0xFFu << shift[1]) | (0xFFu << shift[2]));
+	for (int i = 0; i < len; i++) {
+		uint32_t p = row[i];
+		row[i] = (p & keep) |
+			(uint32_t)tr->lut_1d[0][(p >> shift[0]) & 0xFF] << shift[0] |
+			(uint32_t)tr->lut_1d[1][(p >> shift[1]) & 0xFF] << shift[1] |
+			(uint32_t)tr->lut_1d[2][(p >> shift[2]) & 0xFF] << shift[2];
+	}
+}
+
+/**
+ * Multiply planar linear colors by the matrix and turn the result into
+ * indices of the post table.
+ */
+static void matrix_to_post_index(const float m[static 9],
+		const float *in[static 3], int32_t *out[static 3], int len) {
+	int i = 0;
+#if defined(__SSE2__)
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1);
+	const __m128 scale = _mm_set1_ps(POST_LUT_LEN);
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (; i + 4 <= len; i += 4) {
+		__m128 r = _mm_loadu_ps(&in[0][i]);
+		__m128 g = _mm_loadu_ps(&in[1][i]);
+		__m128 b = _mm_loadu_ps(&in[2][i]);
+		for (int c = 0; c < 3; c++) {
+			__m128 v = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(r, _mm_set1_ps(m[3 * c])),
+				_mm_mul_ps(g, _mm_set1_ps(m[3 * c + 1]))),
+				_mm_mul_ps(b, _mm_set1_ps(m[3 * c + 2])));
+			// _mm_max_ps() returns its second operand for NaN
+			v = _mm_min_ps(_mm_max_ps(v, zero), one);
+			v = _mm_add_ps(_mm_mul_ps(_mm_sqrt_ps(v), scale), half);
+			_mm_storeu_si128((__m128i *)&out[c][i], _mm_cvttps_epi32(v));
+		}
+	}
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+	const float32x4_t zero = vdupq_n_f32(0);
+	const float32x4_t one = vdupq_n_f32(1);
+	const float32x4_t half = vdupq_n_f32(0.5f);
+	for (; i + 4 <= len; i += 4) {
+		float32x4_t r = vld1q_f32(&in[0][i]);
+		float32x4_t g = vld1q_f32(&in[1][i]);
+		float32x4_t b = vld1q_f32(&in[2][i]);
+		for (int c = 0; c < 3; c++) {
+			float32x4_t v = vmulq_n_f32(r, m[3 * c]);
+			v = vfmaq_n_f32(v, g, m[3 * c + 1]);
+			v = vfmaq_n_f32(v, b, m[3 * c + 2]);
+			// vmaxnmq_f32() returns the number for NaN
+			v = vminq_f32(vmaxnmq_f32(v, zero), one);
+			v = vfmaq_n_f32(half, vsqrtq_f32(v), POST_LUT_LEN);
+			vst1q_s32(&out[c][i], vcvtq_s32_f32(v));
+		}
+	}
+#endif
+	for (; i < len; i++) {
+		for (int c = 0; c < 3; c++) {
+			float v = m[3 * c] * in[0][i] + m[3 * c + 1] * in[1][i] +
+				m[3 * c + 2] * in[2][i];
+			v = fminf(fmaxf(v, 0), 1);
+			out[c][i] = (int32_t)(sqrtf(v) * POST_LUT_LEN + 0.5f);
+		}
+	}
+}
+
+static void apply_matrix(const struct wlr_pixman_color_transform *tr,
+		uint32_t *row, int len, const int shift[static 3]) {
+	uint32_t keep = ~((0xFFu << shift[0]) | (0xFFu << shift[1]) | (0xFFu << shift[2]));
+	float r[CHUNK_LEN], g[CHUNK_LEN], b[CHUNK_LEN];
+	int32_t ir[CHUNK_LEN], ig[CHUNK_LEN], ib[CHUNK_LEN];
+	const float *in[] = { r, g, b };
+	int32_t *out[] = { ir, ig, ib };
+
+	for (int start = 0; start < len; start += CHUNK_LEN) {
+		int n = len - start < CHUNK_LEN ? len - start : CHUNK_LEN;
+		uint32_t *chunk = &row[start];
+		for (int i = 0; i < n; i++) {
+			uint32_t p = chunk[i];
+			r[i] = tr->pre[0][(p >> shift[0]) & 0xFF];
+			g[i] = tr->pre[1][(p >> shift[1]) & 0xFF];
+			b[i] = tr->pre[2][(p >> shift[2]) & 0xFF];
+		}
+
+		matrix_to_post_index(tr->matrix, in, out, n);
+
+		for (int i = 0; i < n; i++) {
+			chunk[i] = (chunk[i] & keep) |
+				(uint32_t)tr->post[0][ir[i]] << shift[0] |
+				(uint32_t)tr->post[1][ig[i]] << shift[1] |
+				(uint32_t)tr->post[2][ib[i]] << shift[2];
+		}
+	}
+}
+
+static inline uint32_t lerp_u16(uint32_t a, uint32_t b, uint32_t weight) {
+	return (a * (256 - weight) + b * weight) >> 8;
+}
+
+static void apply_lut_3d(const struct wlr_pixman_color_transform *tr,
+		uint32_t *row, int len, const int shift[static 3]) {
+	const int sr = LUT_3D_DIM * LUT_3D_DIM * 3, sg = LUT_3D_DIM * 3, sb = 3;
+	uint32_t keep = ~((0xFFu << shift[0]) | (0xFFu << shift[1]) | (0xFFu << shift[2]));
+
+	for (int i = 0; i < len; i++) {
+		uint32_t p = row[i];
+		uint8_t r = (p >> shift[0]) & 0xFF;
+		uint8_t g = (p >> shift[1]) & 0xFF;
+		uint8_t b = (p >> shift[2]) & 0xFF;
+		uint32_t wr = tr->lut_3d_weight[r];
+		uint32_t wg = tr->lut_3d_weight[g];
+		uint32_t wb = tr->lut_3d_weight[b];
+		const uint16_t *cell = tr->lut_3d + tr->lut_3d_offset[0][r] +
+			tr->lut_3d_offset[1][g] + tr->lut_3d_offset[2][b];
+
+		// Trilinear interpolation between the 8 corners of the cell
+		uint32_t q = p & keep;
+		for (int c = 0; c < 3; c++) {
+			const uint16_t *v = cell + c;
+			uint32_t v00 = lerp_u16(v[0], v[sb], wb);
+			uint32_t v01 = lerp_u16(v[sg], v[sg + sb], wb);
+			uint32_t v10 = lerp_u16(v[sr], v[sr + sb], wb);
+			uint32_t v11 = lerp_u16(v[sr + sg], v[sr + sg + sb], wb);
+			uint32_t v0 = lerp_u16(v00, v01, wg);
+			uint32_t v1 = lerp_u16(v10, v11, wg);
+			q |= ((lerp_u16(v0, v1, wr) + 128) / 257) << shift[c];
+		}
+		row[i] = q;
+	}
+}
+
+static void apply_rows(const struct wlr_pixman_color_transform *tr,
+		uint8_t *data, int stride, int width, int height,
+		const int shift[static 3]) {
+	for (int y = 0; y < height; y++) {
+		uint32_t *row = (uint32_t *)(data + (ptrdiff_t)y * stride);
+		switch (tr->type) {
+		case PIXMAN_COLOR_TRANSFORM_IDENTITY:
+			return;
+		case PIXMAN_COLOR_TRANSFORM_LUT_1D:
+			apply_lut_1d(tr, row, width, shift);
+			break;
+		case PIXMAN_COLOR_TRANSFORM_MATRIX:
+			apply_matrix(tr, row, width, shift);
+			break;
+		case PIXMAN_COLOR_TRANSFORM_LUT_3D:
+			apply_lut_3d(tr, row, width, shift);
+			break;
+		}
+	}
+}
+
+/**
+ * Get the position of the color channels in a pixel, for 32-bit formats with
+ * 8-bit channels.
+ */
+static bool get_channel_shifts(pixman_format_code_t format, int shift[static 3]) {
+	if (PIXMAN_FORMAT_BPP(format) != 32 || PIXMAN_FORMAT_R(format) != 8 ||
+			PIXMAN_FORMAT_G(format) != 8 || PIXMAN_FORMAT_B(format) != 8) {
+		return false;
+	}
+
+	switch (PIXMAN_FORMAT_TYPE(format)) {
+	case PIXMAN_TYPE_ARGB:
+		shift[0] = 16, shift[1] = 8, shift[2] = 0;
+		return true;
+	case PIXMAN_TYPE_ABGR:
+		shift[0] = 0, shift[1] = 8, shift[2] = 16;
+		return true;
+	case PIXMAN_TYPE_RGBA:
+		shift[0] = 24, shift[1] = 16, shift[2] = 8;
+		return true;
+	case PIXMAN_TYPE_BGRA:
+		shift[0] = 8, shift[1] = 16, shift[2] = 24;
+		return true;
+	}
+	return false;
+}
+
+void pixman_color_transform_apply(struct wlr_pixman_color_transform *tr,
+		pixman_image_t *image, const pixman_region32_t *region) {
+	if (tr->type == PIXMAN_COLOR_TRANSFORM_IDENTITY) {
+		return;
+	}
+
+	int image_width = pixman_image_get_width(image);
+	int image_height = pixman_image_get_height(image);
+	int shift[3];
+	bool direct = get_channel_shifts(pixman_image_get_format(image), shift);
+
+	int rects_len;
+	const pixman_box32_t *rects = pixman_region32_rectangles(region, &rects_len);
+	for (int i = 0; i < rects_len; i++) {
+		int x1 = rects[i].x1 > 0 ? rects[i].x1 : 0;
+		int y1 = rects[i].y1 > 0 ? rects[i].y1 : 0;
+		int x2 = rects[i].x2 < image_width ? rects[i].x2 : image_width;
+		int y2 = rects[i].y2 < image_height ? rects[i].y2 : image_height;
+		if (x1 >= x2 || y1 >= y2) {
+			continue;
+		}
+
+		if (direct) {
+			int stride = pixman_image_get_stride(image);
+			uint8_t *data = (uint8_t *)pixman_image_get_data(image) +
+				(ptrdiff_t)y1 * stride + x1 * 4;
+			apply_rows(tr, data, stride, x2 - x1, y2 - y1, shift);
+			continue;
+		}
+
+		// Other formats go through a temporary 8-bit ARGB copy
+		pixman_image_t *tmp = pixman_image_create_bits_no_clear(PIXMAN_a8r8g8b8,
+			x2 - x1, y2 - y1, NULL, 0);
+		if (tmp == NULL) {
+			wlr_log(WLR_ERROR, "Failed to allocate color transform image");
+			return;
+		}
+		pixman_image_composite32(PIXMAN_OP_SRC, image, NULL, tmp,
+			x1, y1, 0, 0, 0, 0, x2 - x1, y2 - y1);
+		get_channel_shifts(PIXMAN_a8r8g8b8, shift);
+		apply_rows(tr, (uint8_t *)pixman_image_get_data(tmp),
+			pixman_image_get_stride(tmp), x2 - x1, y2 - y1, shift);
+		pixman_image_composite32(PIXMAN_OP_SRC, tmp, NULL, image,
+			0, 0, 0, 0, x1, y1, x2 - x1, y2 - y1);
+		pixman_image_unref(tmp);
+	}
+}
@@ -1,7 +1,11 @@
 #include <assert.h>
+#include <math.h>
 #include <stdlib.h>
 #include "render/pixman.h"
 
+// Largest pre-scaled copy of a texture kept around, in pixels
+#define MAX_SCALED_PIXELS (4096 * 4096)
+
 static const struct wlr_render_pass_impl render_pass_impl;
 
 static struct wlr_pixman_render_pass *get_render_pass(struct wlr_render_pass *wlr_pass) {
@@ -19,6 +23,12 @@ static struct wlr_pixman_texture *get_texture(struct wlr_texture *wlr_texture) {
 static bool render_pass_submit(struct wlr_render_pass *wlr_pass) {
 	struct wlr_pixman_render_pass *pass = get_render_pass(wlr_pass);
 
+	if (pass->color_transform != NULL) {
+		pixman_color_transform_apply(pass->color_transform,
+			pass->buffer->image, &pass->damage);
+	}
+	pixman_region32_fini(&pass->damage);
+
 	wlr_buffer_end_data_ptr_access(pass->buffer->buffer);
 	wlr_buffer_unlock(pass->buffer->buffer);
 	free(pass);
@@ -36,6 +46,174 @@ static pixman_op_t get_pixman_blending(enum wlr_render_blend_mode mode) {
 	abort();
 }
 
+/**
+ * Record the area drawn by an operation, to apply the color transform to it
+ * on submit.
+ */
+static void render_pass_add_damage(struct wlr_pixman_render_pass *pass,
+		const struct wlr_box *box, const pixman_region32_t *clip) {
+	if (pass->color_transform == NULL) {
+		return;
+	}
+
+	pixman_region32_t region;
+	pixman_region32_init_rect(&region, box->x, box->y, box->width, box->height);
+	if (clip != NULL) {
+		pixman_region32_intersect(&region, &region, clip);
+	}
+	pixman_region32_union(&pass->damage, &pass->damage, &region);
+	pixman_region32_fini(&region);
+}
+
+/**
+ * Get the part of a scaled copy of a texture covering a texture-local box,
+ * with a margin for the filter footprint.
+ */
+static bool get_scaled_box(const struct wlr_pixman_scaled_texture *scaled,
+		const struct pixman_f_transform *inverse, const pixman_box32_t *rect,
+		pixman_box32_t *out) {
+	struct wlr_box box = {
+		.x = rect->x1,
+		.y = rect->y1,
+		.width = rect->x2 - rect->x1,
+		.height = rect->y2 - rect->y1,
+	};
+	if (!wlr_box_intersection(&box, &box, &scaled->src_box)) {
+		return false;
+	}
+
+	double x1 = INFINITY, y1 = INFINITY, x2 = -INFINITY, y2 = -INFINITY;
+	for (int i = 0; i < 4; i++) {
+		struct pixman_f_vector v = {{
+			box.x + (i % 2 == 0 ? 0 : box.width),
+			box.y + (i / 2 == 0 ? 0 : box.height),
+			1,
+		}};
+		pixman_f_transform_point(inverse, &v);
+		x1 = fmin(x1, v.v[0]);
+		y1 = fmin(y1, v.v[1]);
+		x2 = fmax(x2, v.v[0]);
+		y2 = fmax(y2, v.v[1]);
+	}
+
+	*out = (pixman_box32_t){
+		.x1 = fmax(floor(x1) - 1, 0),
+		.y1 = fmax(floor(y1) - 1, 0),
+		.x2 = fmin(ceil(x2) + 1, scaled->width),
+		.y2 = fmin(ceil(y2) + 1, scaled->height),
+	};
+	return out->x1 < out->x2 && out->y1 < out->y2;
+}
+
+static bool scaled_texture_matches(const struct wlr_pixman_scaled_texture *scaled,
+		const struct wlr_box *src_box, const struct wlr_box *dst_box,
+		const struct wlr_render_texture_options *options) {
+	return scaled->last_used != 0 &&
+		wlr_box_equal(&scaled->src_box, src_box) &&
+		scaled->width == dst_box->width &&
+		scaled->height == dst_box->height &&
+		scaled->transform == options->transform &&
+		scaled->filter_mode == options->filter_mode;
+}
+
+/**
+ * Get a copy of the texture scaled to the destination size, with the
+ * transform and filter of texture->image applied.
+ *
+ * A few copies are kept per texture, so that a texture shown on outputs with
+ * different scales or transforms doesn't evict its copies every frame. The
+ * least recently used one is replaced. A copy is only created the second time
+ * the texture is drawn with the same parameters, so that textures drawn once
+ * or resized every frame don't pay for scaling more than the damaged area.
+ * Returns NULL if the texture should be drawn directly.
+ */
+static pixman_image_t *texture_get_scaled(struct wlr_pixman_texture *texture,
+		const struct wlr_box *src_box, const struct wlr_box *dst_box,
+		const struct wlr_render_texture_options *options,
+		const struct pixman_transform *transform) {
+	if (dst_box->width <= 0 || dst_box->height <= 0 ||
+			(int64_t)dst_box->width * dst_box->height > MAX_SCALED_PIXELS) {
+		return NULL;
+	}
+
+	struct wlr_pixman_scaled_texture *scaled = NULL;
+	struct wlr_pixman_scaled_texture *lru = &texture->scaled[0];
+	for (size_t i = 0; i < PIXMAN_TEXTURE_SCALED_LEN; i++) {
+		struct wlr_pixman_scaled_texture *entry = &texture->scaled[i];
+		if (scaled_texture_matches(entry, src_box, dst_box, options)) {
+			scaled = entry;
+			break;
+		}
+		if (entry->last_used < lru->last_used) {
+			lru = entry;
+		}
+	}
+
+	texture->scaled_seq++;
+	if (scaled == NULL) {
+		// Remember the parameters, the copy is made if they are used again
+		pixman_scaled_texture_reset(lru);
+		lru->src_box = *src_box;
+		lru->width = dst_box->width;
+		lru->height = dst_box->height;
+		lru->transform = options->transform;
+		lru->filter_mode = options->filter_mode;
+		lru->last_used = texture->scaled_seq;
+		return NULL;
+	}
+	scaled->last_used = texture->scaled_seq;
+
+	if (scaled->image == NULL) {
+		scaled->image = pixman_image_create_bits_no_clear(PIXMAN_a8r8g8b8,
+			dst_box->width, dst_box->height, NULL, 0);
+		if (scaled->image == NULL) {
+			return NULL;
+		}
+		pixman_image_composite32(PIXMAN_OP_SRC, texture->image, NULL,
+			scaled->image, 0, 0, 0, 0, 0, 0,
+			dst_box->width, dst_box->height);
+		return scaled->image;
+	}
+
+	if (!pixman_region32_not_empty(&scaled->damage)) {
+		return scaled->image;
+	}
+
+	// The transform maps scaled coordinates to texture coordinates, its
+	// inverse gives the scaled area touched by the texture damage
+	struct pixman_f_transform forward, inverse;
+	pixman_f_transform_from_pixman(&forward, transform);
+	if (!pixman_f_transform_invert(&inverse, &forward)) {
+		pixman_scaled_texture_reset(scaled);
+		return NULL;
+	}
+
+	pixman_region32_t scaled_damage;
+	pixman_region32_init(&scaled_damage);
+	int rects_len;
+	const pixman_box32_t *rects =
+		pixman_region32_rectangles(&scaled->damage, &rects_len);
+	for (int i = 0; i < rects_len; i++) {
+		pixman_box32_t box;
+		if (get_scaled_box(scaled, &inverse, &rects[i], &box)) {
+			pixman_region32_union_rect(&scaled_damage, &scaled_damage,
+				box.x1, box.y1, box.x2 - box.x1, box.y2 - box.y1);
+		}
+	}
+	pixman_region32_clear(&scaled->damage);
+
+	rects = pixman_region32_rectangles(&scaled_damage, &rects_len);
+	for (int i = 0; i < rects_len; i++) {
+		const pixman_box32_t *box = &rects[i];
+		pixman_image_composite32(PIXMAN_OP_SRC, texture->image, NULL,
+			scaled->image, box->x1, box->y1, 0, 0, box->x1, box->y1,
+			box->x2 - box->x1, box->y2 - box->y1);
+	}
+	pixman_region32_fini(&scaled_damage);
+
+	return scaled->image;
+}
+
 static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 		const struct wlr_render_texture_options *options) {
 	struct wlr_pixman_render_pass *pass = get_render_pass(wlr_pass);
@@ -171,7 +349,13 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 		// width,height part of source crop is done here by the width and height we pass:
 		// because of the scaling, cropping at the end by dst_box.{width,height} is
 		// equivalent to if we cropped at the start by src_box.{width,height}.
-		pixman_image_composite32(op, texture->image, mask, buffer->image,
+		//
+		// Scaling is much slower than a blit, so prefer a pre-scaled copy of the
+		// texture when it's drawn the same way as before.
+		pixman_image_t *scaled = texture_get_scaled(texture, &src_box, &dst_box,
+			options, &transform);
+		pixman_image_composite32(op, scaled != NULL ? scaled : texture->image,
+			mask, buffer->image,
 			0, 0, // source x,y
 			0, 0, // mask x,y
 			dst_box.x, dst_box.y, // dest x,y
@@ -188,6 +372,7 @@ static void render_pass_add_texture(struct wlr_render_pass *wlr_pass,
 	}
 
 	pixman_image_set_clip_region32(buffer->image, NULL);
+	render_pass_add_damage(pass, &dst_box, options->clip);
 
 	if (texture->buffer != NULL) {
 		wlr_buffer_end_data_ptr_access(texture->buffer);
@@ -221,6 +406,7 @@ static void render_pass_add_rect(struct wlr_render_pass *wlr_pass,
 	pixman_image_composite32(op, fill, NULL, buffer->image,
 		0, 0, 0, 0, box.x, box.y, box.width, box.height);
 	pixman_image_set_clip_region32(buffer->image, NULL);
+	render_pass_add_damage(pass, &box, options->clip);
 
 	pixman_image_unref(fill);
 }
@@ -232,7 +418,8 @@ static const struct wlr_render_pass_impl render_pass_impl = {
 };
 
 struct wlr_pixman_render_pass *begin_pixman_render_pass(
-		struct wlr_pixman_buffer *buffer) {
+		struct wlr_pixman_buffer *buffer,
+		struct wlr_pixman_color_transform *color_transform) {
 	struct wlr_pixman_render_pass *pass = calloc(1, sizeof(*pass));
 	if (pass == NULL) {
 		return NULL;
@@ -248,6 +435,8 @@ struct wlr_pixman_render_pass *begin_pixman_render_pass(
 
 	wlr_buffer_lock(buffer->buffer);
 	pass->buffer = buffer;
+	pass->color_transform = color_transform;
+	pixman_region32_init(&pass->damage);
 
 	return pass;
 }
@@ -104,10 +104,12 @@ static const struct wlr_pixman_pixel_format formats[] = {
 };
 
 pixman_format_code_t get_pixman_format_from_drm(uint32_t fmt) {
-	for (size_t i = 0; i < sizeof(formats) / sizeof(*formats); ++i) {
-		if (formats[i].drm_format == fmt) {
-			return formats[i].pixman_format;
-		}
+	static struct pixel_format_index index = {0};
+	const struct wlr_pixman_pixel_format *format = pixel_format_index_find(&index,
+		formats, sizeof(formats) / sizeof(formats[0]), sizeof(formats[0]),
+		offsetof(struct wlr_pixman_pixel_format, drm_format), fmt);
+	if (format != NULL) {
+		return format->pixman_format;
 	}
 
 	wlr_log(WLR_ERROR, "DRM format 0x%"PRIX32" has no pixman equivalent", fmt);
@@ -80,15 +80,84 @@ static struct wlr_pixman_texture *get_texture(
 	return texture;
 }
 
+void pixman_scaled_texture_reset(struct wlr_pixman_scaled_texture *scaled) {
+	if (scaled->image != NULL) {
+		pixman_image_unref(scaled->image);
+		scaled->image = NULL;
+	}
+	pixman_region32_clear(&scaled->damage);
+	scaled->last_used = 0;
+}
+
+static void texture_init_scaled(struct wlr_pixman_texture *texture) {
+	for (size_t i = 0; i < PIXMAN_TEXTURE_SCALED_LEN; i++) {
+		pixman_region32_init(&texture->scaled[i].damage);
+	}
+}
+
+static void texture_finish_scaled(struct wlr_pixman_texture *texture) {
+	for (size_t i = 0; i < PIXMAN_TEXTURE_SCALED_LEN; i++) {
+		pixman_scaled_texture_reset(&texture->scaled[i]);
+		pixman_region32_fini(&texture->scaled[i].damage);
+	}
+}
+
 static void texture_destroy(struct wlr_texture *wlr_texture) {
 	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
 	wl_list_remove(&texture->link);
+	texture_finish_scaled(texture);
 	pixman_image_unref(texture->image);
 	wlr_buffer_unlock(texture->buffer);
 	free(texture->data);
 	free(texture);
 }
 
+static bool texture_update_from_buffer(struct wlr_texture *wlr_texture,
+		struct wlr_buffer *buffer, const pixman_region32_t *damage) {
+	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
+
+	// Textures created from pixels own a copy of their data
+	if (texture->buffer == NULL) {
+		return false;
+	}
+
+	void *data;
+	uint32_t drm_format;
+	size_t stride;
+	if (!wlr_buffer_begin_data_ptr_access(buffer, WLR_BUFFER_DATA_PTR_ACCESS_READ,
+			&data, &drm_format, &stride)) {
+		return false;
+	}
+	wlr_buffer_end_data_ptr_access(buffer);
+
+	if (drm_format != texture->format_info->drm_format) {
+		return false;
+	}
+
+	pixman_image_t *image = pixman_image_create_bits_no_clear(texture->format,
+		buffer->width, buffer->height, data, stride);
+	if (image == NULL) {
+		return false;
+	}
+
+	// Like textures created from buffers, reference the buffer instead of
+	// copying the damaged area
+	pixman_image_unref(texture->image);
+	texture->image = image;
+	wlr_buffer_unlock(texture->buffer);
+	texture->buffer = wlr_buffer_lock(buffer);
+
+	// Only the damaged area of the scaled copies needs to be re-scaled
+	for (size_t i = 0; i < PIXMAN_TEXTURE_SCALED_LEN; i++) {
+		struct wlr_pixman_scaled_texture *scaled = &texture->scaled[i];
+		if (scaled->image != NULL) {
+			pixman_region32_union(&scaled->damage, &scaled->damage, damage);
+		}
+	}
+
+	return true;
+}
+
 static bool texture_read_pixels(struct wlr_texture *wlr_texture,
 		const struct wlr_texture_read_pixels_options *options) {
 	struct wlr_pixman_texture *texture = get_texture(wlr_texture);
@@ -123,6 +192,7 @@ static uint32_t pixman_texture_preferred_read_format(struct wlr_texture *wlr_tex
 }
 
 static const struct wlr_texture_impl texture_impl = {
+	.update_from_buffer = texture_update_from_buffer,
 	.read_pixels = texture_read_pixels,
 	.preferred_read_format = pixman_texture_preferred_read_format,
 	.destroy = texture_destroy,
@@ -236,6 +306,7 @@ static struct wlr_pixman_texture *pixman_texture_create(
 		return NULL;
 	}
 
+	texture_init_scaled(texture);
 	wl_list_insert(&renderer->textures, &texture->link);
 
 	return texture;
@@ -265,6 +336,7 @@ static struct wlr_texture *pixman_texture_from_buffer(
 	if (!texture->image) {
 		wlr_log(WLR_ERROR, "Failed to create pixman image");
 		wl_list_remove(&texture->link);
+		texture_finish_scaled(texture);
 		free(texture);
 		return NULL;
 	}
@@ -287,6 +359,11 @@ static void pixman_destroy(struct wlr_renderer *wlr_renderer) {
 		wlr_texture_destroy(&tex->wlr_texture);
 	}
 
+	struct wlr_pixman_color_transform *tr, *tr_tmp;
+	wl_list_for_each_safe(tr, tr_tmp, &renderer->color_transforms, link) {
+		pixman_color_transform_destroy(tr);
+	}
+
 	wlr_drm_format_set_finish(&renderer->drm_formats);
 
 	free(renderer);
@@ -304,7 +381,20 @@ static struct wlr_render_pass *pixman_begin_buffer_pass(struct wlr_renderer *wlr
 		return NULL;
 	}
 
-	struct wlr_pixman_render_pass *pass = begin_pixman_render_pass(buffer);
+	struct wlr_pixman_color_transform *color_transform = NULL;
+	if (options != NULL && options->color_transform != NULL) {
+		color_transform = pixman_color_transform_get(renderer,
+			options->color_transform);
+		if (color_transform == NULL) {
+			return NULL;
+		}
+		if (pixman_color_transform_is_identity(color_transform)) {
+			color_transform = NULL;
+		}
+	}
+
+	struct wlr_pixman_render_pass *pass =
+		begin_pixman_render_pass(buffer, color_transform);
 	if (pass == NULL) {
 		return NULL;
 	}
@@ -327,9 +417,10 @@ struct wlr_renderer *wlr_pixman_renderer_create(void) {
 
 	wlr_log(WLR_INFO, "Creating pixman renderer");
 	wlr_renderer_init(&renderer->wlr_renderer, &renderer_impl, WLR_BUFFER_CAP_DATA_PTR);
-	renderer->wlr_renderer.features.output_color_transform = false;
+	renderer->wlr_renderer.features.output_color_transform = true;
 	wl_list_init(&renderer->buffers);
 	wl_list_init(&renderer->textures);
+	wl_list_init(&renderer->color_transforms);
 
 	size_t len = 0;
 	const uint32_t *formats = get_pixman_drm_formats(&len);
@@ -241,12 +241,10 @@ const struct wlr_vk_format *vulkan_get_format_list(size_t *len) {
 }
 
 const struct wlr_vk_format *vulkan_get_format_from_drm(uint32_t drm_format) {
-	for (unsigned i = 0; i < sizeof(formats) / sizeof(formats[0]); ++i) {
-		if (formats[i].drm == drm_format) {
-			return &formats[i];
-		}
-	}
-	return NULL;
+	static struct pixel_format_index index = {0};
+	return pixel_format_index_find(&index, formats,
+		sizeof(formats) / sizeof(formats[0]), sizeof(formats[0]),
+		offsetof(struct wlr_vk_format, drm), drm_format);
 }
 
 const VkImageUsageFlags vulkan_render_usage =
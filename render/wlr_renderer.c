@@ -27,6 +27,7 @@
 
 #include "render/wlr_renderer.h"
 #include "util/env.h"
+#include "util/trace.h"
 
 void wlr_renderer_init(struct wlr_renderer *renderer,
 		const struct wlr_renderer_impl *impl, uint32_t render_buffer_caps) {
@@ -311,7 +312,11 @@ struct wlr_render_pass *wlr_renderer_begin_buffer_pass(struct wlr_renderer *rend
 		options = &default_options;
 	}
 
-	return renderer->impl->begin_buffer_pass(renderer, buffer, options);
+	TRACE_BEGIN(TRACE_RENDER_PASS_BEGIN, 0);
+	struct wlr_render_pass *pass =
+		renderer->impl->begin_buffer_pass(renderer, buffer, options);
+	TRACE_END(TRACE_RENDER_PASS_BEGIN, pass != NULL);
+	return pass;
 }
 
 struct wlr_render_timer *wlr_render_timer_create(struct wlr_renderer *renderer) {
@@ -7,6 +7,7 @@
 #include <unistd.h>
 #include <wayland-server-core.h>
 #include <wlr/backend.h>
+#include <wlr/backend/wayland.h>
 #include <wlr/render/allocator.h>
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/types/wlr_cursor.h>
@@ -17,6 +18,7 @@
 #include <wlr/types/wlr_output.h>
 #include <wlr/types/wlr_output_layout.h>
 #include <wlr/types/wlr_pointer.h>
+#include <wlr/types/wlr_presentation_time.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/types/wlr_seat.h>
 #include <wlr/types/wlr_subcompositor.h>
@@ -579,8 +581,13 @@ static void output_frame(struct wl_listener *listener, void *data) {
 	struct wlr_scene_output *scene_output = wlr_scene_get_scene_output(
 		scene, output->wlr_output);
 
-	/* Render the scene if needed and commit the output */
-	wlr_scene_output_commit(scene_output, NULL);
+	/* Render the scene if needed and commit the output. When running nested
+	 * in another Wayland compositor, the topmost windows can be handed to it
+	 * as sub-surfaces instead of being composited. */
+	struct wlr_scene_output_state_options options = {
+		.offload_layers = wlr_output_is_wl(output->wlr_output),
+	};
+	wlr_scene_output_commit(scene_output, &options);
 
 	struct timespec now;
 	clock_gettime(CLOCK_MONOTONIC, &now);
@@ -952,6 +959,11 @@ int main(int argc, char *argv[]) {
 	wlr_subcompositor_create(server.wl_display);
 	wlr_data_device_manager_create(server.wl_display);
 
+	/* The presentation-time interface lets clients know when their frames
+	 * actually made it to the screen. The scene graph sends the feedback for
+	 * us. */
+	wlr_presentation_create(server.wl_display, server.backend, 2);
+
 	/* Creates an output layout, which a wlroots utility for working with an
 	 * arrangement of screens in a physical layout. */
 	server.output_layout = wlr_output_layout_create(server.wl_display);
@@ -969,6 +981,9 @@ int main(int argc, char *argv[]) {
 	 * necessary.
 	 */
 	server.scene = wlr_scene_create();
+	/* Only surfaces need frame done events here, and they request them
+	 * themselves: no need to walk the whole scene-graph on every frame. */
+	server.scene->frame_done_on_request = true;
 	server.scene_layout = wlr_scene_attach_output_layout(server.scene, server.output_layout);
 
 	/* Set up xdg-shell version 3. The xdg-shell is a Wayland protocol which is
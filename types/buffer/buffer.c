@@ -134,6 +134,10 @@ bool wlr_buffer_is_opaque(struct wlr_buffer *buffer) {
 }
 
 uint32_t buffer_get_drm_format(struct wlr_buffer *buffer) {
+	if (buffer->drm_format != DRM_FORMAT_INVALID) {
+		return buffer->drm_format;
+	}
+
 	uint32_t format = DRM_FORMAT_INVALID;
 	struct wlr_dmabuf_attributes dmabuf;
 	struct wlr_shm_attributes shm;
@@ -142,5 +146,16 @@ uint32_t buffer_get_drm_format(struct wlr_buffer *buffer) {
 	} else if (wlr_buffer_get_shm(buffer, &shm)) {
 		format = shm.format;
 	}
+
+	if (format != DRM_FORMAT_INVALID) {
+		buffer->drm_format = format;
+		buffer->format_info = drm_get_pixel_format_info(format);
+	}
 	return format;
 }
+
+const struct wlr_pixel_format_info *buffer_get_format_info(
+		struct wlr_buffer *buffer) {
+	buffer_get_drm_format(buffer);
+	return buffer->format_info;
+}
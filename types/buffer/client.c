@@ -4,6 +4,7 @@
 #include <wlr/render/wlr_renderer.h>
 #include <wlr/util/log.h>
 #include "types/wlr_buffer.h"
+#include "types/wlr_client_memory.h"
 
 static const struct wlr_buffer_impl client_buffer_impl;
 
@@ -30,6 +31,9 @@ static void client_buffer_destroy(struct wlr_buffer *buffer) {
 	wl_list_remove(&client_buffer->source_destroy.link);
 	wl_list_remove(&client_buffer->renderer_destroy.link);
 	wlr_texture_destroy(client_buffer->texture);
+	client_memory_release(client_buffer->memory, WLR_CLIENT_MEMORY_TEXTURE,
+		client_buffer->memory_size);
+	client_memory_unref(client_buffer->memory);
 	free(client_buffer);
 }
 
@@ -143,5 +147,15 @@ bool wlr_client_buffer_apply_damage(struct wlr_client_buffer *client_buffer,
 		return false;
 	}
 
-	return wlr_texture_update_from_buffer(client_buffer->texture, next, damage);
+	if (!wlr_texture_update_from_buffer(client_buffer->texture, next, damage)) {
+		return false;
+	}
+
+	// The texture now shows the contents of the next buffer, the previous
+	// one is about to be released to the client
+	wl_list_remove(&client_buffer->source_destroy.link);
+	client_buffer->source = next;
+	wl_signal_add(&next->events.destroy, &client_buffer->source_destroy);
+
+	return true;
 }
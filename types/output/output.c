@@ -11,6 +11,8 @@
 #include "types/wlr_output.h"
 #include "util/env.h"
 #include "util/global.h"
+#include "util/sched.h"
+#include "util/trace.h"
 
 #define OUTPUT_VERSION 4
 
@@ -171,7 +173,7 @@ void wlr_output_schedule_done(struct wlr_output *output) {
 		return; // Already scheduled
 	}
 
-	output->idle_done = wl_event_loop_add_idle(output->event_loop,
+	output->idle_done = sched_post(output->event_loop, SCHED_CLASS_PROTOCOL, 0,
 		schedule_done_handle_idle_timer, output);
 }
 
@@ -426,11 +428,11 @@ void wlr_output_finish(struct wlr_output *output) {
 	wlr_swapchain_destroy(output->swapchain);
 
 	if (output->idle_frame != NULL) {
-		wl_event_source_remove(output->idle_frame);
+		sched_task_cancel(output->idle_frame);
 	}
 
 	if (output->idle_done != NULL) {
-		wl_event_source_remove(output->idle_done);
+		sched_task_cancel(output->idle_done);
 	}
 
 	free(output->name);
@@ -751,7 +753,7 @@ bool output_prepare_commit(struct wlr_output *output, const struct wlr_output_st
 
 	if ((state->committed & WLR_OUTPUT_STATE_BUFFER) &&
 			output->idle_frame != NULL) {
-		wl_event_source_remove(output->idle_frame);
+		sched_task_cancel(output->idle_frame);
 		output->idle_frame = NULL;
 	}
 
@@ -813,7 +815,10 @@ bool wlr_output_commit_state(struct wlr_output *output,
 		return false;
 	}
 
-	if (!output->impl->commit(output, &pending)) {
+	TRACE_BEGIN(TRACE_OUTPUT_COMMIT, output->commit_seq);
+	bool ok = output->impl->commit(output, &pending);
+	TRACE_END(TRACE_OUTPUT_COMMIT, ok);
+	if (!ok) {
 		if (new_back_buffer) {
 			wlr_buffer_unlock(pending.buffer);
 		}
@@ -833,6 +838,7 @@ bool wlr_output_commit_state(struct wlr_output *output,
 void wlr_output_send_frame(struct wlr_output *output) {
 	output->frame_pending = false;
 	if (output->enabled) {
+		TRACE_INSTANT(TRACE_OUTPUT_FRAME, 0);
 		wl_signal_emit_mutable(&output->events.frame, output);
 	}
 }
@@ -857,7 +863,7 @@ void wlr_output_schedule_frame(struct wlr_output *output) {
 
 	// We're using an idle timer here in case a buffer swap happens right after
 	// this function is called
-	output->idle_frame = wl_event_loop_add_idle(output->event_loop,
+	output->idle_frame = sched_post(output->event_loop, SCHED_CLASS_FRAME, 0,
 		schedule_frame_handle_idle_timer, output);
 }
 
@@ -874,12 +880,13 @@ void wlr_output_send_present(struct wlr_output *output,
 		}
 	}
 
+	TRACE_INSTANT(TRACE_OUTPUT_PRESENT, event->commit_seq);
 	wl_signal_emit_mutable(&output->events.present, event);
 }
 
 struct deferred_present_event {
 	struct wlr_output *output;
-	struct wl_event_source *idle_source;
+	struct sched_task *task;
 	struct wlr_output_event_present event;
 	struct wl_listener output_destroy;
 };
@@ -897,7 +904,7 @@ static void deferred_present_event_handle_idle(void *data) {
 
 static void deferred_present_event_handle_output_destroy(struct wl_listener *listener, void *data) {
 	struct deferred_present_event *deferred = wl_container_of(listener, deferred, output_destroy);
-	wl_event_source_remove(deferred->idle_source);
+	sched_task_cancel(deferred->task);
 	deferred_present_event_destroy(deferred);
 }
 
@@ -913,8 +920,12 @@ void output_defer_present(struct wlr_output *output, struct wlr_output_event_pre
 	deferred->output_destroy.notify = deferred_present_event_handle_output_destroy;
 	wl_signal_add(&output->events.destroy, &deferred->output_destroy);
 
-	deferred->idle_source = wl_event_loop_add_idle(output->event_loop,
+	// Present events feed the frame timing of the compositor
+	deferred->task = sched_post(output->event_loop, SCHED_CLASS_FRAME, 0,
 		deferred_present_event_handle_idle, deferred);
+	if (deferred->task == NULL) {
+		deferred_present_event_destroy(deferred);
+	}
 }
 
 void output_state_get_buffer_src_box(const struct wlr_output_state *state,
@@ -90,6 +90,25 @@ static void get_surface_preferred_image_description(struct wlr_surface *surface,
 	};
 }
 
+// Subscribe the surface to frame done events on its frame pacing output, if
+// it is waiting for frame callbacks
+static void scene_surface_request_frame_done(struct wlr_scene_surface *surface) {
+	if (wl_list_empty(&surface->surface->current.frame_callback_list)) {
+		return;
+	}
+
+	struct wlr_output *output = get_surface_frame_pacing_output(surface->surface);
+	if (output == NULL) {
+		return;
+	}
+
+	struct wlr_scene *scene = scene_node_get_root(&surface->buffer->node);
+	struct wlr_scene_output *scene_output = wlr_scene_get_scene_output(scene, output);
+	if (scene_output != NULL) {
+		wlr_scene_buffer_request_frame_done(surface->buffer, scene_output);
+	}
+}
+
 static void handle_scene_buffer_outputs_update(
 		struct wl_listener *listener, void *data) {
 	struct wlr_scene_surface *surface =
@@ -112,6 +131,9 @@ static void handle_scene_buffer_outputs_update(
 		wlr_color_manager_v1_set_surface_preferred_image_description(scene->color_manager_v1,
 			surface->surface, &img_desc);
 	}
+
+	// The frame pacing output may have changed
+	scene_surface_request_frame_done(surface);
 }
 
 static void handle_scene_buffer_output_enter(
@@ -205,50 +227,9 @@ static int min(int a, int b) {
 	return a < b ? a : b;
 }
 
-static void surface_reconfigure(struct wlr_scene_surface *scene_surface) {
+static void surface_reconfigure_metadata(struct wlr_scene_surface *scene_surface) {
 	struct wlr_scene_buffer *scene_buffer = scene_surface->buffer;
 	struct wlr_surface *surface = scene_surface->surface;
-	struct wlr_surface_state *state = &surface->current;
-
-	struct wlr_fbox src_box;
-	wlr_surface_get_buffer_source_box(surface, &src_box);
-
-	pixman_region32_t opaque;
-	pixman_region32_init(&opaque);
-	pixman_region32_copy(&opaque, &surface->opaque_region);
-
-	int width = state->width;
-	int height = state->height;
-
-	if (!wlr_box_empty(&scene_surface->clip)) {
-		struct wlr_box *clip = &scene_surface->clip;
-
-		int buffer_width = state->buffer_width;
-		int buffer_height = state->buffer_height;
-		width = min(clip->width, width - clip->x);
-		height = min(clip->height, height - clip->y);
-
-		wlr_fbox_transform(&src_box, &src_box, state->transform,
-			buffer_width, buffer_height);
-		wlr_output_transform_coords(state->transform, &buffer_width, &buffer_height);
-
-		src_box.x += (double)(clip->x * src_box.width) / state->width;
-		src_box.y += (double)(clip->y * src_box.height) / state->height;
-		src_box.width *= (double)width / state->width;
-		src_box.height *= (double)height / state->height;
-
-		wlr_fbox_transform(&src_box, &src_box, wlr_output_transform_invert(state->transform),
-			buffer_width, buffer_height);
-
-		pixman_region32_translate(&opaque, -clip->x, -clip->y);
-		pixman_region32_intersect_rect(&opaque, &opaque, 0, 0, width, height);
-	}
-
-	if (width <= 0 || height <= 0) {
-		wlr_scene_buffer_set_buffer(scene_buffer, NULL);
-		pixman_region32_fini(&opaque);
-		return;
-	}
 
 	float opacity = 1.0;
 	const struct wlr_alpha_modifier_surface_v1_state *alpha_modifier_state =
@@ -279,15 +260,16 @@ static void surface_reconfigure(struct wlr_scene_surface *scene_surface) {
 		}
 	}
 
-	wlr_scene_buffer_set_opaque_region(scene_buffer, &opaque);
-	wlr_scene_buffer_set_source_box(scene_buffer, &src_box);
-	wlr_scene_buffer_set_dest_size(scene_buffer, width, height);
-	wlr_scene_buffer_set_transform(scene_buffer, state->transform);
 	wlr_scene_buffer_set_opacity(scene_buffer, opacity);
 	wlr_scene_buffer_set_transfer_function(scene_buffer, tf);
 	wlr_scene_buffer_set_primaries(scene_buffer, primaries);
 	wlr_scene_buffer_set_color_encoding(scene_buffer, color_encoding);
 	wlr_scene_buffer_set_color_range(scene_buffer, color_range);
+}
+
+static void surface_reconfigure_buffer(struct wlr_scene_surface *scene_surface) {
+	struct wlr_scene_buffer *scene_buffer = scene_surface->buffer;
+	struct wlr_surface *surface = scene_surface->surface;
 
 	scene_buffer_unmark_client_buffer(scene_buffer);
 
@@ -335,17 +317,108 @@ static void surface_reconfigure(struct wlr_scene_surface *scene_surface) {
 	} else {
 		wlr_scene_buffer_set_buffer(scene_buffer, NULL);
 	}
+}
+
+static void surface_reconfigure(struct wlr_scene_surface *scene_surface) {
+	struct wlr_scene_buffer *scene_buffer = scene_surface->buffer;
+	struct wlr_surface *surface = scene_surface->surface;
+	struct wlr_surface_state *state = &surface->current;
+
+	struct wlr_fbox src_box;
+	wlr_surface_get_buffer_source_box(surface, &src_box);
+
+	pixman_region32_t opaque;
+	pixman_region32_init(&opaque);
+	pixman_region32_copy(&opaque, &surface->opaque_region);
+
+	int width = state->width;
+	int height = state->height;
+
+	if (!wlr_box_empty(&scene_surface->clip)) {
+		struct wlr_box *clip = &scene_surface->clip;
+
+		int buffer_width = state->buffer_width;
+		int buffer_height = state->buffer_height;
+		width = min(clip->width, width - clip->x);
+		height = min(clip->height, height - clip->y);
+
+		wlr_fbox_transform(&src_box, &src_box, state->transform,
+			buffer_width, buffer_height);
+		wlr_output_transform_coords(state->transform, &buffer_width, &buffer_height);
+
+		src_box.x += (double)(clip->x * src_box.width) / state->width;
+		src_box.y += (double)(clip->y * src_box.height) / state->height;
+		src_box.width *= (double)width / state->width;
+		src_box.height *= (double)height / state->height;
+
+		wlr_fbox_transform(&src_box, &src_box, wlr_output_transform_invert(state->transform),
+			buffer_width, buffer_height);
+
+		pixman_region32_translate(&opaque, -clip->x, -clip->y);
+		pixman_region32_intersect_rect(&opaque, &opaque, 0, 0, width, height);
+	}
+
+	if (width <= 0 || height <= 0) {
+		wlr_scene_buffer_set_buffer(scene_buffer, NULL);
+		pixman_region32_fini(&opaque);
+		scene_surface->geometry_valid = false;
+		return;
+	}
+
+	wlr_scene_buffer_set_opaque_region(scene_buffer, &opaque);
+	wlr_scene_buffer_set_source_box(scene_buffer, &src_box);
+	wlr_scene_buffer_set_dest_size(scene_buffer, width, height);
+	wlr_scene_buffer_set_transform(scene_buffer, state->transform);
+
+	scene_surface->geometry_valid = true;
+	scene_surface->width = state->width;
+	scene_surface->height = state->height;
+	scene_surface->buffer_width = state->buffer_width;
+	scene_surface->buffer_height = state->buffer_height;
+	scene_surface->has_buffer = wlr_surface_has_buffer(surface);
+	scene_surface->opaque = surface->opaque;
+
+	surface_reconfigure_metadata(scene_surface);
+	surface_reconfigure_buffer(scene_surface);
 
 	pixman_region32_fini(&opaque);
 }
 
+/**
+ * Check whether the last commit may have changed anything derived from the
+ * surface geometry: the source box, destination size, transform or opaque
+ * region of the scene buffer.
+ */
+static bool surface_geometry_changed(struct wlr_scene_surface *scene_surface) {
+	struct wlr_surface *surface = scene_surface->surface;
+	const struct wlr_surface_state *state = &surface->current;
+
+	uint32_t geometry_state = WLR_SURFACE_STATE_OPAQUE_REGION |
+		WLR_SURFACE_STATE_TRANSFORM | WLR_SURFACE_STATE_SCALE |
+		WLR_SURFACE_STATE_VIEWPORT;
+	return !scene_surface->geometry_valid ||
+		(state->committed & geometry_state) ||
+		state->width != scene_surface->width ||
+		state->height != scene_surface->height ||
+		state->buffer_width != scene_surface->buffer_width ||
+		state->buffer_height != scene_surface->buffer_height ||
+		wlr_surface_has_buffer(surface) != scene_surface->has_buffer ||
+		surface->opaque != scene_surface->opaque;
+}
+
 static void handle_scene_surface_surface_commit(
 		struct wl_listener *listener, void *data) {
 	struct wlr_scene_surface *surface =
 		wl_container_of(listener, surface, surface_commit);
 	struct wlr_scene_buffer *scene_buffer = surface->buffer;
 
-	surface_reconfigure(surface);
+	if (surface_geometry_changed(surface)) {
+		surface_reconfigure(surface);
+	} else {
+		// Fast path for commits which only attach new contents
+		surface_reconfigure_metadata(surface);
+		surface_reconfigure_buffer(surface);
+	}
 
 	// If the surface has requested a frame done event, honour that. The
 	// frame_callback_list will be populated in this case. We should only
@@ -359,6 +432,8 @@ static void handle_scene_surface_surface_commit(
 			surface->buffer->primary_output != NULL && enabled) {
 		wlr_output_schedule_frame(surface->buffer->primary_output->output);
 	}
+
+	scene_surface_request_frame_done(surface);
 }
 
 static bool scene_buffer_point_accepts_input(struct wlr_scene_buffer *scene_buffer,
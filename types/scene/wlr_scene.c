@@ -10,6 +10,7 @@
 #include <wlr/types/wlr_damage_ring.h>
 #include <wlr/types/wlr_gamma_control_v1.h>
 #include <wlr/types/wlr_linux_dmabuf_v1.h>
+#include <wlr/types/wlr_output_layer.h>
 #include <wlr/types/wlr_presentation_time.h>
 #include <wlr/types/wlr_scene.h>
 #include <wlr/util/log.h>
@@ -21,6 +22,7 @@
 #include "util/array.h"
 #include "util/env.h"
 #include "util/time.h"
+#include "util/trace.h"
 
 #include <wlr/config.h>
 
@@ -30,6 +32,8 @@
 
 #define DMABUF_FEEDBACK_DEBOUNCE_FRAMES  30
 #define HIGHLIGHT_DAMAGE_FADEOUT_TIME   250
+#define SCENE_OUTPUT_LAYERS_LEN 4
+#define SCENE_OUTPUT_LAYERS_RETRY_FRAMES 60
 
 struct wlr_scene_tree *wlr_scene_tree_from_node(struct wlr_scene_node *node) {
 	assert(node->type == WLR_SCENE_NODE_TREE);
@@ -95,6 +99,13 @@ static void scene_buffer_set_buffer(struct wlr_scene_buffer *scene_buffer,
 	struct wlr_buffer *buffer);
 static void scene_buffer_set_texture(struct wlr_scene_buffer *scene_buffer,
 	struct wlr_texture *texture);
+static void scene_buffer_cancel_frame_done(struct wlr_scene_buffer *scene_buffer,
+	struct wlr_scene *scene);
+static void scene_transaction_forget_node(struct wlr_scene *scene,
+	struct wlr_scene_node *node);
+static void scene_output_invalidate_dmabuf_feedback(
+	struct wlr_scene_output *scene_output);
+static void scene_output_layers_destroy(struct wlr_scene_output *scene_output);
 
 void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 	if (node == NULL) {
@@ -110,6 +121,7 @@ void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 	wlr_scene_node_set_enabled(node, false);
 
 	struct wlr_scene *scene = scene_node_get_root(node);
+	scene_transaction_forget_node(scene, node);
 	if (node->type == WLR_SCENE_NODE_BUFFER) {
 		struct wlr_scene_buffer *scene_buffer = wlr_scene_buffer_from_node(node);
 
@@ -124,6 +136,7 @@ void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 			}
 		}
 
+		scene_buffer_cancel_frame_done(scene_buffer, scene);
 		scene_buffer_set_buffer(scene_buffer, NULL);
 		scene_buffer_set_texture(scene_buffer, NULL);
 		pixman_region32_fini(&scene_buffer->opaque_region);
@@ -147,6 +160,10 @@ void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 			wl_list_remove(&scene->linux_dmabuf_v1_destroy.link);
 			wl_list_remove(&scene->gamma_control_manager_v1_destroy.link);
 			wl_list_remove(&scene->gamma_control_manager_v1_set_gamma.link);
+
+			pixman_region32_fini(&scene->transaction_update_region);
+			pixman_region32_fini(&scene->transaction_damage);
+			wl_array_release(&scene->transaction_nodes);
 		} else {
 			assert(node->parent);
 		}
@@ -156,6 +173,8 @@ void wlr_scene_node_destroy(struct wlr_scene_node *node) {
 				&scene_tree->children, link) {
 			wlr_scene_node_destroy(child);
 		}
+
+		pixman_region32_fini(&scene_tree->bounds);
 	}
 
 	assert(wl_list_empty(&node->events.destroy.listener_list));
@@ -170,6 +189,144 @@ static void scene_tree_init(struct wlr_scene_tree *tree,
 	*tree = (struct wlr_scene_tree){0};
 	scene_node_init(&tree->node, WLR_SCENE_NODE_TREE, parent);
 	wl_list_init(&tree->children);
+	pixman_region32_init(&tree->bounds);
+}
+
+/**
+ * Mark the cached bounds and visibility extents of the trees containing the
+ * node as out of date. Must be called whenever the node's geometry, stacking
+ * or enabled state changes.
+ */
+static void scene_node_invalidate_cache(struct wlr_scene_node *node) {
+	if (node->type == WLR_SCENE_NODE_TREE) {
+		// The tree's own bounds are relative to its position, but the
+		// visible regions of its descendants are about to move
+		wlr_scene_tree_from_node(node)->visible_dirty = true;
+	}
+
+	// A dirty tree always has dirty ancestors, stop at the first one
+	for (struct wlr_scene_tree *tree = node->parent; tree != NULL;
+			tree = tree->node.parent) {
+		if (tree->bounds_dirty && tree->visible_dirty) {
+			break;
+		}
+		tree->bounds_dirty = true;
+		tree->visible_dirty = true;
+	}
+}
+
+static void scene_node_bounds(struct wlr_scene_node *node,
+	int x, int y, pixman_region32_t *visible);
+
+static const pixman_region32_t *scene_tree_get_bounds(struct wlr_scene_tree *tree) {
+	if (!tree->bounds_dirty) {
+		return &tree->bounds;
+	}
+
+	pixman_region32_clear(&tree->bounds);
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &tree->children, link) {
+		scene_node_bounds(child, child->x, child->y, &tree->bounds);
+	}
+
+	tree->bounds_dirty = false;
+	return &tree->bounds;
+}
+
+static bool scene_tree_bounds_intersect(struct wlr_scene_tree *tree,
+		int lx, int ly, const struct wlr_box *box) {
+	const pixman_box32_t *extents =
+		pixman_region32_extents(scene_tree_get_bounds(tree));
+	struct wlr_box bounds = {
+		.x = lx + extents->x1,
+		.y = ly + extents->y1,
+		.width = extents->x2 - extents->x1,
+		.height = extents->y2 - extents->y1,
+	};
+	return wlr_box_intersection(&bounds, &bounds, box);
+}
+
+/**
+ * Returns true if no descendant of the tree is visible inside the box. Trees
+ * whose visibility extents are out of date are never considered invisible.
+ */
+static bool scene_tree_invisible_in_box(struct wlr_scene_tree *tree,
+		const struct wlr_box *box) {
+	if (tree->visible_dirty) {
+		return false;
+	}
+
+	const pixman_box32_t *extents = &tree->visible_extents;
+	struct wlr_box visible_box = {
+		.x = extents->x1,
+		.y = extents->y1,
+		.width = extents->x2 - extents->x1,
+		.height = extents->y2 - extents->y1,
+	};
+	return !wlr_box_intersection(&visible_box, &visible_box, box);
+}
+
+static void box_union(pixman_box32_t *dst, const pixman_box32_t *box) {
+	if (box->x1 >= box->x2 || box->y1 >= box->y2) {
+		return;
+	}
+	if (dst->x1 >= dst->x2 || dst->y1 >= dst->y2) {
+		*dst = *box;
+		return;
+	}
+
+	dst->x1 = dst->x1 < box->x1 ? dst->x1 : box->x1;
+	dst->y1 = dst->y1 < box->y1 ? dst->y1 : box->y1;
+	dst->x2 = dst->x2 > box->x2 ? dst->x2 : box->x2;
+	dst->y2 = dst->y2 > box->y2 ? dst->y2 : box->y2;
+}
+
+/**
+ * Recompute the visibility extents of a tree from its children. The result
+ * stays dirty if any child tree's extents are out of date.
+ */
+static void scene_tree_update_visible_extents(struct wlr_scene_tree *tree) {
+	pixman_box32_t extents = {0};
+	bool dirty = false;
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &tree->children, link) {
+		// The visible region of disabled nodes is always empty
+		if (!child->enabled) {
+			continue;
+		}
+
+		if (child->type == WLR_SCENE_NODE_TREE) {
+			struct wlr_scene_tree *child_tree = wlr_scene_tree_from_node(child);
+			dirty = dirty || child_tree->visible_dirty;
+			box_union(&extents, &child_tree->visible_extents);
+		} else {
+			box_union(&extents, pixman_region32_extents(&child->visible));
+		}
+	}
+
+	tree->visible_extents = extents;
+	tree->visible_dirty = dirty;
+}
+
+/**
+ * A tree without bounds has no visible descendant: mark the whole subtree as
+ * up to date without waiting for a visibility update to reach it.
+ */
+static void scene_tree_clear_visible_extents(struct wlr_scene_tree *tree) {
+	if (!tree->visible_dirty) {
+		return;
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each(child, &tree->children, link) {
+		if (child->enabled && child->type == WLR_SCENE_NODE_TREE) {
+			scene_tree_clear_visible_extents(wlr_scene_tree_from_node(child));
+		}
+	}
+
+	tree->visible_extents = (pixman_box32_t){0};
+	tree->visible_dirty = false;
 }
 
 struct wlr_scene *wlr_scene_create(void) {
@@ -185,6 +342,10 @@ struct wlr_scene *wlr_scene_create(void) {
 	wl_list_init(&scene->gamma_control_manager_v1_destroy.link);
 	wl_list_init(&scene->gamma_control_manager_v1_set_gamma.link);
 
+	pixman_region32_init(&scene->transaction_update_region);
+	pixman_region32_init(&scene->transaction_damage);
+	wl_array_init(&scene->transaction_nodes);
+
 	scene->restack_xwayland_surfaces = true;
 
 	const char *debug_damage_options[] = {
@@ -218,7 +379,8 @@ typedef bool (*scene_node_box_iterator_func_t)(struct wlr_scene_node *node,
 	int sx, int sy, void *data);
 
 static bool _scene_nodes_in_box(struct wlr_scene_node *node, struct wlr_box *box,
-		scene_node_box_iterator_func_t iterator, void *user_data, int lx, int ly) {
+		bool visible_only, scene_node_box_iterator_func_t iterator,
+		void *user_data, int lx, int ly) {
 	if (!node->enabled) {
 		return false;
 	}
@@ -226,9 +388,17 @@ static bool _scene_nodes_in_box(struct wlr_scene_node *node, struct wlr_box *box
 	switch (node->type) {
 	case WLR_SCENE_NODE_TREE:;
 		struct wlr_scene_tree *scene_tree = wlr_scene_tree_from_node(node);
+		if (!scene_tree_bounds_intersect(scene_tree, lx, ly, box)) {
+			break;
+		}
+		if (visible_only && scene_tree_invisible_in_box(scene_tree, box)) {
+			break;
+		}
+
 		struct wlr_scene_node *child;
 		wl_list_for_each_reverse(child, &scene_tree->children, link) {
-			if (_scene_nodes_in_box(child, box, iterator, user_data, lx + child->x, ly + child->y)) {
+			if (_scene_nodes_in_box(child, box, visible_only, iterator,
+					user_data, lx + child->x, ly + child->y)) {
 				return true;
 			}
 		}
@@ -253,7 +423,20 @@ static bool scene_nodes_in_box(struct wlr_scene_node *node, struct wlr_box *box,
 	int x, y;
 	wlr_scene_node_coords(node, &x, &y);
 
-	return _scene_nodes_in_box(node, box, iterator, user_data, x, y);
+	return _scene_nodes_in_box(node, box, false, iterator, user_data, x, y);
+}
+
+/**
+ * Same as scene_nodes_in_box(), but skips subtrees known to have no visible
+ * node inside the box.
+ */
+static bool scene_visible_nodes_in_box(struct wlr_scene_node *node,
+		struct wlr_box *box, scene_node_box_iterator_func_t iterator,
+		void *user_data) {
+	int x, y;
+	wlr_scene_node_coords(node, &x, &y);
+
+	return _scene_nodes_in_box(node, box, true, iterator, user_data, x, y);
 }
 
 static void scene_node_opaque_region(struct wlr_scene_node *node, int x, int y,
@@ -601,6 +784,81 @@ static bool scene_node_update_iterator(struct wlr_scene_node *node,
 	return false;
 }
 
+#if WLR_HAS_XWAYLAND
+static bool scene_node_restack_iterator(struct wlr_scene_node *node,
+		int lx, int ly, void *_data) {
+	struct scene_update_data *data = _data;
+
+	struct wlr_box box = { .x = lx, .y = ly };
+	scene_node_get_size(node, &box.width, &box.height);
+	restack_xwayland_surface(node, &box, data);
+
+	return false;
+}
+#endif
+
+/**
+ * Returns true if the update cannot change the visibility of any node in the
+ * tree: none of them is visible inside the update region, and the part of the
+ * update region not occluded by the nodes above doesn't reach the tree.
+ */
+static bool scene_tree_occluded(struct wlr_scene_tree *tree, int lx, int ly,
+		struct scene_update_data *data) {
+	if (!scene_tree_invisible_in_box(tree, &data->update_box)) {
+		return false;
+	}
+
+	pixman_box32_t bounds = *pixman_region32_extents(scene_tree_get_bounds(tree));
+	bounds.x1 += lx;
+	bounds.y1 += ly;
+	bounds.x2 += lx;
+	bounds.y2 += ly;
+	return pixman_region32_contains_rectangle(data->visible, &bounds) ==
+		PIXMAN_REGION_OUT;
+}
+
+static void scene_node_update_visibility(struct wlr_scene_node *node,
+		int lx, int ly, struct scene_update_data *data) {
+	if (!node->enabled) {
+		return;
+	}
+
+	if (node->type != WLR_SCENE_NODE_TREE) {
+		struct wlr_box node_box = { .x = lx, .y = ly };
+		scene_node_get_size(node, &node_box.width, &node_box.height);
+		if (wlr_box_intersection(&node_box, &node_box, &data->update_box)) {
+			scene_node_update_iterator(node, lx, ly, data);
+		}
+		return;
+	}
+
+	struct wlr_scene_tree *scene_tree = wlr_scene_tree_from_node(node);
+	if (!scene_tree_bounds_intersect(scene_tree, lx, ly, &data->update_box)) {
+		if (pixman_region32_empty(scene_tree_get_bounds(scene_tree))) {
+			scene_tree_clear_visible_extents(scene_tree);
+		}
+		return;
+	}
+
+	if (scene_tree_occluded(scene_tree, lx, ly, data)) {
+		// Nothing to recompute, but X11 windows still need to be restacked
+#if WLR_HAS_XWAYLAND
+		if (data->restack_xwayland_surfaces) {
+			_scene_nodes_in_box(node, &data->update_box, false,
+				scene_node_restack_iterator, data, lx, ly);
+		}
+#endif
+		return;
+	}
+
+	struct wlr_scene_node *child;
+	wl_list_for_each_reverse(child, &scene_tree->children, link) {
+		scene_node_update_visibility(child, lx + child->x, ly + child->y, data);
+	}
+
+	scene_tree_update_visible_extents(scene_tree);
+}
+
 static void scene_node_visibility(struct wlr_scene_node *node,
 		pixman_region32_t *visible) {
 	if (!node->enabled) {
@@ -609,6 +867,11 @@ static void scene_node_visibility(struct wlr_scene_node *node,
 
 	if (node->type == WLR_SCENE_NODE_TREE) {
 		struct wlr_scene_tree *scene_tree = wlr_scene_tree_from_node(node);
+		if (!scene_tree->visible_dirty &&
+				scene_tree->visible_extents.x1 >= scene_tree->visible_extents.x2) {
+			return;
+		}
+
 		struct wlr_scene_node *child;
 		wl_list_for_each(child, &scene_tree->children, link) {
 			scene_node_visibility(child, visible);
@@ -627,10 +890,12 @@ static void scene_node_bounds(struct wlr_scene_node *node,
 
 	if (node->type == WLR_SCENE_NODE_TREE) {
 		struct wlr_scene_tree *scene_tree = wlr_scene_tree_from_node(node);
-		struct wlr_scene_node *child;
-		wl_list_for_each(child, &scene_tree->children, link) {
-			scene_node_bounds(child, x + child->x, y + child->y, visible);
-		}
+		pixman_region32_t bounds;
+		pixman_region32_init(&bounds);
+		pixman_region32_copy(&bounds, scene_tree_get_bounds(scene_tree));
+		pixman_region32_translate(&bounds, x, y);
+		pixman_region32_union(visible, visible, &bounds);
+		pixman_region32_fini(&bounds);
 		return;
 	}
 
@@ -661,7 +926,8 @@ static void scene_update_region(struct wlr_scene *scene,
 	};
 
 	// update node visibility and output enter/leave events
-	scene_nodes_in_box(&scene->tree.node, &data.update_box, scene_node_update_iterator, &data);
+	scene_node_update_visibility(&scene->tree.node,
+		scene->tree.node.x, scene->tree.node.y, &data);
 
 	pixman_region32_fini(&visible);
 }
@@ -697,6 +963,78 @@ static void scene_node_cleanup_when_disabled(struct wlr_scene_node *node,
 #endif
 }
 
+static void scene_transaction_add(struct wlr_scene *scene,
+		struct wlr_scene_node *node, const pixman_region32_t *update_region,
+		const pixman_region32_t *damage) {
+	pixman_region32_union(&scene->transaction_update_region,
+		&scene->transaction_update_region, update_region);
+	if (damage != NULL) {
+		pixman_region32_union(&scene->transaction_damage,
+			&scene->transaction_damage, damage);
+	}
+
+	if (node == NULL) {
+		return;
+	}
+
+	struct wlr_scene_node **entry;
+	wl_array_for_each(entry, &scene->transaction_nodes) {
+		if (*entry == node) {
+			return;
+		}
+	}
+
+	entry = wl_array_add(&scene->transaction_nodes, sizeof(*entry));
+	if (entry == NULL) {
+		// Fall back to damaging everything the node may cover
+		wlr_log(WLR_ERROR, "Allocation failed");
+		pixman_region32_union(&scene->transaction_damage,
+			&scene->transaction_damage, update_region);
+		return;
+	}
+	*entry = node;
+}
+
+static void scene_transaction_forget_node(struct wlr_scene *scene,
+		struct wlr_scene_node *node) {
+	struct wlr_scene_node **entry;
+	wl_array_for_each(entry, &scene->transaction_nodes) {
+		if (*entry == node) {
+			*entry = NULL;
+		}
+	}
+}
+
+void wlr_scene_transaction_begin(struct wlr_scene *scene) {
+	scene->transaction_depth++;
+}
+
+void wlr_scene_transaction_commit(struct wlr_scene *scene) {
+	assert(scene->transaction_depth > 0);
+	scene->transaction_depth--;
+	if (scene->transaction_depth > 0) {
+		return;
+	}
+
+	if (!pixman_region32_empty(&scene->transaction_update_region)) {
+		scene_update_region(scene, &scene->transaction_update_region);
+	}
+
+	struct wlr_scene_node **entry;
+	wl_array_for_each(entry, &scene->transaction_nodes) {
+		int x, y;
+		if (*entry != NULL && wlr_scene_node_coords(*entry, &x, &y)) {
+			scene_node_visibility(*entry, &scene->transaction_damage);
+		}
+	}
+
+	scene_damage_outputs(scene, &scene->transaction_damage);
+
+	pixman_region32_clear(&scene->transaction_update_region);
+	pixman_region32_clear(&scene->transaction_damage);
+	scene->transaction_nodes.size = 0;
+}
+
 /**
  * Updates the nodes visibility, xwayland restacking, send leave/enter events
  * and damages the screen. The damage region is used to not only damage the
@@ -714,6 +1052,9 @@ static void scene_node_cleanup_when_disabled(struct wlr_scene_node *node,
 static void scene_node_update(struct wlr_scene_node *node,
 		pixman_region32_t *damage) {
 	struct wlr_scene *scene = scene_node_get_root(node);
+	scene_node_invalidate_cache(node);
+
+	TRACE_INSTANT(TRACE_SCENE_NODE_UPDATE, node->type);
 
 	int x, y;
 	if (!wlr_scene_node_coords(node, &x, &y)) {
@@ -722,8 +1063,12 @@ static void scene_node_update(struct wlr_scene_node *node,
 		if (damage) {
 			scene_node_cleanup_when_disabled(node, scene->restack_xwayland_surfaces, &scene->outputs);
 
-			scene_update_region(scene, damage);
-			scene_damage_outputs(scene, damage);
+			if (scene->transaction_depth > 0) {
+				scene_transaction_add(scene, NULL, damage, damage);
+			} else {
+				scene_update_region(scene, damage);
+				scene_damage_outputs(scene, damage);
+			}
 			pixman_region32_fini(damage);
 		}
 
@@ -742,6 +1087,15 @@ static void scene_node_update(struct wlr_scene_node *node,
 	pixman_region32_copy(&update_region, damage);
 	scene_node_bounds(node, x, y, &update_region);
 
+	if (scene->transaction_depth > 0) {
+		// The node's new visibility is only known once the transaction is
+		// committed, remember the node to damage it then
+		scene_transaction_add(scene, node, &update_region, damage);
+		pixman_region32_fini(&update_region);
+		pixman_region32_fini(damage);
+		return;
+	}
+
 	scene_update_region(scene, &update_region);
 	pixman_region32_fini(&update_region);
 
@@ -885,6 +1239,31 @@ struct wlr_scene_buffer *wlr_scene_buffer_create(struct wlr_scene_tree *parent,
 	return scene_buffer;
 }
 
+/**
+ * Distance, in output pixels, by which buffer damage bleeds into adjacent
+ * pixels when the buffer is rendered with the given output-to-buffer scale.
+ */
+static int scene_buffer_filter_distance(float output_scale_x,
+		float output_scale_y) {
+	// One output pixel will match (buffer_scale_x)x(buffer_scale_y) buffer pixels.
+	// If the buffer is upscaled on the given axis (output_scale_* > 1.0,
+	// buffer_scale_* < 1.0), its contents will bleed into adjacent
+	// (ceil(output_scale_* / 2)) output pixels because of linear filtering.
+	// Additionally, if the buffer is downscaled (output_scale_* < 1.0,
+	// buffer_scale_* > 1.0), and one output pixel matches a non-integer number of
+	// buffer pixels, its contents will bleed into neighboring output pixels.
+	// Handle both cases by computing buffer_scale_{x,y} and checking if they are
+	// integer numbers; ceilf() is used to ensure that the distance is at least 1.
+	float buffer_scale_x = 1.0f / output_scale_x;
+	float buffer_scale_y = 1.0f / output_scale_y;
+	int dist_x = floor(buffer_scale_x) != buffer_scale_x ?
+		(int)ceilf(output_scale_x / 2.0f) : 0;
+	int dist_y = floor(buffer_scale_y) != buffer_scale_y ?
+		(int)ceilf(output_scale_y / 2.0f) : 0;
+	// TODO: expand with per-axis distances
+	return dist_x >= dist_y ? dist_x : dist_y;
+}
+
 void wlr_scene_buffer_set_buffer_with_options(struct wlr_scene_buffer *scene_buffer,
 		struct wlr_buffer *buffer, const struct wlr_scene_buffer_set_buffer_options *options) {
 	const struct wlr_scene_buffer_set_buffer_options default_options = {0};
@@ -990,6 +1369,33 @@ void wlr_scene_buffer_set_buffer_with_options(struct wlr_scene_buffer *scene_buf
 
 	struct wlr_scene *scene = scene_node_get_root(&scene_buffer->node);
 	struct wlr_scene_output *scene_output;
+	if (scene->transaction_depth > 0) {
+		// Visibility is only final once the transaction is committed: damage
+		// the whole area the new content covers, in layout coordinates, and
+		// let the commit apply it
+		pixman_region32_t layout_damage;
+		pixman_region32_init(&layout_damage);
+		wlr_region_scale_xy(&layout_damage, &trans_damage, scale_x, scale_y);
+		int dist = 0;
+		wl_list_for_each(scene_output, &scene->outputs, link) {
+			float output_scale = scene_output->output->scale;
+			int output_dist = (int)ceilf(scene_buffer_filter_distance(
+				output_scale * scale_x, output_scale * scale_y) / output_scale);
+			if (output_dist > dist) {
+				dist = output_dist;
+			}
+		}
+		wlr_region_expand(&layout_damage, &layout_damage, dist);
+		pixman_region32_translate(&layout_damage, lx, ly);
+		pixman_region32_union(&scene->transaction_damage,
+			&scene->transaction_damage, &layout_damage);
+		pixman_region32_fini(&layout_damage);
+
+		pixman_region32_fini(&trans_damage);
+		pixman_region32_fini(&fallback_damage);
+		return;
+	}
+
 	wl_list_for_each(scene_output, &scene->outputs, link) {
 		float output_scale = scene_output->output->scale;
 		float output_scale_x = output_scale * scale_x;
@@ -998,25 +1404,8 @@ void wlr_scene_buffer_set_buffer_with_options(struct wlr_scene_buffer *scene_buf
 		pixman_region32_init(&output_damage);
 		wlr_region_scale_xy(&output_damage, &trans_damage,
 			output_scale_x, output_scale_y);
-
-		// One output pixel will match (buffer_scale_x)x(buffer_scale_y) buffer pixels.
-		// If the buffer is upscaled on the given axis (output_scale_* > 1.0,
-		// buffer_scale_* < 1.0), its contents will bleed into adjacent
-		// (ceil(output_scale_* / 2)) output pixels because of linear filtering.
-		// Additionally, if the buffer is downscaled (output_scale_* < 1.0,
-		// buffer_scale_* > 1.0), and one output pixel matches a non-integer number of
-		// buffer pixels, its contents will bleed into neighboring output pixels.
-		// Handle both cases by computing buffer_scale_{x,y} and checking if they are
-		// integer numbers; ceilf() is used to ensure that the distance is at least 1.
-		float buffer_scale_x = 1.0f / output_scale_x;
-		float buffer_scale_y = 1.0f / output_scale_y;
-		int dist_x = floor(buffer_scale_x) != buffer_scale_x ?
-			(int)ceilf(output_scale_x / 2.0f) : 0;
-		int dist_y = floor(buffer_scale_y) != buffer_scale_y ?
-			(int)ceilf(output_scale_y / 2.0f) : 0;
-		// TODO: expand with per-axis distances
 		wlr_region_expand(&output_damage, &output_damage,
-			dist_x >= dist_y ? dist_x : dist_y);
+			scene_buffer_filter_distance(output_scale_x, output_scale_y));
 
 		pixman_region32_t cull_region;
 		pixman_region32_init(&cull_region);
@@ -1067,7 +1456,12 @@ void wlr_scene_buffer_set_opaque_region(struct wlr_scene_buffer *scene_buffer,
 	pixman_region32_t update_region;
 	pixman_region32_init(&update_region);
 	scene_node_bounds(&scene_buffer->node, x, y, &update_region);
-	scene_update_region(scene_node_get_root(&scene_buffer->node), &update_region);
+	struct wlr_scene *scene = scene_node_get_root(&scene_buffer->node);
+	if (scene->transaction_depth > 0) {
+		scene_transaction_add(scene, NULL, &update_region, NULL);
+	} else {
+		scene_update_region(scene, &update_region);
+	}
 	pixman_region32_fini(&update_region);
 }
 
@@ -1319,6 +1713,7 @@ void wlr_scene_node_reparent(struct wlr_scene_node *node,
 		scene_node_visibility(node, &visible);
 	}
 
+	scene_node_invalidate_cache(node);
 	wl_list_remove(&node->link);
 	node->parent = new_parent;
 	wl_list_insert(new_parent->children.prev, &node->link);
@@ -1706,6 +2101,13 @@ static void scene_output_handle_commit(struct wl_listener *listener, void *data)
 		}
 	}
 
+	// The output's primary formats may change along with these
+	if (state->committed & (WLR_OUTPUT_STATE_MODE |
+			WLR_OUTPUT_STATE_ENABLED |
+			WLR_OUTPUT_STATE_RENDER_FORMAT)) {
+		scene_output_invalidate_dmabuf_feedback(scene_output);
+	}
+
 	bool force_update = state->committed & (
 		WLR_OUTPUT_STATE_TRANSFORM |
 		WLR_OUTPUT_STATE_SCALE |
@@ -1767,6 +2169,7 @@ struct wlr_scene_output *wlr_scene_output_create(struct wlr_scene *scene,
 	wlr_damage_ring_init(&scene_output->damage_ring);
 	pixman_region32_init(&scene_output->pending_commit_damage);
 	wl_list_init(&scene_output->damage_highlight_regions);
+	wl_array_init(&scene_output->frame_done_buffers);
 
 	int prev_output_index = -1;
 	struct wl_list *prev_output_link = &scene->outputs;
@@ -1833,6 +2236,14 @@ void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
 		highlight_region_destroy(damage);
 	}
 
+	uint64_t mask = 1ull << scene_output->index;
+	struct wlr_scene_buffer **buffer;
+	wl_array_for_each(buffer, &scene_output->frame_done_buffers) {
+		if (*buffer != NULL) {
+			(*buffer)->frame_done_outputs &= ~mask;
+		}
+	}
+
 	wlr_addon_finish(&scene_output->addon);
 	wlr_damage_ring_finish(&scene_output->damage_ring);
 	pixman_region32_fini(&scene_output->pending_commit_damage);
@@ -1846,6 +2257,9 @@ void wlr_scene_output_destroy(struct wlr_scene_output *scene_output) {
 	wlr_color_transform_unref(scene_output->prev_supplied_color_transform);
 	wlr_color_transform_unref(scene_output->combined_color_transform);
 	wl_array_release(&scene_output->render_list);
+	wl_array_release(&scene_output->frame_done_buffers);
+	scene_output_invalidate_dmabuf_feedback(scene_output);
+	scene_output_layers_destroy(scene_output);
 	free(scene_output);
 }
 
@@ -1965,9 +2379,53 @@ static bool construct_render_list_iterator(struct wlr_scene_node *node,
 	return false;
 }
 
-static void scene_buffer_send_dmabuf_feedback(const struct wlr_scene *scene,
+static void scene_output_invalidate_dmabuf_feedback(
+		struct wlr_scene_output *scene_output) {
+	for (size_t i = 0; i < 2; i++) {
+		if (scene_output->dmabuf_feedback_cache[i].valid) {
+			wlr_linux_dmabuf_feedback_v1_finish(
+				&scene_output->dmabuf_feedback_cache[i].feedback);
+		}
+		scene_output->dmabuf_feedback_cache[i].valid = false;
+	}
+}
+
+/**
+ * Build the feedback for the given options once per output, instead of once
+ * per buffer.
+ */
+static const struct wlr_linux_dmabuf_feedback_v1 *scene_output_get_dmabuf_feedback(
+		struct wlr_scene_output *scene_output,
+		const struct wlr_linux_dmabuf_feedback_v1_init_options *options) {
+	assert(options->output_layer_feedback_event == NULL);
+	assert(options->scanout_primary_output == NULL ||
+		options->scanout_primary_output == scene_output->output);
+
+	size_t i = options->scanout_primary_output != NULL ? 1 : 0;
+	struct wlr_linux_dmabuf_feedback_v1 *feedback =
+		&scene_output->dmabuf_feedback_cache[i].feedback;
+	if (scene_output->dmabuf_feedback_cache[i].valid) {
+		if (scene_output->dmabuf_feedback_cache[i].renderer == options->main_renderer) {
+			return feedback;
+		}
+		wlr_linux_dmabuf_feedback_v1_finish(feedback);
+		scene_output->dmabuf_feedback_cache[i].valid = false;
+	}
+
+	*feedback = (struct wlr_linux_dmabuf_feedback_v1){0};
+	if (!wlr_linux_dmabuf_feedback_v1_init_with_options(feedback, options)) {
+		return NULL;
+	}
+
+	scene_output->dmabuf_feedback_cache[i].valid = true;
+	scene_output->dmabuf_feedback_cache[i].renderer = options->main_renderer;
+	return feedback;
+}
+
+static void scene_buffer_send_dmabuf_feedback(struct wlr_scene_output *scene_output,
 		struct wlr_scene_buffer *scene_buffer,
 		const struct wlr_linux_dmabuf_feedback_v1_init_options *options) {
+	const struct wlr_scene *scene = scene_output->scene;
 	if (!scene->linux_dmabuf_v1) {
 		return;
 	}
@@ -1983,13 +2441,14 @@ static void scene_buffer_send_dmabuf_feedback(const struct wlr_scene *scene,
 		return;
 	}
 
-	scene_buffer->prev_feedback_options = *options;
-
-	struct wlr_linux_dmabuf_feedback_v1 feedback = {0};
-	if (!wlr_linux_dmabuf_feedback_v1_init_with_options(&feedback, options)) {
+	const struct wlr_linux_dmabuf_feedback_v1 *feedback =
+		scene_output_get_dmabuf_feedback(scene_output, options);
+	if (feedback == NULL) {
 		return;
 	}
 
+	scene_buffer->prev_feedback_options = *options;
+
 	enum wl_output_transform preferred_buffer_transform = WL_OUTPUT_TRANSFORM_NORMAL;
 	if (options->scanout_primary_output != NULL) {
 		preferred_buffer_transform = options->scanout_primary_output->transform;
@@ -1999,9 +2458,7 @@ static void scene_buffer_send_dmabuf_feedback(const struct wlr_scene *scene,
 	// pure software rendering
 	wlr_surface_set_preferred_buffer_transform(surface->surface, preferred_buffer_transform);
 	wlr_linux_dmabuf_v1_set_surface_feedback(scene->linux_dmabuf_v1,
-		surface->surface, &feedback);
-
-	wlr_linux_dmabuf_feedback_v1_finish(&feedback);
+		surface->surface, feedback);
 }
 
 static bool color_management_is_scanout_allowed(const struct wlr_output_image_description *img_desc,
@@ -2025,6 +2482,38 @@ static bool color_management_is_scanout_allowed(const struct wlr_output_image_de
 			buffer->primaries == WLR_COLOR_NAMED_PRIMARIES_SRGB;
 }
 
+// Checks shared by direct scan-out and output layers: the backend displays
+// the buffer as-is, without any transform or color conversion
+static bool scene_buffer_is_scanout_compatible(const struct wlr_scene_buffer *buffer,
+		const struct wlr_output_state *state, const struct render_data *data) {
+	if (buffer->transform != data->transform) {
+		return false;
+	}
+
+	const struct wlr_output_image_description *img_desc =
+		output_pending_image_description(data->output->output, state);
+	if (!color_management_is_scanout_allowed(img_desc, buffer)) {
+		return false;
+	}
+
+	bool is_color_repr_none = buffer->color_encoding == WLR_COLOR_ENCODING_NONE &&
+			buffer->color_range == WLR_COLOR_RANGE_NONE;
+	bool is_color_repr_identity_full = buffer->color_encoding == WLR_COLOR_ENCODING_IDENTITY &&
+			buffer->color_range == WLR_COLOR_RANGE_FULL;
+
+	return is_color_repr_none || is_color_repr_identity_full;
+}
+
+static struct wlr_buffer *scene_buffer_get_scanout_buffer(
+		struct wlr_scene_buffer *buffer) {
+	struct wlr_buffer *wlr_buffer = buffer->buffer;
+	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(wlr_buffer);
+	if (client_buffer != NULL && client_buffer->source != NULL && client_buffer->source->n_locks > 0) {
+		wlr_buffer = client_buffer->source;
+	}
+	return wlr_buffer;
+}
+
 enum scene_direct_scanout_result {
 	// This scene node is not a candidate for scanout
 	SCANOUT_INELIGIBLE,
@@ -2077,21 +2566,7 @@ static enum scene_direct_scanout_result scene_entry_try_direct_scanout(
 		.height = default_height,
 	};
 
-	if (buffer->transform != data->transform) {
-		return SCANOUT_INELIGIBLE;
-	}
-
-	const struct wlr_output_image_description *img_desc = output_pending_image_description(scene_output->output, state);
-	if (!color_management_is_scanout_allowed(img_desc, buffer)) {
-		return SCANOUT_INELIGIBLE;
-	}
-
-	bool is_color_repr_none = buffer->color_encoding == WLR_COLOR_ENCODING_NONE &&
-			buffer->color_range == WLR_COLOR_RANGE_NONE;
-	bool is_color_repr_identity_full = buffer->color_encoding == WLR_COLOR_ENCODING_IDENTITY &&
-			buffer->color_range == WLR_COLOR_RANGE_FULL;
-
-	if (!(is_color_repr_none || is_color_repr_identity_full)) {
+	if (!scene_buffer_is_scanout_compatible(buffer, state, data)) {
 		return SCANOUT_INELIGIBLE;
 	}
 
@@ -2105,7 +2580,7 @@ static enum scene_direct_scanout_result scene_entry_try_direct_scanout(
 			.scanout_primary_output = scene_output->output,
 		};
 
-		scene_buffer_send_dmabuf_feedback(scene_output->scene, buffer, &options);
+		scene_buffer_send_dmabuf_feedback(scene_output, buffer, &options);
 	}
 
 	struct wlr_output_state pending;
@@ -2126,13 +2601,7 @@ static enum scene_direct_scanout_result scene_entry_try_direct_scanout(
 	scene_node_get_size(node, &pending.buffer_dst_box.width, &pending.buffer_dst_box.height);
 	transform_output_box(&pending.buffer_dst_box, data);
 
-	struct wlr_buffer *wlr_buffer = buffer->buffer;
-	struct wlr_client_buffer *client_buffer = wlr_client_buffer_get(wlr_buffer);
-	if (client_buffer != NULL && client_buffer->source != NULL && client_buffer->source->n_locks > 0) {
-		wlr_buffer = client_buffer->source;
-	}
-
-	wlr_output_state_set_buffer(&pending, wlr_buffer);
+	wlr_output_state_set_buffer(&pending, scene_buffer_get_scanout_buffer(buffer));
 	if (buffer->wait_timeline != NULL) {
 		wlr_output_state_set_wait_timeline(&pending, buffer->wait_timeline, buffer->wait_point);
 	}
@@ -2152,6 +2621,229 @@ static enum scene_direct_scanout_result scene_entry_try_direct_scanout(
 	return SCANOUT_SUCCESS;
 }
 
+struct wlr_scene_output_layers {
+	struct wlr_output_layer_state states[SCENE_OUTPUT_LAYERS_LEN]; // bottom to top
+
+	// Nodes assigned to each layer in the state being built, and in the last
+	// built state. Only compared, never dereferenced.
+	const struct wlr_scene_node *nodes[SCENE_OUTPUT_LAYERS_LEN];
+	const struct wlr_scene_node *prev_nodes[SCENE_OUTPUT_LAYERS_LEN];
+	struct wlr_box prev_boxes[SCENE_OUTPUT_LAYERS_LEN]; // output-buffer-local
+
+	bool active; // some layer displays a buffer
+	int retry_frames; // frames to wait before trying again after a rejection
+};
+
+static void scene_output_layers_destroy(struct wlr_scene_output *scene_output) {
+	struct wlr_scene_output_layers *layers = scene_output->layers;
+	if (layers == NULL) {
+		return;
+	}
+
+	for (size_t i = 0; i < SCENE_OUTPUT_LAYERS_LEN; i++) {
+		wlr_output_layer_destroy(layers->states[i].layer);
+	}
+	free(layers);
+	scene_output->layers = NULL;
+}
+
+static struct wlr_scene_output_layers *scene_output_get_layers(
+		struct wlr_scene_output *scene_output) {
+	if (scene_output->layers != NULL) {
+		return scene_output->layers;
+	}
+
+	struct wlr_scene_output_layers *layers = calloc(1, sizeof(*layers));
+	if (layers == NULL) {
+		return NULL;
+	}
+	scene_output->layers = layers;
+
+	for (size_t i = 0; i < SCENE_OUTPUT_LAYERS_LEN; i++) {
+		layers->states[i].layer = wlr_output_layer_create(scene_output->output);
+		if (layers->states[i].layer == NULL) {
+			wlr_log(WLR_ERROR, "Failed to create output layer");
+			scene_output_layers_destroy(scene_output);
+			return NULL;
+		}
+	}
+
+	return layers;
+}
+
+static void scene_output_layers_clear(struct wlr_scene_output_layers *layers,
+		size_t start, size_t end) {
+	for (size_t i = start; i < end; i++) {
+		struct wlr_output_layer_state *layer_state = &layers->states[i];
+		*layer_state = (struct wlr_output_layer_state){
+			.layer = layer_state->layer,
+		};
+		layers->nodes[i] = NULL;
+	}
+}
+
+/**
+ * Disable the layers which display a buffer since the last frame. They are
+ * re-assigned if the topmost entries can still be offloaded.
+ */
+static void scene_output_layers_reset(struct wlr_scene_output *scene_output,
+		struct wlr_output_state *state) {
+	struct wlr_scene_output_layers *layers = scene_output->layers;
+	if (layers == NULL || !layers->active) {
+		return;
+	}
+
+	scene_output_layers_clear(layers, 0, SCENE_OUTPUT_LAYERS_LEN);
+	wlr_output_state_set_layers(state, layers->states, SCENE_OUTPUT_LAYERS_LEN);
+}
+
+static bool scene_entry_can_offload(struct render_list_entry *entry,
+		const struct wlr_output_state *state, const struct render_data *data) {
+	if (entry->node->type != WLR_SCENE_NODE_BUFFER ||
+			entry->highlight_transparent_region) {
+		return false;
+	}
+
+	struct wlr_scene_buffer *buffer = wlr_scene_buffer_from_node(entry->node);
+	if (buffer->buffer == NULL) {
+		return false;
+	}
+
+	// Output layers have neither an alpha multiplier nor acquire fences
+	if (buffer->opacity != 1 || buffer->wait_timeline != NULL) {
+		return false;
+	}
+
+	return scene_buffer_is_scanout_compatible(buffer, state, data);
+}
+
+/**
+ * Try to display the topmost render list entries on output layers. Layers are
+ * stacked above the composited buffer, so only a contiguous run of entries
+ * starting from the top can be offloaded.
+ *
+ * Returns the number of offloaded entries, starting from the top of the
+ * render list.
+ */
+static int scene_output_offload_layers(struct wlr_scene_output *scene_output,
+		struct render_list_entry *list_data, int list_len,
+		struct wlr_output_state *state, const struct render_data *data) {
+	struct wlr_scene_output_layers *layers = scene_output->layers;
+	if (layers != NULL && layers->retry_frames > 0) {
+		layers->retry_frames--;
+		return 0;
+	}
+
+	int candidates = 0;
+	while (candidates < list_len && candidates < SCENE_OUTPUT_LAYERS_LEN &&
+			scene_entry_can_offload(&list_data[candidates], state, data)) {
+		candidates++;
+	}
+	if (candidates == 0) {
+		return 0;
+	}
+
+	layers = scene_output_get_layers(scene_output);
+	if (layers == NULL) {
+		return 0;
+	}
+
+	scene_output_layers_clear(layers, 0, SCENE_OUTPUT_LAYERS_LEN);
+	for (int i = 0; i < candidates; i++) {
+		struct render_list_entry *entry = &list_data[i];
+		struct wlr_scene_buffer *buffer = wlr_scene_buffer_from_node(entry->node);
+
+		// The topmost entry goes on the topmost layer
+		size_t index = SCENE_OUTPUT_LAYERS_LEN - 1 - i;
+		struct wlr_output_layer_state *layer_state = &layers->states[index];
+		layer_state->buffer = scene_buffer_get_scanout_buffer(buffer);
+		layer_state->src_box = buffer->src_box;
+		layer_state->dst_box = (struct wlr_box){
+			.x = entry->x - scene_output->x,
+			.y = entry->y - scene_output->y,
+		};
+		scene_node_get_size(entry->node,
+			&layer_state->dst_box.width, &layer_state->dst_box.height);
+		transform_output_box(&layer_state->dst_box, data);
+		layers->nodes[index] = entry->node;
+	}
+	wlr_output_state_set_layers(state, layers->states, SCENE_OUTPUT_LAYERS_LEN);
+
+	int offloaded = 0;
+	if (wlr_output_test_state(scene_output->output, state)) {
+		// Everything below a rejected entry needs to be composited
+		while (offloaded < candidates &&
+				layers->states[SCENE_OUTPUT_LAYERS_LEN - 1 - offloaded].accepted) {
+			offloaded++;
+		}
+	}
+	scene_output_layers_clear(layers, 0, SCENE_OUTPUT_LAYERS_LEN - offloaded);
+
+	if (offloaded == 0) {
+		layers->retry_frames = SCENE_OUTPUT_LAYERS_RETRY_FRAMES;
+		if (!layers->active) {
+			// Leave the layers alone, the backend may not support them at all
+			state->committed &= ~WLR_OUTPUT_STATE_LAYERS;
+		}
+		return 0;
+	}
+
+	for (int i = 0; i < offloaded; i++) {
+		struct wlr_scene_buffer *buffer = wlr_scene_buffer_from_node(list_data[i].node);
+		struct wlr_scene_output_sample_event sample_event = {
+			.output = scene_output,
+			.direct_scanout = true,
+		};
+		wl_signal_emit_mutable(&buffer->events.output_sample, &sample_event);
+	}
+
+	return offloaded;
+}
+
+/**
+ * Damage the composited buffer where entries moved between a layer and
+ * composition, then remember the layer assignment for the next frame.
+ */
+static void scene_output_layers_apply(struct wlr_scene_output *scene_output,
+		struct wlr_output_state *state) {
+	struct wlr_scene_output_layers *layers = scene_output->layers;
+	if (layers == NULL || !(state->committed & WLR_OUTPUT_STATE_LAYERS)) {
+		return;
+	}
+
+	bool active = false;
+	bool damaged = false;
+	for (size_t i = 0; i < SCENE_OUTPUT_LAYERS_LEN; i++) {
+		const struct wlr_scene_node *node = layers->nodes[i];
+		const struct wlr_box *dst_box = &layers->states[i].dst_box;
+		if (node != layers->prev_nodes[i]) {
+			pixman_region32_t damage;
+			pixman_region32_init(&damage);
+			if (layers->prev_nodes[i] != NULL) {
+				const struct wlr_box *prev_box = &layers->prev_boxes[i];
+				pixman_region32_union_rect(&damage, &damage, prev_box->x,
+					prev_box->y, prev_box->width, prev_box->height);
+			}
+			if (node != NULL) {
+				pixman_region32_union_rect(&damage, &damage, dst_box->x,
+					dst_box->y, dst_box->width, dst_box->height);
+			}
+			scene_output_damage(scene_output, &damage);
+			pixman_region32_fini(&damage);
+			damaged = true;
+		}
+
+		layers->prev_nodes[i] = node;
+		layers->prev_boxes[i] = node != NULL ? *dst_box : (struct wlr_box){0};
+		active = active || node != NULL;
+	}
+	layers->active = active;
+
+	if (damaged) {
+		wlr_output_state_set_damage(state, &scene_output->pending_commit_damage);
+	}
+}
+
 bool wlr_scene_output_needs_frame(struct wlr_scene_output *scene_output) {
 	return scene_output->output->needs_frame ||
 		!pixman_region32_empty(&scene_output->pending_commit_damage) ||
@@ -2358,13 +3050,15 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 		.fractional_scale = floor(render_data.scale) != render_data.scale,
 	};
 
+	TRACE_BEGIN(TRACE_SCENE_RENDER_LIST, scene_output->index);
 	list_con.render_list->size = 0;
-	scene_nodes_in_box(&scene_output->scene->tree.node, &list_con.box,
+	scene_visible_nodes_in_box(&scene_output->scene->tree.node, &list_con.box,
 		construct_render_list_iterator, &list_con);
 	array_realloc(list_con.render_list, list_con.render_list->size);
 
 	struct render_list_entry *list_data = list_con.render_list->data;
 	int list_len = list_con.render_list->size / sizeof(*list_data);
+	TRACE_END(TRACE_SCENE_RENDER_LIST, list_len);
 
 	if (debug_damage == WLR_SCENE_DEBUG_DAMAGE_RERENDER) {
 		scene_output_damage_whole(scene_output);
@@ -2410,6 +3104,8 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 	wlr_output_state_set_damage(state, &scene_output->pending_commit_damage);
 
+	scene_output_layers_reset(scene_output, state);
+
 	// We only want to try direct scanout if:
 	// - There is only one entry in the render list
 	// - There are no color transforms that need to be applied
@@ -2439,6 +3135,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	}
 
 	if (scanout) {
+		scene_output_layers_apply(scene_output, state);
 		scene_output_state_attempt_gamma(scene_output, state);
 
 		if (timer) {
@@ -2466,6 +3163,22 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 
 	assert(buffer->width == resolution_width && buffer->height == resolution_height);
 
+	// Otherwise, try to offload the topmost entries to output layers, with
+	// the same restrictions as direct scan-out. The layers are tested along
+	// with the primary buffer they will be committed with.
+	int offloaded = 0;
+	if (options->offload_layers && scene_output->scene->direct_scanout &&
+			options->color_transform == NULL && !render_gamma_lut &&
+			debug_damage != WLR_SCENE_DEBUG_DAMAGE_HIGHLIGHT &&
+			!(state->committed & (WLR_OUTPUT_STATE_MODE |
+				WLR_OUTPUT_STATE_ENABLED | WLR_OUTPUT_STATE_RENDER_FORMAT)) &&
+			wlr_output_is_direct_scanout_allowed(output)) {
+		wlr_output_state_set_buffer(state, buffer);
+		offloaded = scene_output_offload_layers(scene_output,
+			list_data, list_len, state, &render_data);
+	}
+	scene_output_layers_apply(scene_output, state);
+
 	if (timer) {
 		timer->render_timer = wlr_render_timer_create(output->renderer);
 
@@ -2515,7 +3228,10 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	// scene nodes above. Those scene nodes will just render atop having us
 	// never see the background.
 	if (scene_output->scene->calculate_visibility) {
-		for (int i = list_len - 1; i >= 0; i--) {
+		pixman_region32_t opaque;
+		pixman_region32_init(&opaque);
+		for (int i = list_len - 1; i >= 0 &&
+				!pixman_region32_empty(&background); i--) {
 			struct render_list_entry *entry = &list_data[i];
 
 			// We must only cull opaque regions that are visible by the node.
@@ -2523,16 +3239,18 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 			// that may have been omitted from the render list via the black
 			// rect optimization. In order to ensure we don't cull background
 			// rendering in that black rect region, consider the node's visibility.
-			pixman_region32_t opaque;
-			pixman_region32_init(&opaque);
+			pixman_region32_clear(&opaque);
 			scene_node_opaque_region(entry->node, entry->x, entry->y, &opaque);
 			pixman_region32_intersect(&opaque, &opaque, &entry->node->visible);
+			if (pixman_region32_empty(&opaque)) {
+				continue;
+			}
 
 			pixman_region32_translate(&opaque, -scene_output->x, -scene_output->y);
 			logical_to_buffer_coords(&opaque, &render_data, false);
 			pixman_region32_subtract(&background, &background, &opaque);
-			pixman_region32_fini(&opaque);
 		}
+		pixman_region32_fini(&opaque);
 
 		if (floor(render_data.scale) != render_data.scale) {
 			wlr_region_expand(&background, &background, 1);
@@ -2550,7 +3268,8 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 	});
 	pixman_region32_fini(&background);
 
-	for (int i = list_len - 1; i >= 0; i--) {
+	// The topmost entries may have been offloaded to output layers
+	for (int i = list_len - 1; i >= offloaded; i--) {
 		struct render_list_entry *entry = &list_data[i];
 		scene_entry_render(entry, &render_data);
 
@@ -2567,7 +3286,7 @@ bool wlr_scene_output_build_state(struct wlr_scene_output *scene_output,
 					.scanout_primary_output = NULL,
 				};
 
-				scene_buffer_send_dmabuf_feedback(scene_output->scene, buffer, &options);
+				scene_buffer_send_dmabuf_feedback(scene_output, buffer, &options);
 			}
 		}
 	}
@@ -2630,6 +3349,77 @@ void wlr_scene_timer_finish(struct wlr_scene_timer *timer) {
 	}
 }
 
+void wlr_scene_buffer_request_frame_done(struct wlr_scene_buffer *scene_buffer,
+		struct wlr_scene_output *scene_output) {
+	uint64_t mask = 1ull << scene_output->index;
+	if (!scene_output->scene->frame_done_on_request ||
+			(scene_buffer->frame_done_outputs & mask)) {
+		return;
+	}
+
+	struct wlr_scene_buffer **entry = wl_array_add(
+		&scene_output->frame_done_buffers, sizeof(*entry));
+	if (entry == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return;
+	}
+
+	*entry = scene_buffer;
+	scene_buffer->frame_done_outputs |= mask;
+}
+
+static void scene_output_compact_frame_done_buffers(
+		struct wlr_scene_output *scene_output) {
+	struct wl_array *array = &scene_output->frame_done_buffers;
+	struct wlr_scene_buffer **buffers = array->data;
+	size_t len = array->size / sizeof(*buffers);
+
+	size_t n = 0;
+	for (size_t i = 0; i < len; i++) {
+		if (buffers[i] != NULL) {
+			buffers[n++] = buffers[i];
+		}
+	}
+	array->size = n * sizeof(*buffers);
+}
+
+static void scene_buffer_cancel_frame_done(struct wlr_scene_buffer *scene_buffer,
+		struct wlr_scene *scene) {
+	if (scene_buffer->frame_done_outputs == 0) {
+		return;
+	}
+
+	// Entries are only cleared here: the output may be iterating over its
+	// array, so compacting is left to wlr_scene_output_send_frame_done()
+	struct wlr_scene_output *scene_output;
+	wl_list_for_each(scene_output, &scene->outputs, link) {
+		if (!(scene_buffer->frame_done_outputs & (1ull << scene_output->index))) {
+			continue;
+		}
+
+		struct wlr_scene_buffer **buffer;
+		wl_array_for_each(buffer, &scene_output->frame_done_buffers) {
+			if (*buffer == scene_buffer) {
+				*buffer = NULL;
+			}
+		}
+	}
+
+	scene_buffer->frame_done_outputs = 0;
+}
+
+static void scene_output_clear_frame_done_buffers(
+		struct wlr_scene_output *scene_output) {
+	uint64_t mask = 1ull << scene_output->index;
+	struct wlr_scene_buffer **buffer;
+	wl_array_for_each(buffer, &scene_output->frame_done_buffers) {
+		if (*buffer != NULL) {
+			(*buffer)->frame_done_outputs &= ~mask;
+		}
+	}
+	scene_output->frame_done_buffers.size = 0;
+}
+
 static void scene_node_send_frame_done(struct wlr_scene_node *node,
 		struct wlr_scene_output *scene_output, struct timespec *now) {
 	if (!node->enabled) {
@@ -2655,8 +3445,41 @@ static void scene_node_send_frame_done(struct wlr_scene_node *node,
 
 void wlr_scene_output_send_frame_done(struct wlr_scene_output *scene_output,
 		struct timespec *now) {
-	scene_node_send_frame_done(&scene_output->scene->tree.node,
-		scene_output, now);
+	if (!scene_output->scene->frame_done_on_request) {
+		// Drop requests left over from when the option was enabled
+		scene_output_clear_frame_done_buffers(scene_output);
+		scene_node_send_frame_done(&scene_output->scene->tree.node,
+			scene_output, now);
+		return;
+	}
+
+	struct wlr_scene_frame_done_event event = {
+		.output = scene_output,
+		.when = *now,
+	};
+	uint64_t mask = 1ull << scene_output->index;
+
+	// Listeners may request new frame done events or destroy buffers: only
+	// visit the entries present before emitting, and re-fetch the array data
+	// since it may be reallocated.
+	size_t len = scene_output->frame_done_buffers.size /
+		sizeof(struct wlr_scene_buffer *);
+	for (size_t i = 0; i < len; i++) {
+		struct wlr_scene_buffer **buffers = scene_output->frame_done_buffers.data;
+		struct wlr_scene_buffer *scene_buffer = buffers[i];
+
+		// Buffers which are not visible keep their request until they are
+		if (scene_buffer == NULL ||
+				pixman_region32_empty(&scene_buffer->node.visible)) {
+			continue;
+		}
+
+		buffers[i] = NULL;
+		scene_buffer->frame_done_outputs &= ~mask;
+		wl_signal_emit_mutable(&scene_buffer->events.frame_done, &event);
+	}
+
+	scene_output_compact_frame_done_buffers(scene_output);
 }
 
 static void scene_output_for_each_scene_buffer(const struct wlr_box *output_box,
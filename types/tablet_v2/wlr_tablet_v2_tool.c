@@ -6,6 +6,7 @@
 #include <wlr/types/wlr_tablet_tool.h>
 #include <wlr/types/wlr_tablet_v2.h>
 #include <wlr/util/log.h>
+#include "util/sched.h"
 #include "util/set.h"
 #include "util/time.h"
 #include "tablet-v2-protocol.h"
@@ -99,7 +100,7 @@ void destroy_tablet_tool_v2(struct wl_resource *resource) {
 	}
 
 	if (client->frame_source) {
-		wl_event_source_remove(client->frame_source);
+		sched_task_cancel(client->frame_source);
 	}
 
 	if (client->tool && client->tool->current_client == client) {
@@ -300,7 +301,7 @@ static void queue_tool_frame(struct wlr_tablet_tool_client_v2 *tool) {
 	struct wl_event_loop *loop = wl_display_get_event_loop(display);
 	if (!tool->frame_source) {
 		tool->frame_source =
-			wl_event_loop_add_idle(loop, send_tool_frame, tool);
+			sched_post(loop, SCHED_CLASS_INPUT, 0, send_tool_frame, tool);
 	}
 }
 
@@ -406,7 +407,7 @@ void wlr_send_tablet_v2_tablet_tool_proximity_out(
 			zwp_tablet_tool_v2_send_up(tool->current_client->resource);
 		}
 		if (tool->current_client->frame_source) {
-			wl_event_source_remove(tool->current_client->frame_source);
+			sched_task_cancel(tool->current_client->frame_source);
 			send_tool_frame(tool->current_client);
 		}
 		zwp_tablet_tool_v2_send_proximity_out(tool->current_client->resource);
@@ -0,0 +1,255 @@
+#include <assert.h>
+#include <drm_fourcc.h>
+#include <stdlib.h>
+#include <wlr/render/pixman.h>
+#include <wlr/render/wlr_texture.h>
+#include <wlr/types/wlr_buffer.h>
+#include <wlr/util/log.h>
+#include "render/pixel_format.h"
+#include "types/wlr_buffer.h"
+#include "types/wlr_client_memory.h"
+
+static void tracker_handle_display_destroy(struct wl_listener *listener, void *data);
+static void client_memory_handle_client_destroy(struct wl_listener *listener, void *data);
+
+static struct wlr_client_memory_tracker *tracker_from_display(
+		struct wl_display *display) {
+	struct wl_listener *listener =
+		wl_display_get_destroy_listener(display, tracker_handle_display_destroy);
+	if (listener == NULL) {
+		return NULL;
+	}
+	struct wlr_client_memory_tracker *tracker =
+		wl_container_of(listener, tracker, display_destroy);
+	return tracker;
+}
+
+static struct wlr_client_memory *client_memory_from_client(
+		const struct wl_client *client) {
+	struct wl_listener *listener = wl_client_get_destroy_listener(
+		(struct wl_client *)client, client_memory_handle_client_destroy);
+	if (listener == NULL) {
+		return NULL;
+	}
+	struct wlr_client_memory *memory =
+		wl_container_of(listener, memory, client_destroy);
+	return memory;
+}
+
+static void client_memory_detach(struct wlr_client_memory *memory) {
+	if (memory->client == NULL) {
+		return;
+	}
+	wl_list_remove(&memory->link);
+	wl_list_remove(&memory->client_destroy.link);
+	memory->client = NULL;
+	memory->tracker = NULL;
+	// Drop the reference held by the client
+	client_memory_unref(memory);
+}
+
+static void client_memory_handle_client_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_client_memory *memory =
+		wl_container_of(listener, memory, client_destroy);
+	client_memory_detach(memory);
+}
+
+struct wlr_client_memory *client_memory_get(struct wl_client *client) {
+	struct wlr_client_memory *memory = client_memory_from_client(client);
+	if (memory != NULL) {
+		memory->n_refs++;
+		return memory;
+	}
+
+	struct wlr_client_memory_tracker *tracker =
+		tracker_from_display(wl_client_get_display(client));
+	if (tracker == NULL) {
+		return NULL;
+	}
+
+	memory = calloc(1, sizeof(*memory));
+	if (memory == NULL) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		return NULL;
+	}
+
+	memory->tracker = tracker;
+	memory->client = client;
+	// One reference for the client, one for the caller
+	memory->n_refs = 2;
+
+	memory->client_destroy.notify = client_memory_handle_client_destroy;
+	wl_client_add_destroy_listener(client, &memory->client_destroy);
+
+	wl_list_insert(&tracker->clients, &memory->link);
+
+	return memory;
+}
+
+void client_memory_unref(struct wlr_client_memory *memory) {
+	if (memory == NULL) {
+		return;
+	}
+
+	assert(memory->n_refs > 0);
+	memory->n_refs--;
+	if (memory->n_refs > 0) {
+		return;
+	}
+
+	assert(memory->client == NULL);
+	free(memory);
+}
+
+bool client_memory_check_budget(struct wlr_client_memory *memory, size_t size) {
+	if (memory == NULL || memory->tracker == NULL ||
+			memory->tracker->budget == 0) {
+		return true;
+	}
+
+	size_t budget = memory->tracker->budget;
+	if (memory->usage.total > budget || size > budget - memory->usage.total) {
+		wlr_log(WLR_DEBUG, "Client %p exceeds its memory budget "
+			"(%zu + %zu > %zu bytes)", (void *)memory->client,
+			memory->usage.total, size, budget);
+		return false;
+	}
+	return true;
+}
+
+static size_t *usage_field(struct wlr_client_memory_usage *usage,
+		enum wlr_client_memory_kind kind) {
+	switch (kind) {
+	case WLR_CLIENT_MEMORY_SHM:
+		return &usage->shm;
+	case WLR_CLIENT_MEMORY_DMABUF:
+		return &usage->dmabuf;
+	case WLR_CLIENT_MEMORY_TEXTURE:
+		return &usage->texture;
+	}
+	abort(); // unreachable
+}
+
+static void client_memory_emit_update(struct wlr_client_memory *memory) {
+	if (memory->tracker == NULL) {
+		return;
+	}
+
+	struct wlr_client_memory_update_event event = {
+		.client = memory->client,
+		.usage = &memory->usage,
+	};
+	wl_signal_emit_mutable(&memory->tracker->events.update, &event);
+}
+
+void client_memory_charge(struct wlr_client_memory *memory,
+		enum wlr_client_memory_kind kind, size_t size) {
+	if (memory == NULL || size == 0) {
+		return;
+	}
+
+	*usage_field(&memory->usage, kind) += size;
+	memory->usage.total += size;
+	client_memory_emit_update(memory);
+}
+
+void client_memory_release(struct wlr_client_memory *memory,
+		enum wlr_client_memory_kind kind, size_t size) {
+	if (memory == NULL || size == 0) {
+		return;
+	}
+
+	size_t *field = usage_field(&memory->usage, kind);
+	assert(*field >= size && memory->usage.total >= size);
+	*field -= size;
+	memory->usage.total -= size;
+	client_memory_emit_update(memory);
+}
+
+size_t client_memory_estimate_texture_size(struct wlr_texture *texture,
+		struct wlr_buffer *source) {
+	struct wlr_dmabuf_attributes dmabuf;
+	if (wlr_buffer_get_dmabuf(source, &dmabuf)) {
+		// DMA-BUFs are imported without a copy
+		return 0;
+	}
+	if (wlr_renderer_is_pixman(texture->renderer)) {
+		// Pixman textures wrap the buffer's data pointer
+		return 0;
+	}
+
+	const struct wlr_pixel_format_info *info = buffer_get_format_info(source);
+	if (info == NULL) {
+		// Assume 32 bits per pixel, as renderers do for unknown formats
+		return (size_t)texture->width * texture->height * 4;
+	}
+
+	int32_t stride = pixel_format_info_min_stride(info, texture->width);
+	uint32_t block_height = info->block_height > 0 ? info->block_height : 1;
+	size_t rows = (texture->height + block_height - 1) / block_height;
+	return (size_t)stride * rows;
+}
+
+static void tracker_destroy(struct wlr_client_memory_tracker *tracker) {
+	wl_signal_emit_mutable(&tracker->events.destroy, NULL);
+
+	assert(wl_list_empty(&tracker->events.update.listener_list));
+	assert(wl_list_empty(&tracker->events.destroy.listener_list));
+
+	struct wlr_client_memory *memory, *tmp;
+	wl_list_for_each_safe(memory, tmp, &tracker->clients, link) {
+		client_memory_detach(memory);
+	}
+
+	wl_list_remove(&tracker->display_destroy.link);
+	free(tracker);
+}
+
+static void tracker_handle_display_destroy(struct wl_listener *listener,
+		void *data) {
+	struct wlr_client_memory_tracker *tracker =
+		wl_container_of(listener, tracker, display_destroy);
+	tracker_destroy(tracker);
+}
+
+struct wlr_client_memory_tracker *wlr_client_memory_tracker_create(
+		struct wl_display *display) {
+	if (tracker_from_display(display) != NULL) {
+		wlr_log(WLR_ERROR, "A client memory tracker already exists "
+			"for this display");
+		return NULL;
+	}
+
+	struct wlr_client_memory_tracker *tracker = calloc(1, sizeof(*tracker));
+	if (tracker == NULL) {
+		return NULL;
+	}
+
+	wl_list_init(&tracker->clients);
+
+	wl_signal_init(&tracker->events.update);
+	wl_signal_init(&tracker->events.destroy);
+
+	tracker->display_destroy.notify = tracker_handle_display_destroy;
+	wl_display_add_destroy_listener(display, &tracker->display_destroy);
+
+	return tracker;
+}
+
+void wlr_client_memory_tracker_set_budget(
+		struct wlr_client_memory_tracker *tracker, size_t budget) {
+	tracker->budget = budget;
+}
+
+bool wlr_client_memory_tracker_get_usage(struct wlr_client_memory_tracker *tracker,
+		const struct wl_client *client, struct wlr_client_memory_usage *usage) {
+	struct wlr_client_memory *memory = client_memory_from_client(client);
+	if (memory == NULL || memory->tracker != tracker) {
+		*usage = (struct wlr_client_memory_usage){0};
+		return false;
+	}
+
+	*usage = memory->usage;
+	return true;
+}
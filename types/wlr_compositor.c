@@ -11,10 +11,12 @@
 #include <wlr/util/region.h>
 #include <wlr/util/transform.h>
 #include "types/wlr_buffer.h"
+#include "types/wlr_client_memory.h"
 #include "types/wlr_region.h"
 #include "types/wlr_subcompositor.h"
 #include "util/array.h"
 #include "util/time.h"
+#include "util/trace.h"
 
 #define COMPOSITOR_VERSION 6
 #define CALLBACK_VERSION 1
@@ -438,6 +440,14 @@ static void surface_apply_damage(struct wlr_surface *surface) {
 		return;
 	}
 
+	buffer->memory = client_memory_get(wl_resource_get_client(surface->resource));
+	if (buffer->memory != NULL) {
+		buffer->memory_size = client_memory_estimate_texture_size(
+			buffer->texture, surface->current.buffer);
+		client_memory_charge(buffer->memory, WLR_CLIENT_MEMORY_TEXTURE,
+			buffer->memory_size);
+	}
+
 	if (surface->buffer != NULL) {
 		wlr_buffer_unlock(&surface->buffer->base);
 	}
@@ -512,6 +522,8 @@ static void surface_commit_state(struct wlr_surface *surface,
 		struct wlr_surface_state *next) {
 	assert(next->cached_state_locks == 0);
 
+	TRACE_BEGIN(TRACE_SURFACE_COMMIT, wl_resource_get_id(surface->resource));
+
 	bool invalid_buffer = next->committed & WLR_SURFACE_STATE_BUFFER;
 
 	if (invalid_buffer && next->buffer == NULL) {
@@ -571,6 +583,8 @@ static void surface_commit_state(struct wlr_surface *surface,
 	// released immediately on commit when they are uploaded to the GPU.
 	wlr_buffer_unlock(surface->current.buffer);
 	surface->current.buffer = NULL;
+
+	TRACE_END(TRACE_SURFACE_COMMIT, wl_resource_get_id(surface->resource));
 }
 
 static void surface_handle_commit(struct wl_client *client,
@@ -0,0 +1,220 @@
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <wlr/types/wlr_frame_scheduler.h>
+#include <wlr/types/wlr_output.h>
+#include <wlr/util/log.h>
+#include "util/time.h"
+
+#define DEFAULT_MARGIN_NSEC (2 * 1000 * 1000)
+// Frames to measure before the frame event starts being delayed
+#define MIN_SAMPLES 8
+// Consecutive missed vblanks after which the scheduler stops delaying
+#define MAX_MISSED 2
+// Frames emitted without delay after too many missed vblanks
+#define FALLBACK_FRAMES 120
+
+static void scheduler_emit_frame(struct wlr_frame_scheduler *scheduler,
+		int64_t now) {
+	scheduler->frame_nsec = now;
+	wl_signal_emit_mutable(&scheduler->events.frame, scheduler);
+}
+
+static int compare_samples(const void *a, const void *b) {
+	int64_t sa = *(const int64_t *)a, sb = *(const int64_t *)b;
+	return (sa > sb) - (sa < sb);
+}
+
+int64_t wlr_frame_scheduler_get_predicted_render_time(
+		struct wlr_frame_scheduler *scheduler) {
+	if (scheduler->samples_len < MIN_SAMPLES) {
+		return -1;
+	}
+
+	// Use the 90th percentile: the occasional slow frame shouldn't push
+	// every frame earlier, but most frames should make it
+	int64_t sorted[WLR_FRAME_SCHEDULER_SAMPLES];
+	size_t len = scheduler->samples_len;
+	memcpy(sorted, scheduler->samples, len * sizeof(sorted[0]));
+	qsort(sorted, len, sizeof(sorted[0]), compare_samples);
+	return sorted[len * 9 / 10];
+}
+
+static void scheduler_add_sample(struct wlr_frame_scheduler *scheduler,
+		int64_t duration) {
+	scheduler->samples[scheduler->samples_next] = duration;
+	scheduler->samples_next =
+		(scheduler->samples_next + 1) % WLR_FRAME_SCHEDULER_SAMPLES;
+	if (scheduler->samples_len < WLR_FRAME_SCHEDULER_SAMPLES) {
+		scheduler->samples_len++;
+	}
+}
+
+void wlr_frame_scheduler_add_render_time(struct wlr_frame_scheduler *scheduler,
+		int64_t duration_nsec) {
+	if (duration_nsec <= 0 || scheduler->samples_len == 0) {
+		return;
+	}
+	size_t last = (scheduler->samples_next + WLR_FRAME_SCHEDULER_SAMPLES - 1) %
+		WLR_FRAME_SCHEDULER_SAMPLES;
+	if (scheduler->samples[last] < duration_nsec) {
+		scheduler->samples[last] = duration_nsec;
+	}
+}
+
+static int handle_timer(void *data) {
+	struct wlr_frame_scheduler *scheduler = data;
+	if (scheduler->output->enabled) {
+		scheduler_emit_frame(scheduler, get_current_time_nsec());
+	}
+	return 0;
+}
+
+static void handle_output_frame(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_frame);
+	struct wlr_output *output = scheduler->output;
+	int64_t now = get_current_time_nsec();
+
+	scheduler->target_nsec = 0;
+
+	int64_t render_time = wlr_frame_scheduler_get_predicted_render_time(scheduler);
+	if (scheduler->fallback_frames > 0) {
+		scheduler->fallback_frames--;
+		render_time = -1;
+	}
+	if (render_time < 0 || scheduler->refresh_nsec <= 0 ||
+			scheduler->last_present_nsec == 0 ||
+			output->adaptive_sync_status == WLR_OUTPUT_ADAPTIVE_SYNC_ENABLED) {
+		scheduler_emit_frame(scheduler, now);
+		return;
+	}
+
+	// Extrapolate the next vblank from the last presentation
+	int64_t refresh = scheduler->refresh_nsec;
+	int64_t elapsed = now - scheduler->last_present_nsec;
+	int64_t cycles = elapsed > 0 ? elapsed / refresh + 1 : 1;
+	int64_t vblank = scheduler->last_present_nsec + cycles * refresh;
+
+	scheduler->target_nsec = vblank;
+	int64_t delay_msec =
+		(vblank - render_time - scheduler->margin_nsec - now) / 1000000;
+	if (delay_msec <= 0) {
+		scheduler_emit_frame(scheduler, now);
+		return;
+	}
+
+	// Timers have millisecond granularity, round down to start early rather
+	// than late
+	wl_event_source_timer_update(scheduler->timer, delay_msec);
+}
+
+static void handle_output_commit(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_commit);
+	const struct wlr_output_event_commit *event = data;
+
+	if (!(event->state->committed & WLR_OUTPUT_STATE_BUFFER) ||
+			scheduler->frame_nsec == 0) {
+		return;
+	}
+
+	scheduler_add_sample(scheduler,
+		timespec_to_nsec(&event->when) - scheduler->frame_nsec);
+	scheduler->frame_nsec = 0;
+
+	scheduler->target_pending = scheduler->target_nsec != 0;
+	scheduler->target_commit_seq = scheduler->output->commit_seq;
+}
+
+static void handle_output_present(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_present);
+	const struct wlr_output_event_present *event = data;
+
+	if (!event->presented) {
+		return;
+	}
+
+	int64_t when = timespec_to_nsec(&event->when);
+	int refresh = event->refresh;
+	if (refresh <= 0 && scheduler->output->refresh > 0) {
+		refresh = 1000000000000LL / scheduler->output->refresh;
+	}
+	scheduler->last_present_nsec = when;
+	scheduler->refresh_nsec = refresh;
+
+	if (!scheduler->target_pending ||
+			event->commit_seq != scheduler->target_commit_seq) {
+		return;
+	}
+	scheduler->target_pending = false;
+
+	if (refresh > 0 && when > scheduler->target_nsec + refresh / 2) {
+		scheduler->missed++;
+		if (scheduler->missed >= MAX_MISSED) {
+			wlr_log(WLR_DEBUG, "Output %s missed %d vblanks in a row, "
+				"rendering early for %d frames", scheduler->output->name,
+				scheduler->missed, FALLBACK_FRAMES);
+			scheduler->missed = 0;
+			scheduler->fallback_frames = FALLBACK_FRAMES;
+		}
+	} else {
+		scheduler->missed = 0;
+	}
+}
+
+static void handle_output_destroy(struct wl_listener *listener, void *data) {
+	struct wlr_frame_scheduler *scheduler =
+		wl_container_of(listener, scheduler, output_destroy);
+	wlr_frame_scheduler_destroy(scheduler);
+}
+
+struct wlr_frame_scheduler *wlr_frame_scheduler_create(struct wlr_output *output) {
+	struct wlr_frame_scheduler *scheduler = calloc(1, sizeof(*scheduler));
+	if (scheduler == NULL) {
+		return NULL;
+	}
+
+	scheduler->timer = wl_event_loop_add_timer(output->event_loop,
+		handle_timer, scheduler);
+	if (scheduler->timer == NULL) {
+		free(scheduler);
+		return NULL;
+	}
+
+	scheduler->output = output;
+	scheduler->margin_nsec = DEFAULT_MARGIN_NSEC;
+
+	wl_signal_init(&scheduler->events.frame);
+	wl_signal_init(&scheduler->events.destroy);
+
+	scheduler->output_frame.notify = handle_output_frame;
+	wl_signal_add(&output->events.frame, &scheduler->output_frame);
+	scheduler->output_commit.notify = handle_output_commit;
+	wl_signal_add(&output->events.commit, &scheduler->output_commit);
+	scheduler->output_present.notify = handle_output_present;
+	wl_signal_add(&output->events.present, &scheduler->output_present);
+	scheduler->output_destroy.notify = handle_output_destroy;
+	wl_signal_add(&output->events.destroy, &scheduler->output_destroy);
+
+	return scheduler;
+}
+
+void wlr_frame_scheduler_destroy(struct wlr_frame_scheduler *scheduler) {
+	if (scheduler == NULL) {
+		return;
+	}
+
+	wl_signal_emit_mutable(&scheduler->events.destroy, NULL);
+
+	assert(wl_list_empty(&scheduler->events.frame.listener_list));
+	assert(wl_list_empty(&scheduler->events.destroy.listener_list));
+
+	wl_event_source_remove(scheduler->timer);
+	wl_list_remove(&scheduler->output_frame.link);
+	wl_list_remove(&scheduler->output_commit.link);
+	wl_list_remove(&scheduler->output_present.link);
+	wl_list_remove(&scheduler->output_destroy.link);
+	free(scheduler);
+}
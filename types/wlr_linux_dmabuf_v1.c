@@ -2,6 +2,7 @@
 #include <drm_fourcc.h>
 #include <fcntl.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 #include <wlr/backend.h>
@@ -15,6 +16,7 @@
 #include <xf86drm.h>
 #include "linux-dmabuf-v1-protocol.h"
 #include "render/drm_format_set.h"
+#include "types/wlr_client_memory.h"
 #include "util/shm.h"
 
 #if WLR_HAS_DRM_BACKEND
@@ -36,7 +38,18 @@ struct wlr_linux_dmabuf_feedback_v1_compiled_tranche {
 	struct wl_array indices; // uint16_t
 };
 
+/**
+ * Compiled feedbacks are interned per struct wlr_linux_dmabuf_v1: surfaces
+ * (and the default feedback) which are given identical feedback share the
+ * same format table.
+ */
 struct wlr_linux_dmabuf_feedback_v1_compiled {
+	struct wl_list link; // wlr_linux_dmabuf_v1.compiled_feedbacks
+	size_t n_refs;
+	// Serialized uncompiled feedback, used as the interning key
+	struct wl_array key; // uint64_t
+	uint64_t hash;
+
 	dev_t main_device;
 	int table_fd;
 	size_t table_size;
@@ -107,6 +120,9 @@ static void buffer_destroy(struct wlr_buffer *wlr_buffer) {
 	if (buffer->resource != NULL) {
 		wl_resource_set_user_data(buffer->resource, NULL);
 	}
+	client_memory_release(buffer->memory, WLR_CLIENT_MEMORY_DMABUF,
+		buffer->memory_size);
+	client_memory_unref(buffer->memory);
 	wlr_dmabuf_attributes_finish(&buffer->attributes);
 	free(buffer);
 }
@@ -227,6 +243,18 @@ static bool check_import_dmabuf(struct wlr_dmabuf_attributes *attribs, void *dat
 	return true;
 }
 
+/**
+ * Estimate the memory pinned by a DMA-BUF. Sub-sampled planes are
+ * over-estimated.
+ */
+static size_t dmabuf_estimate_size(const struct wlr_dmabuf_attributes *attribs) {
+	size_t size = 0;
+	for (int i = 0; i < attribs->n_planes; i++) {
+		size += (size_t)attribs->stride[i] * attribs->height;
+	}
+	return size;
+}
+
 static void params_create_common(struct wl_resource *params_resource,
 		uint32_t buffer_id, int32_t width, int32_t height, uint32_t format,
 		uint32_t flags) {
@@ -342,23 +370,34 @@ static void params_create_common(struct wl_resource *params_resource,
 		}
 	}
 
+	struct wl_client *client = wl_resource_get_client(params_resource);
+	struct wlr_client_memory *memory = client_memory_get(client);
+	size_t memory_size = dmabuf_estimate_size(&attribs);
+	if (!client_memory_check_budget(memory, memory_size)) {
+		client_memory_unref(memory);
+		wl_resource_post_no_memory(params_resource);
+		goto err_out;
+	}
+
 	/* Check if dmabuf is usable */
 	if (!linux_dmabuf->check_dmabuf_callback(&attribs,
 				linux_dmabuf->check_dmabuf_callback_data)) {
+		client_memory_unref(memory);
 		goto err_failed;
 	}
 
 	struct wlr_dmabuf_v1_buffer *buffer = calloc(1, sizeof(*buffer));
 	if (!buffer) {
+		client_memory_unref(memory);
 		wl_resource_post_no_memory(params_resource);
 		goto err_failed;
 	}
 	wlr_buffer_init(&buffer->base, &buffer_impl, attribs.width, attribs.height);
 
-	struct wl_client *client = wl_resource_get_client(params_resource);
 	buffer->resource = wl_resource_create(client, &wl_buffer_interface,
 		1, buffer_id);
 	if (!buffer->resource) {
+		client_memory_unref(memory);
 		wl_resource_post_no_memory(params_resource);
 		free(buffer);
 		goto err_failed;
@@ -368,6 +407,10 @@ static void params_create_common(struct wl_resource *params_resource,
 
 	buffer->attributes = attribs;
 
+	buffer->memory = memory;
+	buffer->memory_size = memory_size;
+	client_memory_charge(memory, WLR_CLIENT_MEMORY_DMABUF, memory_size);
+
 	buffer->release.notify = buffer_handle_release;
 	wl_signal_add(&buffer->base.events.release, &buffer->release);
 
@@ -633,10 +676,110 @@ static void compiled_feedback_destroy(
 	for (size_t i = 0; i < feedback->tranches_len; i++) {
 		wl_array_release(&feedback->tranches[i].indices);
 	}
+	wl_array_release(&feedback->key);
 	close(feedback->table_fd);
 	free(feedback);
 }
 
+static bool feedback_key_append(struct wl_array *key, uint64_t value) {
+	uint64_t *ptr = wl_array_add(key, sizeof(*ptr));
+	if (ptr == NULL) {
+		return false;
+	}
+	*ptr = value;
+	return true;
+}
+
+static bool feedback_serialize(const struct wlr_linux_dmabuf_feedback_v1 *feedback,
+		struct wl_array *key) {
+	const struct wlr_linux_dmabuf_feedback_v1_tranche *tranches = feedback->tranches.data;
+	size_t tranches_len = feedback->tranches.size / sizeof(struct wlr_linux_dmabuf_feedback_v1_tranche);
+
+	bool ok = feedback_key_append(key, feedback->main_device) &&
+		feedback_key_append(key, tranches_len);
+	for (size_t i = 0; ok && i < tranches_len; i++) {
+		const struct wlr_linux_dmabuf_feedback_v1_tranche *tranche = &tranches[i];
+		ok = feedback_key_append(key, tranche->target_device) &&
+			feedback_key_append(key, tranche->flags) &&
+			feedback_key_append(key, tranche->formats.len);
+		for (size_t j = 0; ok && j < tranche->formats.len; j++) {
+			const struct wlr_drm_format *fmt = &tranche->formats.formats[j];
+			ok = feedback_key_append(key, fmt->format) &&
+				feedback_key_append(key, fmt->len);
+			for (size_t k = 0; ok && k < fmt->len; k++) {
+				ok = feedback_key_append(key, fmt->modifiers[k]);
+			}
+		}
+	}
+	return ok;
+}
+
+static uint64_t feedback_key_hash(const struct wl_array *key) {
+	// 64-bit FNV-1a
+	uint64_t hash = 0xcbf29ce484222325;
+	const uint8_t *data = key->data;
+	for (size_t i = 0; i < key->size; i++) {
+		hash ^= data[i];
+		hash *= 0x100000001b3;
+	}
+	return hash;
+}
+
+/**
+ * Get a compiled feedback matching the provided feedback, compiling it only
+ * if no identical feedback is already in use. The caller gets a reference.
+ */
+static struct wlr_linux_dmabuf_feedback_v1_compiled *feedback_intern(
+		struct wlr_linux_dmabuf_v1 *linux_dmabuf,
+		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
+	struct wl_array key;
+	wl_array_init(&key);
+	if (!feedback_serialize(feedback, &key)) {
+		wlr_log(WLR_ERROR, "Allocation failed");
+		wl_array_release(&key);
+		return NULL;
+	}
+	uint64_t hash = feedback_key_hash(&key);
+
+	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled;
+	wl_list_for_each(compiled, &linux_dmabuf->compiled_feedbacks, link) {
+		if (compiled->hash == hash && compiled->key.size == key.size &&
+				memcmp(compiled->key.data, key.data, key.size) == 0) {
+			wl_array_release(&key);
+			compiled->n_refs++;
+			return compiled;
+		}
+	}
+
+	compiled = feedback_compile(feedback);
+	if (compiled == NULL) {
+		wl_array_release(&key);
+		return NULL;
+	}
+
+	compiled->key = key;
+	compiled->hash = hash;
+	compiled->n_refs = 1;
+	wl_list_insert(&linux_dmabuf->compiled_feedbacks, &compiled->link);
+	return compiled;
+}
+
+static void compiled_feedback_unref(
+		struct wlr_linux_dmabuf_feedback_v1_compiled *feedback) {
+	if (feedback == NULL) {
+		return;
+	}
+
+	assert(feedback->n_refs > 0);
+	feedback->n_refs--;
+	if (feedback->n_refs > 0) {
+		return;
+	}
+
+	wl_list_remove(&feedback->link);
+	compiled_feedback_destroy(feedback);
+}
+
 static void feedback_tranche_send(
 		const struct wlr_linux_dmabuf_feedback_v1_compiled_tranche *tranche,
 		struct wl_resource *resource) {
@@ -695,7 +838,7 @@ static void surface_destroy(struct wlr_linux_dmabuf_v1_surface *surface) {
 		wl_list_init(link);
 	}
 
-	compiled_feedback_destroy(surface->feedback);
+	compiled_feedback_unref(surface->feedback);
 
 	wlr_addon_finish(&surface->addon);
 	wl_list_remove(&surface->link);
@@ -866,7 +1009,8 @@ static void linux_dmabuf_v1_destroy(struct wlr_linux_dmabuf_v1 *linux_dmabuf) {
 		surface_destroy(surface);
 	}
 
-	compiled_feedback_destroy(linux_dmabuf->default_feedback);
+	compiled_feedback_unref(linux_dmabuf->default_feedback);
+	assert(wl_list_empty(&linux_dmabuf->compiled_feedbacks));
 	wlr_drm_format_set_finish(&linux_dmabuf->default_formats);
 	if (linux_dmabuf->main_device_fd >= 0) {
 		close(linux_dmabuf->main_device_fd);
@@ -886,7 +1030,8 @@ static void handle_display_destroy(struct wl_listener *listener, void *data) {
 
 static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 		const struct wlr_linux_dmabuf_feedback_v1 *feedback) {
-	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = feedback_compile(feedback);
+	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled =
+		feedback_intern(linux_dmabuf, feedback);
 	if (compiled == NULL) {
 		return false;
 	}
@@ -928,7 +1073,7 @@ static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 		}
 	}
 
-	compiled_feedback_destroy(linux_dmabuf->default_feedback);
+	compiled_feedback_unref(linux_dmabuf->default_feedback);
 	linux_dmabuf->default_feedback = compiled;
 
 	if (linux_dmabuf->main_device_fd >= 0) {
@@ -944,7 +1089,7 @@ static bool set_default_feedback(struct wlr_linux_dmabuf_v1 *linux_dmabuf,
 error_formats:
 	wlr_drm_format_set_finish(&formats);
 error_compiled:
-	compiled_feedback_destroy(compiled);
+	compiled_feedback_unref(compiled);
 	return false;
 }
 
@@ -960,6 +1105,7 @@ struct wlr_linux_dmabuf_v1 *wlr_linux_dmabuf_v1_create(struct wl_display *displa
 	linux_dmabuf->main_device_fd = -1;
 
 	wl_list_init(&linux_dmabuf->surfaces);
+	wl_list_init(&linux_dmabuf->compiled_feedbacks);
 
 	wl_signal_init(&linux_dmabuf->events.destroy);
 
@@ -1025,15 +1171,24 @@ bool wlr_linux_dmabuf_v1_set_surface_feedback(
 
 	struct wlr_linux_dmabuf_feedback_v1_compiled *compiled = NULL;
 	if (feedback != NULL) {
-		compiled = feedback_compile(feedback);
+		compiled = feedback_intern(linux_dmabuf, feedback);
 		if (compiled == NULL) {
 			return false;
 		}
 	}
 
-	compiled_feedback_destroy(surface->feedback);
+	// Interning makes identical feedback compile to the same object, so
+	// there is nothing to send if the effective feedback is unchanged
+	bool changed = surface_get_feedback(surface) !=
+		(compiled != NULL ? compiled : linux_dmabuf->default_feedback);
+
+	compiled_feedback_unref(surface->feedback);
 	surface->feedback = compiled;
 
+	if (!changed) {
+		return true;
+	}
+
 	struct wl_resource *resource;
 	wl_resource_for_each(resource, &surface->feedback_resources) {
 		feedback_send(surface_get_feedback(surface), resource);
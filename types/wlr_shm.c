@@ -14,6 +14,7 @@
 #include <wlr/types/wlr_shm.h>
 #include <wlr/util/log.h>
 #include "render/pixel_format.h"
+#include "types/wlr_client_memory.h"
 
 #ifdef __STDC_NO_ATOMICS__
 #error "C11 atomics are required"
@@ -30,6 +31,7 @@ struct wlr_shm_pool {
 	struct wl_list buffers; // wlr_shm_buffer.link
 	int fd;
 	struct wlr_shm_mapping *mapping;
+	struct wlr_client_memory *memory; // may be NULL
 };
 
 /**
@@ -383,6 +385,12 @@ static void pool_handle_resize(struct wl_client *client,
 		return;
 	}
 
+	size_t grow = (size_t)size - pool->mapping->size;
+	if (!client_memory_check_budget(pool->memory, grow)) {
+		wl_resource_post_no_memory(pool_resource);
+		return;
+	}
+
 	struct wlr_shm_mapping *mapping = mapping_create(pool->fd, size);
 	if (mapping == NULL) {
 		wl_resource_post_error(pool_resource, WL_SHM_ERROR_INVALID_FD,
@@ -392,6 +400,7 @@ static void pool_handle_resize(struct wl_client *client,
 
 	mapping_drop(pool->mapping);
 	pool->mapping = mapping;
+	client_memory_charge(pool->memory, WLR_CLIENT_MEMORY_SHM, grow);
 }
 
 static const struct wl_shm_pool_interface pool_impl = {
@@ -405,6 +414,9 @@ static void pool_consider_destroy(struct wlr_shm_pool *pool) {
 		return;
 	}
 
+	client_memory_release(pool->memory, WLR_CLIENT_MEMORY_SHM,
+		pool->mapping->size);
+	client_memory_unref(pool->memory);
 	mapping_drop(pool->mapping);
 	close(pool->fd);
 	free(pool);
@@ -426,11 +438,17 @@ static void shm_handle_create_pool(struct wl_client *client,
 		goto error_fd;
 	}
 
+	struct wlr_client_memory *memory = client_memory_get(client);
+	if (!client_memory_check_budget(memory, size)) {
+		wl_resource_post_no_memory(shm_resource);
+		goto error_memory;
+	}
+
 	struct wlr_shm_mapping *mapping = mapping_create(fd, size);
 	if (mapping == NULL) {
 		wl_resource_post_error(shm_resource, WL_SHM_ERROR_INVALID_FD,
 			"Failed to create memory mapping");
-		goto error_fd;
+		goto error_memory;
 	}
 
 	struct wlr_shm_pool *pool = calloc(1, sizeof(*pool));
@@ -452,13 +470,17 @@ static void shm_handle_create_pool(struct wl_client *client,
 	pool->mapping = mapping;
 	pool->shm = shm;
 	pool->fd = fd;
+	pool->memory = memory;
 	wl_list_init(&pool->buffers);
+	client_memory_charge(memory, WLR_CLIENT_MEMORY_SHM, mapping->size);
 	return;
 
 error_pool:
 	free(pool);
 error_mapping:
 	mapping_drop(mapping);
+error_memory:
+	client_memory_unref(memory);
 error_fd:
 	close(fd);
 }
@@ -1,6 +1,33 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include <wlr/types/wlr_xcursor_manager.h>
+#include <wlr/util/log.h>
+
+/**
+ * Themes being loaded by a worker thread. The worker only touches this struct,
+ * and writes to the pipe once done.
+ */
+struct xcursor_manager_load {
+	struct wlr_xcursor_manager *manager;
+	struct wl_list link; // wlr_xcursor_manager.loads
+
+	char *name;
+	size_t len;
+	float *scales;
+	int *sizes;
+	struct wlr_xcursor_theme **themes;
+	bool ok;
+
+	pthread_t thread;
+	int pipe_fds[2];
+	struct wl_event_source *event_source; // NULL once the loop is destroyed
+	struct wl_listener loop_destroy;
+};
 
 struct wlr_xcursor_manager *wlr_xcursor_manager_create(const char *name,
 		uint32_t size) {
@@ -13,13 +40,110 @@ struct wlr_xcursor_manager *wlr_xcursor_manager_create(const char *name,
 	}
 	manager->size = size;
 	wl_list_init(&manager->scaled_themes);
+	wl_list_init(&manager->loads);
+	wl_signal_init(&manager->events.load);
 	return manager;
 }
 
+static void load_destroy(struct xcursor_manager_load *load) {
+	wl_list_remove(&load->link);
+	wl_list_remove(&load->loop_destroy.link);
+	if (load->event_source != NULL) {
+		wl_event_source_remove(load->event_source);
+	}
+	if (load->pipe_fds[0] >= 0) {
+		close(load->pipe_fds[0]);
+		close(load->pipe_fds[1]);
+	}
+	free(load->name);
+	free(load->scales);
+	free(load->sizes);
+	free(load->themes);
+	free(load);
+}
+
+static struct wlr_xcursor_manager_theme *manager_get_theme(
+		struct wlr_xcursor_manager *manager, float scale) {
+	struct wlr_xcursor_manager_theme *theme;
+	wl_list_for_each(theme, &manager->scaled_themes, link) {
+		if (theme->scale == scale) {
+			return theme;
+		}
+	}
+	return NULL;
+}
+
+/**
+ * Wait for the worker thread and add the themes it loaded to the manager.
+ * Returns true if any theme has been added.
+ */
+static bool load_finish(struct xcursor_manager_load *load) {
+	struct wlr_xcursor_manager *manager = load->manager;
+
+	pthread_join(load->thread, NULL);
+
+	bool added = false;
+	for (size_t i = 0; load->ok && i < load->len; i++) {
+		// The same scale may have been loaded synchronously in the meantime
+		struct wlr_xcursor_manager_theme *theme = NULL;
+		if (manager_get_theme(manager, load->scales[i]) == NULL) {
+			theme = calloc(1, sizeof(*theme));
+		}
+		if (theme == NULL) {
+			wlr_xcursor_theme_destroy(load->themes[i]);
+			continue;
+		}
+		theme->scale = load->scales[i];
+		theme->theme = load->themes[i];
+		wl_list_insert(&manager->scaled_themes, &theme->link);
+		added = true;
+	}
+
+	load_destroy(load);
+	return added;
+}
+
+static void *load_thread(void *data) {
+	struct xcursor_manager_load *load = data;
+
+	load->ok = wlr_xcursor_theme_load_sizes(load->name, load->sizes,
+		load->len, load->themes);
+
+	char byte = 0;
+	while (write(load->pipe_fds[1], &byte, 1) < 0 && errno == EINTR) {
+		// Retry
+	}
+	return NULL;
+}
+
+static int handle_load_done(int fd, uint32_t mask, void *data) {
+	struct xcursor_manager_load *load = data;
+	struct wlr_xcursor_manager *manager = load->manager;
+	if (load_finish(load)) {
+		wl_signal_emit_mutable(&manager->events.load, NULL);
+	}
+	return 0;
+}
+
+static void load_handle_loop_destroy(struct wl_listener *listener, void *data) {
+	struct xcursor_manager_load *load =
+		wl_container_of(listener, load, loop_destroy);
+	// The themes are picked up when the manager joins the worker thread
+	wl_event_source_remove(load->event_source);
+	load->event_source = NULL;
+	wl_list_remove(&load->loop_destroy.link);
+	wl_list_init(&load->loop_destroy.link);
+}
+
 void wlr_xcursor_manager_destroy(struct wlr_xcursor_manager *manager) {
 	if (manager == NULL) {
 		return;
 	}
+	struct xcursor_manager_load *load, *load_tmp;
+	wl_list_for_each_safe(load, load_tmp, &manager->loads, link) {
+		load_finish(load);
+	}
+	assert(wl_list_empty(&manager->events.load.listener_list));
 	struct wlr_xcursor_manager_theme *theme, *tmp;
 	wl_list_for_each_safe(theme, tmp, &manager->scaled_themes, link) {
 		wl_list_remove(&theme->link);
@@ -30,16 +154,36 @@ void wlr_xcursor_manager_destroy(struct wlr_xcursor_manager *manager) {
 	free(manager);
 }
 
+static struct xcursor_manager_load *manager_find_load(
+		struct wlr_xcursor_manager *manager, float scale) {
+	struct xcursor_manager_load *load;
+	wl_list_for_each(load, &manager->loads, link) {
+		for (size_t i = 0; i < load->len; i++) {
+			if (load->scales[i] == scale) {
+				return load;
+			}
+		}
+	}
+	return NULL;
+}
+
 bool wlr_xcursor_manager_load(struct wlr_xcursor_manager *manager,
 		float scale) {
-	struct wlr_xcursor_manager_theme *theme;
-	wl_list_for_each(theme, &manager->scaled_themes, link) {
-		if (theme->scale == scale) {
+	if (manager_get_theme(manager, scale) != NULL) {
+		return true;
+	}
+
+	// Rather than loading the theme a second time, wait for the worker thread
+	// which is already on it
+	struct xcursor_manager_load *load = manager_find_load(manager, scale);
+	if (load != NULL) {
+		load_finish(load);
+		if (manager_get_theme(manager, scale) != NULL) {
 			return true;
 		}
 	}
 
-	theme = calloc(1, sizeof(*theme));
+	struct wlr_xcursor_manager_theme *theme = calloc(1, sizeof(*theme));
 	if (theme == NULL) {
 		return false;
 	}
@@ -53,13 +197,85 @@ bool wlr_xcursor_manager_load(struct wlr_xcursor_manager *manager,
 	return true;
 }
 
+bool wlr_xcursor_manager_load_async(struct wlr_xcursor_manager *manager,
+		struct wl_event_loop *loop, const float *scales, size_t scales_len) {
+	struct xcursor_manager_load *load = calloc(1, sizeof(*load));
+	if (load == NULL) {
+		return false;
+	}
+	load->manager = manager;
+	load->pipe_fds[0] = load->pipe_fds[1] = -1;
+	wl_list_init(&load->link);
+	wl_list_init(&load->loop_destroy.link);
+
+	load->scales = calloc(scales_len, sizeof(load->scales[0]));
+	load->sizes = calloc(scales_len, sizeof(load->sizes[0]));
+	load->themes = calloc(scales_len, sizeof(load->themes[0]));
+	if (load->scales == NULL || load->sizes == NULL || load->themes == NULL) {
+		goto error;
+	}
+	if (manager->name != NULL) {
+		load->name = strdup(manager->name);
+		if (load->name == NULL) {
+			goto error;
+		}
+	}
+
+	// Skip scales which are already loaded or being loaded
+	for (size_t i = 0; i < scales_len; i++) {
+		float scale = scales[i];
+		bool dup = manager_get_theme(manager, scale) != NULL ||
+			manager_find_load(manager, scale) != NULL;
+		for (size_t j = 0; !dup && j < load->len; j++) {
+			dup = load->scales[j] == scale;
+		}
+		if (dup) {
+			continue;
+		}
+		load->scales[load->len] = scale;
+		load->sizes[load->len] = manager->size * scale;
+		load->len++;
+	}
+	if (load->len == 0) {
+		load_destroy(load);
+		return true;
+	}
+
+	if (pipe(load->pipe_fds) != 0) {
+		wlr_log_errno(WLR_ERROR, "pipe() failed");
+		goto error;
+	}
+	fcntl(load->pipe_fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(load->pipe_fds[1], F_SETFD, FD_CLOEXEC);
+
+	load->event_source = wl_event_loop_add_fd(loop, load->pipe_fds[0],
+		WL_EVENT_READABLE, handle_load_done, load);
+	if (load->event_source == NULL) {
+		wlr_log(WLR_ERROR, "Failed to add xcursor load event source");
+		goto error;
+	}
+	load->loop_destroy.notify = load_handle_loop_destroy;
+	wl_event_loop_add_destroy_listener(loop, &load->loop_destroy);
+
+	int ret = pthread_create(&load->thread, NULL, load_thread, load);
+	if (ret != 0) {
+		wlr_log(WLR_ERROR, "pthread_create() failed: %s", strerror(ret));
+		goto error;
+	}
+
+	wl_list_insert(&manager->loads, &load->link);
+	return true;
+
+error:
+	load_destroy(load);
+	return false;
+}
+
 struct wlr_xcursor *wlr_xcursor_manager_get_xcursor(
 		struct wlr_xcursor_manager *manager, const char *name, float scale) {
-	struct wlr_xcursor_manager_theme *theme;
-	wl_list_for_each(theme, &manager->scaled_themes, link) {
-		if (theme->scale == scale) {
-			return wlr_xcursor_theme_get_cursor(theme->theme, name);
-		}
+	struct wlr_xcursor_manager_theme *theme = manager_get_theme(manager, scale);
+	if (theme == NULL) {
+		return NULL;
 	}
-	return NULL;
+	return wlr_xcursor_theme_get_cursor(theme->theme, name);
 }
@@ -4,6 +4,7 @@
 #include <wlr/util/box.h>
 #include <wlr/util/log.h>
 #include "types/wlr_xdg_shell.h"
+#include "util/sched.h"
 
 static void xdg_surface_configure_destroy(
 		struct wlr_xdg_surface_configure *configure) {
@@ -38,7 +39,7 @@ static void reset_xdg_surface(struct wlr_xdg_surface *surface) {
 	}
 
 	if (surface->configure_idle) {
-		wl_event_source_remove(surface->configure_idle);
+		sched_task_cancel(surface->configure_idle);
 		surface->configure_idle = NULL;
 	}
 }
@@ -169,7 +170,7 @@ uint32_t wlr_xdg_surface_schedule_configure(struct wlr_xdg_surface *surface) {
 
 	if (surface->configure_idle == NULL) {
 		surface->scheduled_serial = wl_display_next_serial(display);
-		surface->configure_idle = wl_event_loop_add_idle(loop,
+		surface->configure_idle = sched_post(loop, SCHED_CLASS_PROTOCOL, 0,
 			surface_send_configure, surface);
 		if (surface->configure_idle == NULL) {
 			wl_client_post_no_memory(surface->client->client);
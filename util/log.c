@@ -1,5 +1,10 @@
 #include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <signal.h>
 #include <stdarg.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -34,6 +39,15 @@ static void init_start_time(void) {
 	clock_gettime(CLOCK_MONOTONIC, &start_time);
 }
 
+static bool use_colors(void) {
+	// isatty() is a syscall, stderr is not expected to change
+	static int stderr_is_tty = -1;
+	if (stderr_is_tty < 0) {
+		stderr_is_tty = isatty(STDERR_FILENO);
+	}
+	return colored && stderr_is_tty;
+}
+
 static void log_stderr(enum wlr_log_importance verbosity, const char *fmt,
 		va_list args) {
 	init_start_time();
@@ -52,7 +66,8 @@ static void log_stderr(enum wlr_log_importance verbosity, const char *fmt,
 
 	unsigned c = (verbosity < WLR_LOG_IMPORTANCE_LAST) ? verbosity : WLR_LOG_IMPORTANCE_LAST - 1;
 
-	if (colored && isatty(STDERR_FILENO)) {
+	bool colors = use_colors();
+	if (colors) {
 		fprintf(stderr, "%s", verbosity_colors[c]);
 	} else {
 		fprintf(stderr, "%s ", verbosity_headers[c]);
@@ -60,12 +75,317 @@ static void log_stderr(enum wlr_log_importance verbosity, const char *fmt,
 
 	vfprintf(stderr, fmt, args);
 
-	if (colored && isatty(STDERR_FILENO)) {
+	if (colors) {
 		fprintf(stderr, "\x1B[0m");
 	}
 	fprintf(stderr, "\n");
 }
 
+// Size of a message of the asynchronous logger, longer ones are truncated
+#define ASYNC_MSG_SIZE 1024
+// Number of messages the asynchronous logger can queue, a power of two
+#define ASYNC_RING_LEN 1024
+// Size of the buffer used by the writer to batch messages
+#define ASYNC_WRITE_SIZE (16 * ASYNC_MSG_SIZE)
+
+struct async_slot {
+	// Sequence number of the ring position: equal to the position when the
+	// slot is free, to the position + 1 when it holds a message
+	atomic_size_t seq;
+	size_t len;
+	char data[ASYNC_MSG_SIZE];
+};
+
+/**
+ * Bounded lock-free multi-producer multi-consumer ring. Logging threads
+ * produce, the writer thread and wlr_log_async_flush() consume.
+ */
+struct async_ring {
+	struct async_slot slots[ASYNC_RING_LEN];
+	atomic_size_t enqueue_pos, dequeue_pos;
+	atomic_uint_fast64_t dropped;
+	// Updated with a compare-and-swap: crash flushes don't hold write_lock
+	atomic_uint_fast64_t dropped_reported;
+
+	bool colors;
+
+	sem_t sem; // posted when a message is queued while the writer sleeps
+	atomic_bool writer_sleeping;
+	atomic_flag write_lock; // serializes writes to stderr
+};
+
+static struct async_ring *async_ring = NULL;
+static pthread_once_t async_once = PTHREAD_ONCE_INIT;
+
+static size_t async_format(struct async_ring *ring, char *buf, size_t size,
+		enum wlr_log_importance verbosity, const char *fmt, va_list args) {
+	struct timespec ts = {0};
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	timespec_sub(&ts, &ts, &start_time);
+
+	unsigned c = (verbosity < WLR_LOG_IMPORTANCE_LAST) ? verbosity : WLR_LOG_IMPORTANCE_LAST - 1;
+	bool colors = ring->colors;
+
+	// Keep room for the color reset and the newline
+	const char *suffix = colors ? "\x1B[0m\n" : "\n";
+	size_t suffix_len = strlen(suffix);
+	size_t avail = size - suffix_len;
+
+	int n = snprintf(buf, avail, "%02d:%02d:%02d.%03ld %s%s",
+		(int)(ts.tv_sec / 60 / 60), (int)(ts.tv_sec / 60 % 60),
+		(int)(ts.tv_sec % 60), ts.tv_nsec / 1000000,
+		colors ? verbosity_colors[c] : verbosity_headers[c],
+		colors ? "" : " ");
+	size_t len = n > 0 ? (size_t)n : 0;
+	if (len < avail) {
+		n = vsnprintf(buf + len, avail - len, fmt, args);
+		len += n > 0 ? (size_t)n : 0;
+	}
+	if (len >= avail) {
+		len = avail - 1;
+	}
+
+	memcpy(buf + len, suffix, suffix_len);
+	return len + suffix_len;
+}
+
+static bool async_enqueue(struct async_ring *ring, const char *data, size_t len) {
+	size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+	struct async_slot *slot;
+	while (true) {
+		slot = &ring->slots[pos % ASYNC_RING_LEN];
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos,
+					&pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				break;
+			}
+		} else if (diff < 0) {
+			return false; // full
+		} else {
+			pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+		}
+	}
+
+	memcpy(slot->data, data, len);
+	slot->len = len;
+	atomic_store_explicit(&slot->seq, pos + 1, memory_order_release);
+	return true;
+}
+
+static struct async_slot *async_dequeue_begin(struct async_ring *ring,
+		size_t *pos_ptr) {
+	size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+	while (true) {
+		struct async_slot *slot = &ring->slots[pos % ASYNC_RING_LEN];
+		size_t seq = atomic_load_explicit(&slot->seq, memory_order_acquire);
+		intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&ring->dequeue_pos,
+					&pos, pos + 1, memory_order_relaxed, memory_order_relaxed)) {
+				*pos_ptr = pos;
+				return slot;
+			}
+		} else if (diff < 0) {
+			return NULL; // empty
+		} else {
+			pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+		}
+	}
+}
+
+static void async_dequeue_end(struct async_slot *slot, size_t pos) {
+	atomic_store_explicit(&slot->seq, pos + ASYNC_RING_LEN, memory_order_release);
+}
+
+static void write_all(const char *data, size_t len) {
+	while (len > 0) {
+		ssize_t n = write(STDERR_FILENO, data, len);
+		if (n < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+			return;
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+static void write_dropped(uint64_t dropped) {
+	// snprintf() isn't async-signal-safe
+	char buf[64];
+	size_t i = sizeof(buf);
+	static const char suffix[] = " log messages dropped]\n";
+	i -= sizeof(suffix) - 1;
+	memcpy(buf + i, suffix, sizeof(suffix) - 1);
+	do {
+		buf[--i] = '0' + dropped % 10;
+		dropped /= 10;
+	} while (dropped > 0);
+	buf[--i] = '[';
+	write_all(buf + i, sizeof(buf) - i);
+}
+
+/**
+ * Write out all queued messages. Only uses async-signal-safe functions.
+ *
+ * If wait is false and another thread is already writing, messages are
+ * written concurrently rather than waiting for it: this is used on crash,
+ * where the other thread may never finish.
+ */
+static void async_drain(struct async_ring *ring, bool wait) {
+	char buf[ASYNC_WRITE_SIZE];
+	size_t len = 0;
+
+	bool locked;
+	while (!(locked = !atomic_flag_test_and_set_explicit(&ring->write_lock,
+			memory_order_acquire)) && wait) {
+		// Another thread is flushing, wait for it to finish
+	}
+
+	uint_fast64_t dropped = atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+	uint_fast64_t reported = atomic_load_explicit(&ring->dropped_reported,
+		memory_order_relaxed);
+	if (dropped != reported && atomic_compare_exchange_strong_explicit(
+			&ring->dropped_reported, &reported, dropped,
+			memory_order_relaxed, memory_order_relaxed)) {
+		write_dropped(dropped - reported);
+	}
+
+	struct async_slot *slot;
+	size_t pos;
+	while ((slot = async_dequeue_begin(ring, &pos)) != NULL) {
+		if (len + slot->len > sizeof(buf)) {
+			write_all(buf, len);
+			len = 0;
+		}
+		memcpy(buf + len, slot->data, slot->len);
+		len += slot->len;
+		async_dequeue_end(slot, pos);
+	}
+	write_all(buf, len);
+
+	if (locked) {
+		atomic_flag_clear_explicit(&ring->write_lock, memory_order_release);
+	}
+}
+
+static bool async_empty(struct async_ring *ring) {
+	size_t pos = atomic_load_explicit(&ring->dequeue_pos, memory_order_relaxed);
+	struct async_slot *slot = &ring->slots[pos % ASYNC_RING_LEN];
+	return atomic_load_explicit(&slot->seq, memory_order_acquire) != pos + 1;
+}
+
+static void *async_writer_run(void *data) {
+	struct async_ring *ring = data;
+	while (true) {
+		async_drain(ring, true);
+
+		// Only sleep if no message was queued after the drain, the fences
+		// pair with the one in wlr_log_async_stderr()
+		atomic_store(&ring->writer_sleeping, true);
+		atomic_thread_fence(memory_order_seq_cst);
+		if (!async_empty(ring)) {
+			atomic_store(&ring->writer_sleeping, false);
+			continue;
+		}
+		while (sem_wait(&ring->sem) != 0 && errno == EINTR) {
+			// Retry
+		}
+	}
+	return NULL;
+}
+
+static void async_flush_at_exit(void) {
+	// Wait for the writer: it may have taken messages off the ring without
+	// having written them yet
+	struct async_ring *ring = async_ring;
+	if (ring != NULL) {
+		async_drain(ring, true);
+	}
+}
+
+static void async_init(void) {
+	struct async_ring *ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		return;
+	}
+	for (size_t i = 0; i < ASYNC_RING_LEN; i++) {
+		atomic_init(&ring->slots[i].seq, i);
+	}
+	ring->colors = use_colors();
+	atomic_init(&ring->dropped_reported, 0);
+	atomic_init(&ring->writer_sleeping, false);
+	atomic_flag_clear(&ring->write_lock);
+	if (sem_init(&ring->sem, 0, 0) != 0) {
+		free(ring);
+		return;
+	}
+
+	// Signals should be handled by the compositor's own threads
+	sigset_t mask, prev_mask;
+	sigfillset(&mask);
+	pthread_sigmask(SIG_SETMASK, &mask, &prev_mask);
+	pthread_t thread;
+	int ret = pthread_create(&thread, NULL, async_writer_run, ring);
+	pthread_sigmask(SIG_SETMASK, &prev_mask, NULL);
+	if (ret != 0) {
+		sem_destroy(&ring->sem);
+		free(ring);
+		return;
+	}
+	pthread_detach(thread);
+
+	async_ring = ring;
+	atexit(async_flush_at_exit);
+}
+
+void wlr_log_async_stderr(enum wlr_log_importance verbosity, const char *fmt,
+		va_list args) {
+	init_start_time();
+
+	if (verbosity > log_importance) {
+		return;
+	}
+
+	pthread_once(&async_once, async_init);
+	struct async_ring *ring = async_ring;
+	if (ring == NULL) {
+		log_stderr(verbosity, fmt, args);
+		return;
+	}
+
+	static _Thread_local char buf[ASYNC_MSG_SIZE];
+	size_t len = async_format(ring, buf, sizeof(buf), verbosity, fmt, args);
+	if (!async_enqueue(ring, buf, len)) {
+		atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+		return;
+	}
+
+	// Only wake up the writer if it's waiting, to avoid a syscall per message
+	atomic_thread_fence(memory_order_seq_cst);
+	if (atomic_exchange(&ring->writer_sleeping, false)) {
+		sem_post(&ring->sem);
+	}
+}
+
+void wlr_log_async_flush(void) {
+	struct async_ring *ring = async_ring;
+	if (ring != NULL) {
+		async_drain(ring, false);
+	}
+}
+
+uint64_t wlr_log_async_get_dropped(void) {
+	struct async_ring *ring = async_ring;
+	if (ring == NULL) {
+		return 0;
+	}
+	return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
+
 static wlr_log_func_t log_callback = log_stderr;
 
 static void log_wl(const char *fmt, va_list args) {
@@ -0,0 +1,264 @@
+#include <assert.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <wlr/util/log.h>
+#include "util/sched.h"
+#include "util/time.h"
+
+// Time a dispatch may spend before background tasks are deferred
+#define SCHED_BACKGROUND_BUDGET_NSEC (2 * 1000 * 1000)
+// Delay of deferred background tasks, in milliseconds
+#define SCHED_BACKGROUND_DEFER_MSEC 1
+
+static const char *const class_names[SCHED_CLASS_COUNT] = {
+	[SCHED_CLASS_FRAME] = "frame",
+	[SCHED_CLASS_INPUT] = "input",
+	[SCHED_CLASS_PROTOCOL] = "protocol",
+	[SCHED_CLASS_BACKGROUND] = "background",
+};
+
+struct sched {
+	struct wl_event_loop *loop;
+	struct wl_event_source *idle; // NULL if no dispatch is pending
+	struct wl_event_source *timer;
+
+	struct wl_list queues[SCHED_CLASS_COUNT]; // sched_task.link
+	struct sched_class_stats stats[SCHED_CLASS_COUNT];
+
+	// Incremented on each dispatch, tasks posted during a dispatch wait for
+	// the next one
+	uint32_t serial;
+
+	struct wl_listener loop_destroy;
+};
+
+struct sched_task {
+	struct wl_list link; // sched.queues
+	enum sched_class class;
+	int64_t post_nsec, deadline_nsec;
+	uint32_t serial;
+
+	sched_func_t func;
+	void *data;
+};
+
+static void handle_loop_destroy(struct wl_listener *listener, void *data) {
+	struct sched *sched = wl_container_of(listener, sched, loop_destroy);
+
+	for (size_t i = 0; i < SCHED_CLASS_COUNT; i++) {
+		const struct sched_class_stats *stats = &sched->stats[i];
+		if (stats->tasks == 0) {
+			continue;
+		}
+		wlr_log(WLR_DEBUG, "Scheduler %s tasks: %"PRIu64" run, "
+			"%"PRIu64" late, latency avg %"PRId64"us max %"PRId64"us",
+			class_names[i], stats->tasks, stats->deadline_misses,
+			stats->total_latency_nsec / (int64_t)stats->tasks / 1000,
+			stats->max_latency_nsec / 1000);
+
+		struct sched_task *task, *tmp;
+		wl_list_for_each_safe(task, tmp, &sched->queues[i], link) {
+			wl_list_remove(&task->link);
+			free(task);
+		}
+	}
+
+	if (sched->idle != NULL) {
+		wl_event_source_remove(sched->idle);
+	}
+	wl_event_source_remove(sched->timer);
+	wl_list_remove(&sched->loop_destroy.link);
+	free(sched);
+}
+
+static void handle_idle(void *data);
+
+static int handle_timer(void *data) {
+	struct sched *sched = data;
+	if (sched->idle == NULL) {
+		sched->idle = wl_event_loop_add_idle(sched->loop, handle_idle, sched);
+	}
+	return 0;
+}
+
+static struct sched *sched_get(struct wl_event_loop *loop, bool create) {
+	struct wl_listener *listener =
+		wl_event_loop_get_destroy_listener(loop, handle_loop_destroy);
+	if (listener != NULL) {
+		struct sched *sched = wl_container_of(listener, sched, loop_destroy);
+		return sched;
+	}
+	if (!create) {
+		return NULL;
+	}
+
+	struct sched *sched = calloc(1, sizeof(*sched));
+	if (sched == NULL) {
+		return NULL;
+	}
+
+	sched->timer = wl_event_loop_add_timer(loop, handle_timer, sched);
+	if (sched->timer == NULL) {
+		free(sched);
+		return NULL;
+	}
+
+	sched->loop = loop;
+	for (size_t i = 0; i < SCHED_CLASS_COUNT; i++) {
+		wl_list_init(&sched->queues[i]);
+	}
+	sched->loop_destroy.notify = handle_loop_destroy;
+	wl_event_loop_add_destroy_listener(loop, &sched->loop_destroy);
+	return sched;
+}
+
+static int64_t task_sort_key(const struct sched_task *task) {
+	return task->deadline_nsec != 0 ? task->deadline_nsec : INT64_MAX;
+}
+
+/**
+ * Get the first task of a class which was posted before the current dispatch.
+ */
+static struct sched_task *queue_first(struct sched *sched,
+		enum sched_class class) {
+	struct sched_task *task;
+	wl_list_for_each(task, &sched->queues[class], link) {
+		if (task->serial != sched->serial) {
+			return task;
+		}
+	}
+	return NULL;
+}
+
+static struct sched_task *sched_next(struct sched *sched, int64_t start,
+		int64_t now) {
+	struct sched_task *task = queue_first(sched, SCHED_CLASS_FRAME);
+	if (task != NULL) {
+		return task;
+	}
+
+	struct sched_task *expired = NULL;
+	for (size_t i = SCHED_CLASS_FRAME + 1; i < SCHED_CLASS_COUNT; i++) {
+		task = queue_first(sched, i);
+		if (task != NULL && task->deadline_nsec != 0 &&
+				task->deadline_nsec <= now &&
+				(expired == NULL || task->deadline_nsec < expired->deadline_nsec)) {
+			expired = task;
+		}
+	}
+	if (expired != NULL) {
+		return expired;
+	}
+
+	task = queue_first(sched, SCHED_CLASS_INPUT);
+	if (task == NULL) {
+		task = queue_first(sched, SCHED_CLASS_PROTOCOL);
+	}
+	if (task != NULL) {
+		return task;
+	}
+
+	task = queue_first(sched, SCHED_CLASS_BACKGROUND);
+	if (task != NULL && now - start > SCHED_BACKGROUND_BUDGET_NSEC) {
+		wl_event_source_timer_update(sched->timer, SCHED_BACKGROUND_DEFER_MSEC);
+		return NULL;
+	}
+	return task;
+}
+
+static void handle_idle(void *data) {
+	struct sched *sched = data;
+	sched->idle = NULL;
+	sched->serial++;
+
+	int64_t start = get_current_time_nsec();
+	int64_t now = start;
+	struct sched_task *task;
+	while ((task = sched_next(sched, start, now)) != NULL) {
+		struct sched_class_stats *stats = &sched->stats[task->class];
+		int64_t latency = now - task->post_nsec;
+		stats->tasks++;
+		stats->total_latency_nsec += latency;
+		if (latency > stats->max_latency_nsec) {
+			stats->max_latency_nsec = latency;
+		}
+		if (task->deadline_nsec != 0 && now > task->deadline_nsec) {
+			stats->deadline_misses++;
+		}
+
+		// The callback may post and cancel tasks, including this one's owner
+		// re-posting itself
+		sched_func_t func = task->func;
+		void *task_data = task->data;
+		wl_list_remove(&task->link);
+		free(task);
+		func(task_data);
+
+		now = get_current_time_nsec();
+	}
+}
+
+struct sched_task *sched_post(struct wl_event_loop *loop,
+		enum sched_class class, int64_t deadline_nsec,
+		sched_func_t func, void *data) {
+	assert(class < SCHED_CLASS_COUNT);
+
+	struct sched *sched = sched_get(loop, true);
+	if (sched == NULL) {
+		return NULL;
+	}
+
+	struct sched_task *task = calloc(1, sizeof(*task));
+	if (task == NULL) {
+		return NULL;
+	}
+
+	if (sched->idle == NULL) {
+		sched->idle = wl_event_loop_add_idle(loop, handle_idle, sched);
+		if (sched->idle == NULL) {
+			free(task);
+			return NULL;
+		}
+	}
+
+	*task = (struct sched_task){
+		.class = class,
+		.post_nsec = get_current_time_nsec(),
+		.deadline_nsec = deadline_nsec,
+		.serial = sched->serial,
+		.func = func,
+		.data = data,
+	};
+
+	// Keep the queue sorted by deadline, in posting order for equal ones
+	int64_t key = task_sort_key(task);
+	struct wl_list *queue = &sched->queues[class];
+	struct wl_list *pos = queue->prev;
+	while (pos != queue) {
+		struct sched_task *other = wl_container_of(pos, other, link);
+		if (task_sort_key(other) <= key) {
+			break;
+		}
+		pos = pos->prev;
+	}
+	wl_list_insert(pos, &task->link);
+
+	return task;
+}
+
+void sched_task_cancel(struct sched_task *task) {
+	wl_list_remove(&task->link);
+	free(task);
+}
+
+bool sched_get_stats(struct wl_event_loop *loop, enum sched_class class,
+		struct sched_class_stats *stats) {
+	assert(class < SCHED_CLASS_COUNT);
+
+	struct sched *sched = sched_get(loop, false);
+	if (sched == NULL) {
+		return false;
+	}
+	*stats = sched->stats[class];
+	return true;
+}
@@ -0,0 +1,152 @@
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <wlr/util/log.h>
+#include "util/time.h"
+#include "util/trace.h"
+
+// Number of events kept per thread, a power of two
+#define TRACE_RING_LEN (64 * 1024)
+
+static const char *const event_names[TRACE_EVENT_COUNT] = {
+	[TRACE_SURFACE_COMMIT] = "surface_commit",
+	[TRACE_SCENE_NODE_UPDATE] = "scene_node_update",
+	[TRACE_SCENE_RENDER_LIST] = "scene_render_list",
+	[TRACE_RENDER_PASS_BEGIN] = "render_pass_begin",
+	[TRACE_RENDER_PASS_SUBMIT] = "render_pass_submit",
+	[TRACE_RENDER_TEXTURE] = "render_texture",
+	[TRACE_RENDER_RECT] = "render_rect",
+	[TRACE_OUTPUT_FRAME] = "output_frame",
+	[TRACE_OUTPUT_COMMIT] = "output_commit",
+	[TRACE_OUTPUT_PRESENT] = "output_present",
+	[TRACE_DRM_PAGE_FLIP] = "drm_page_flip",
+	[TRACE_XWM_EVENT] = "xwm_event",
+	[TRACE_INPUT_DISPATCH] = "input_dispatch",
+};
+
+static const char phase_names[] = {
+	[TRACE_PHASE_BEGIN] = 'B',
+	[TRACE_PHASE_END] = 'E',
+	[TRACE_PHASE_INSTANT] = 'i',
+};
+
+struct trace_record {
+	int64_t time_nsec;
+	uint16_t event;
+	uint8_t phase;
+	uint32_t arg;
+};
+
+struct trace_ring {
+	struct trace_ring *next;
+	int tid; // sequential, in order of the thread's first event
+	atomic_size_t head; // number of events ever recorded
+	struct trace_record records[TRACE_RING_LEN];
+};
+
+atomic_int trace_state = -1;
+
+static char *trace_path = NULL;
+static pthread_once_t trace_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t rings_mutex = PTHREAD_MUTEX_INITIALIZER;
+static struct trace_ring *rings = NULL; // only grows, rings are never freed
+static int rings_len = 0;
+static _Thread_local struct trace_ring *thread_ring = NULL;
+
+static void trace_dump(void) {
+	FILE *f = fopen(trace_path, "w");
+	if (f == NULL) {
+		wlr_log_errno(WLR_ERROR, "Failed to open trace file %s", trace_path);
+		return;
+	}
+
+	pid_t pid = getpid();
+	size_t written = 0;
+
+	fprintf(f, "{\"traceEvents\":[");
+	pthread_mutex_lock(&rings_mutex);
+	for (struct trace_ring *ring = rings; ring != NULL; ring = ring->next) {
+		size_t head = atomic_load_explicit(&ring->head, memory_order_acquire);
+		size_t start = head > TRACE_RING_LEN ? head - TRACE_RING_LEN : 0;
+		for (size_t i = start; i < head; i++) {
+			const struct trace_record *rec = &ring->records[i % TRACE_RING_LEN];
+			fprintf(f, "%s\n{\"name\":\"%s\",\"ph\":\"%c\",\"ts\":%"PRId64".%03d,"
+				"\"pid\":%d,\"tid\":%d,\"args\":{\"arg\":%"PRIu32"}%s}",
+				written > 0 ? "," : "", event_names[rec->event],
+				phase_names[rec->phase], rec->time_nsec / 1000,
+				(int)(rec->time_nsec % 1000), (int)pid, ring->tid,
+				rec->arg, rec->phase == TRACE_PHASE_INSTANT ? ",\"s\":\"t\"" : "");
+			written++;
+		}
+	}
+	pthread_mutex_unlock(&rings_mutex);
+	fprintf(f, "\n]}\n");
+
+	if (fclose(f) != 0) {
+		wlr_log_errno(WLR_ERROR, "Failed to write trace file %s", trace_path);
+		return;
+	}
+	wlr_log(WLR_INFO, "Wrote %zu trace events to %s", written, trace_path);
+}
+
+static void trace_init(void) {
+	const char *path = getenv("WLR_TRACE");
+	if (path == NULL || path[0] == '\0') {
+		atomic_store(&trace_state, 0);
+		return;
+	}
+
+	trace_path = strdup(path);
+	if (trace_path == NULL || atexit(trace_dump) != 0) {
+		wlr_log(WLR_ERROR, "Failed to enable tracing");
+		atomic_store(&trace_state, 0);
+		return;
+	}
+
+	wlr_log(WLR_INFO, "Tracing enabled, writing events to %s at exit", trace_path);
+	atomic_store(&trace_state, 1);
+}
+
+static struct trace_ring *trace_ring_get(void) {
+	if (thread_ring != NULL) {
+		return thread_ring;
+	}
+
+	struct trace_ring *ring = calloc(1, sizeof(*ring));
+	if (ring == NULL) {
+		return NULL;
+	}
+
+	pthread_mutex_lock(&rings_mutex);
+	ring->tid = ++rings_len;
+	ring->next = rings;
+	rings = ring;
+	pthread_mutex_unlock(&rings_mutex);
+
+	thread_ring = ring;
+	return ring;
+}
+
+void trace_record(enum trace_event event, enum trace_phase phase, uint32_t arg) {
+	pthread_once(&trace_once, trace_init);
+	if (atomic_load_explicit(&trace_state, memory_order_relaxed) != 1) {
+		return;
+	}
+
+	struct trace_ring *ring = trace_ring_get();
+	if (ring == NULL) {
+		return;
+	}
+
+	size_t head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+	ring->records[head % TRACE_RING_LEN] = (struct trace_record){
+		.time_nsec = get_current_time_nsec(),
+		.event = event,
+		.phase = phase,
+		.arg = arg,
+	};
+	atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+}
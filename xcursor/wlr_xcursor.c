@@ -23,6 +23,7 @@
  * SOFTWARE.
  */
 
+#include <assert.h>
 #include <drm_fourcc.h>
 #include <inttypes.h>
 #include <stdio.h>
@@ -36,6 +37,12 @@
 #include "xcursor/cursor_data.h"
 
 static void xcursor_destroy(struct wlr_xcursor *cursor) {
+	// Cursors may be shared between themes loaded together
+	assert(cursor->n_refs > 0);
+	if (--cursor->n_refs > 0) {
+		return;
+	}
+
 	for (size_t i = 0; i < cursor->image_count; i++) {
 		readonly_data_buffer_drop(cursor->images[i]->readonly_buffer);
 		free(cursor->images[i]->buffer);
@@ -91,6 +98,7 @@ static struct wlr_xcursor *xcursor_create_from_data(
 		return NULL;
 	}
 
+	cursor->n_refs = 1;
 	cursor->image_count = 1;
 	cursor->images = calloc(1, sizeof(*cursor->images));
 	if (!cursor->images) {
@@ -152,6 +160,8 @@ static struct wlr_xcursor *xcursor_create_from_xcursor_images(
 		return NULL;
 	}
 
+	cursor->n_refs = 1;
+
 	cursor->name = strdup(images->name);
 	cursor->total_delay = 0;
 
@@ -181,63 +191,121 @@ static struct wlr_xcursor *xcursor_create_from_xcursor_images(
 static struct wlr_xcursor *xcursor_theme_get_cursor(struct wlr_xcursor_theme *theme,
 	const char *name);
 
-static void load_callback(struct xcursor_images *images, void *data) {
-	struct wlr_xcursor_theme *theme = data;
-
-	if (xcursor_theme_get_cursor(theme, images->name)) {
-		xcursor_images_destroy(images);
-		return;
+static bool theme_add_cursor(struct wlr_xcursor_theme *theme,
+		struct wlr_xcursor *cursor) {
+	struct wlr_xcursor **cursors = realloc(theme->cursors,
+		(theme->cursor_count + 1) * sizeof(theme->cursors[0]));
+	if (cursors == NULL) {
+		return false;
 	}
+	theme->cursors = cursors;
+	theme->cursors[theme->cursor_count++] = cursor;
+	return true;
+}
 
-	struct wlr_xcursor *cursor = xcursor_create_from_xcursor_images(images, theme);
-	if (cursor) {
-		theme->cursor_count++;
-		struct wlr_xcursor **cursors = realloc(theme->cursors,
-			theme->cursor_count * sizeof(theme->cursors[0]));
-		if (cursors == NULL) {
-			theme->cursor_count--;
-			xcursor_destroy(cursor);
-		} else {
-			theme->cursors = cursors;
-			theme->cursors[theme->cursor_count - 1] = cursor;
+struct load_context {
+	struct wlr_xcursor_theme **themes;
+	struct wlr_xcursor **cursors; // cursors created by the current callback
+	size_t themes_len;
+};
+
+static void load_callback(struct xcursor_images **images, void *data) {
+	struct load_context *ctx = data;
+
+	for (size_t i = 0; i < ctx->themes_len; i++) {
+		struct wlr_xcursor_theme *theme = ctx->themes[i];
+		ctx->cursors[i] = NULL;
+		if (images[i] == NULL ||
+				xcursor_theme_get_cursor(theme, images[i]->name)) {
+			continue;
 		}
-	}
 
-	xcursor_images_destroy(images);
-}
+		// Themes whose size resolved to the same images in this file share
+		// the cursor
+		struct wlr_xcursor *cursor = NULL;
+		for (size_t j = 0; j < i; j++) {
+			if (images[j] == images[i] && ctx->cursors[j] != NULL) {
+				cursor = ctx->cursors[j];
+				cursor->n_refs++;
+				break;
+			}
+		}
+		if (cursor == NULL) {
+			cursor = xcursor_create_from_xcursor_images(images[i], theme);
+		}
+		if (cursor == NULL) {
+			continue;
+		}
 
-struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
-	struct wlr_xcursor_theme *theme = calloc(1, sizeof(*theme));
-	if (!theme) {
-		return NULL;
+		if (!theme_add_cursor(theme, cursor)) {
+			xcursor_destroy(cursor);
+			continue;
+		}
+		ctx->cursors[i] = cursor;
 	}
+}
 
+bool wlr_xcursor_theme_load_sizes(const char *name, const int *sizes,
+		size_t sizes_len, struct wlr_xcursor_theme **themes) {
 	if (!name) {
 		name = "default";
 	}
 
-	theme->name = strdup(name);
-	if (!theme->name) {
-		goto out_error_name;
+	struct wlr_xcursor **cursors = calloc(sizes_len, sizeof(*cursors));
+	if (cursors == NULL) {
+		return false;
 	}
-	theme->size = size;
-	theme->cursor_count = 0;
-	theme->cursors = NULL;
 
-	xcursor_load_theme(name, size, load_callback, theme);
+	size_t i;
+	for (i = 0; i < sizes_len; i++) {
+		struct wlr_xcursor_theme *theme = calloc(1, sizeof(*theme));
+		if (theme == NULL) {
+			goto error;
+		}
+		themes[i] = theme;
 
-	if (theme->cursor_count == 0) {
-		load_default_theme(theme);
+		theme->name = strdup(name);
+		if (theme->name == NULL) {
+			i++;
+			goto error;
+		}
+		theme->size = sizes[i];
 	}
 
-	wlr_log(WLR_DEBUG, "Loaded cursor theme '%s' at size %d (%d available cursors)",
-			theme->name, size, theme->cursor_count);
+	struct load_context ctx = {
+		.themes = themes,
+		.cursors = cursors,
+		.themes_len = sizes_len,
+	};
+	xcursor_load_theme(name, sizes, sizes_len, load_callback, &ctx);
+	free(cursors);
+
+	for (i = 0; i < sizes_len; i++) {
+		struct wlr_xcursor_theme *theme = themes[i];
+		if (theme->cursor_count == 0) {
+			load_default_theme(theme);
+		}
 
-	return theme;
+		wlr_log(WLR_DEBUG, "Loaded cursor theme '%s' at size %d (%d available cursors)",
+				theme->name, theme->size, theme->cursor_count);
+	}
 
-out_error_name:
-	free(theme);
-	return NULL;
+	return true;
+
+error:
+	while (i-- > 0) {
+		wlr_xcursor_theme_destroy(themes[i]);
+	}
+	free(cursors);
+	return false;
+}
+
+struct wlr_xcursor_theme *wlr_xcursor_theme_load(const char *name, int size) {
+	struct wlr_xcursor_theme *theme;
+	if (!wlr_xcursor_theme_load_sizes(name, &size, 1, &theme)) {
+		return NULL;
+	}
+	return theme;
 }
 
 void wlr_xcursor_theme_destroy(struct wlr_xcursor_theme *theme) {
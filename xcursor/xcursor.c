@@ -426,43 +426,36 @@ xcursor_read_image(FILE *file,
 	image->xhot = head.xhot;
 	image->yhot = head.yhot;
 	image->delay = head.delay;
+	/* Read all pixels at once, then convert them from little-endian */
 	n = image->width * image->height;
+	if (fread(image->pixels, sizeof(uint32_t), n, file) != (size_t) n) {
+		xcursor_image_destroy(image);
+		return NULL;
+	}
 	p = image->pixels;
 	while (n--) {
-		if (!xcursor_read_uint(file, p)) {
-			xcursor_image_destroy(image);
-			return NULL;
-		}
+		const unsigned char *bytes = (const unsigned char *) p;
+		*p = ((uint32_t)(bytes[0]) << 0) |
+			 ((uint32_t)(bytes[1]) << 8) |
+			 ((uint32_t)(bytes[2]) << 16) |
+			 ((uint32_t)(bytes[3]) << 24);
 		p++;
 	}
 	return image;
 }
 
 static struct xcursor_images *
-xcursor_xc_file_load_images(FILE *file, int size)
+xcursor_xc_file_read_images(FILE *file,
+			    struct xcursor_file_header *file_header,
+			    uint32_t best_size, int nsize)
 {
-	struct xcursor_file_header *file_header;
-	uint32_t best_size;
-	int nsize;
 	struct xcursor_images *images;
 	int n;
 	int toc;
 
-	if (!file || size < 0)
-		return NULL;
-	file_header = xcursor_read_file_header(file);
-	if (!file_header)
-		return NULL;
-	best_size = xcursor_file_best_size(file_header, (uint32_t) size, &nsize);
-	if (!best_size) {
-		xcursor_file_header_destroy(file_header);
-		return NULL;
-	}
 	images = xcursor_images_create(nsize);
-	if (!images) {
-		xcursor_file_header_destroy(file_header);
+	if (!images)
 		return NULL;
-	}
 	for (n = 0; n < nsize; n++) {
 		toc = xcursor_find_image_toc(file_header, best_size, n);
 		if (toc < 0)
@@ -473,7 +466,6 @@ xcursor_xc_file_load_images(FILE *file, int size)
 			break;
 		images->nimage++;
 	}
-	xcursor_file_header_destroy(file_header);
 	if (images->nimage != nsize) {
 		xcursor_images_destroy(images);
 		images = NULL;
@@ -481,6 +473,57 @@ xcursor_xc_file_load_images(FILE *file, int size)
 	return images;
 }
 
+/*
+ * Load the images closest to each of the requested sizes. The file is only
+ * read once, and sizes which resolve to the same nominal size in the file
+ * share the same struct xcursor_images. Returns false if nothing was loaded.
+ */
+static bool
+xcursor_xc_file_load_images(FILE *file, const int *sizes, size_t nsizes,
+			    struct xcursor_images **images)
+{
+	struct xcursor_file_header *file_header;
+	uint32_t best_size;
+	int nsize, nsize_other;
+	size_t i, j;
+	bool loaded = false;
+
+	for (i = 0; i < nsizes; i++)
+		images[i] = NULL;
+
+	if (!file)
+		return false;
+	file_header = xcursor_read_file_header(file);
+	if (!file_header)
+		return false;
+	for (i = 0; i < nsizes; i++) {
+		if (sizes[i] < 0)
+			continue;
+		best_size = xcursor_file_best_size(file_header,
+						   (uint32_t) sizes[i], &nsize);
+		if (!best_size)
+			continue;
+
+		/* Looking the best size up again is cheaper than reading the
+		 * images twice */
+		for (j = 0; j < i; j++) {
+			if (sizes[j] >= 0 &&
+			    xcursor_file_best_size(file_header, (uint32_t) sizes[j],
+						   &nsize_other) == best_size) {
+				images[i] = images[j];
+				break;
+			}
+		}
+		if (j == i)
+			images[i] = xcursor_xc_file_read_images(file, file_header,
+								best_size, nsize);
+		if (images[i])
+			loaded = true;
+	}
+	xcursor_file_header_destroy(file_header);
+	return loaded;
+}
+
 /*
  * From libXcursor/src/library.c
  */
@@ -678,18 +721,25 @@ xcursor_theme_inherits(const char *full)
 }
 
 static void
-load_all_cursors_from_dir(const char *path, int size,
-			  void (*load_callback)(struct xcursor_images *, void *),
+load_all_cursors_from_dir(const char *path, const int *sizes, size_t nsizes,
+			  xcursor_load_callback_t load_callback,
 			  void *user_data)
 {
 	FILE *f;
-	DIR *dir = opendir(path);
+	DIR *dir;
 	struct dirent *ent;
 	char *full;
-	struct xcursor_images *images;
+	struct xcursor_images **images;
+	size_t i, j;
 
-	if (!dir)
+	images = calloc(nsizes, sizeof(*images));
+	if (!images)
 		return;
+	dir = opendir(path);
+	if (!dir) {
+		free(images);
+		return;
+	}
 
 	for (ent = readdir(dir); ent; ent = readdir(dir)) {
 #ifdef _DIRENT_HAVE_D_TYPE
@@ -709,11 +759,22 @@ load_all_cursors_from_dir(const char *path, int size,
 			continue;
 		}
 
-		images = xcursor_xc_file_load_images(f, size);
+		if (xcursor_xc_file_load_images(f, sizes, nsizes, images)) {
+			for (i = 0; i < nsizes; i++) {
+				if (images[i] && !images[i]->name)
+					images[i]->name = strdup(ent->d_name);
+			}
 
-		if (images) {
-			images->name = strdup(ent->d_name);
 			load_callback(images, user_data);
+
+			for (i = 0; i < nsizes; i++) {
+				for (j = 0; j < i; j++) {
+					if (images[j] == images[i])
+						break;
+				}
+				if (j == i)
+					xcursor_images_destroy(images[i]);
+			}
 		}
 
 		fclose(f);
@@ -721,6 +782,7 @@ load_all_cursors_from_dir(const char *path, int size,
 	}
 
 	closedir(dir);
+	free(images);
 }
 
 struct xcursor_nodelist {
@@ -741,8 +803,8 @@ nodelist_contains(struct xcursor_nodelist *nodelist, const char *s, size_t ss) {
 
 static void
 xcursor_load_theme_protected(const char *theme,
-			     int size,
-			     void (*load_callback)(struct xcursor_images *, void *),
+			     const int *sizes, size_t nsizes,
+			     xcursor_load_callback_t load_callback,
 			     void *user_data,
 			     struct xcursor_nodelist *visited_nodes)
 {
@@ -771,8 +833,8 @@ xcursor_load_theme_protected(const char *theme,
 
 		full = xcursor_build_fullname(dir, "cursors", "");
 		if (full) {
-			load_all_cursors_from_dir(full, size, load_callback,
-						  user_data);
+			load_all_cursors_from_dir(full, sizes, nsizes,
+						  load_callback, user_data);
 			free(full);
 		}
 
@@ -789,7 +851,8 @@ xcursor_load_theme_protected(const char *theme,
 		si = strlen(i);
 		if (nodelist_contains(visited_nodes, i, si))
 			continue;
-		xcursor_load_theme_protected(i, size, load_callback, user_data, visited_nodes);
+		xcursor_load_theme_protected(i, sizes, nsizes, load_callback,
+					     user_data, visited_nodes);
 	}
 
 	free(inherits);
@@ -799,25 +862,31 @@ xcursor_load_theme_protected(const char *theme,
 /** Load all the cursor of a theme
  *
  * This function loads all the cursor images of a given theme and its
- * inherited themes. Each cursor is loaded into an struct xcursor_images object
- * which is passed to the caller's load callback. If a cursor appears
- * more than once across all the inherited themes, the load callback
- * will be called multiple times, with possibly different struct xcursor_images
- * object which have the same name. The user is expected to destroy the
- * struct xcursor_images objects passed to the callback with
- * xcursor_images_destroy().
+ * inherited themes, at several sizes at once. Each cursor file is read once,
+ * and the images closest to each requested size are passed to the caller's
+ * load callback as an array of struct xcursor_images objects, one per
+ * requested size. Entries are NULL for sizes which couldn't be loaded, and
+ * sizes which resolve to the same nominal size in the file share the same
+ * object. If a cursor appears more than once across all the inherited themes,
+ * the load callback will be called multiple times, with possibly different
+ * struct xcursor_images objects which have the same name. The objects are
+ * destroyed once the callback returns.
  *
  * \param theme The name of theme that should be loaded
- * \param size The desired size of the cursor images
+ * \param sizes The desired sizes of the cursor images
+ * \param nsizes The number of desired sizes
  * \param load_callback A callback function that will be called
- * for each cursor loaded. The first parameter is the struct xcursor_images
- * object representing the loaded cursor and the second is a pointer
- * to data provided by the user.
+ * for each cursor loaded. The first parameter is the array of struct
+ * xcursor_images objects representing the loaded cursor and the second is a
+ * pointer to data provided by the user.
  * \param user_data The data that should be passed to the load callback
  */
 void
-xcursor_load_theme(const char *theme, int size,
-		   void (*load_callback)(struct xcursor_images *, void *),
+xcursor_load_theme(const char *theme, const int *sizes, size_t nsizes,
+		   xcursor_load_callback_t load_callback,
 		   void *user_data) {
-	return xcursor_load_theme_protected(theme, size, load_callback, user_data, NULL);
+	if (nsizes == 0)
+		return;
+	xcursor_load_theme_protected(theme, sizes, nsizes, load_callback,
+				     user_data, NULL);
 }
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // for F_SETPIPE_SZ
 #include <assert.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -71,19 +72,26 @@ static int xwm_data_source_read(int fd, uint32_t mask, void *data) {
 	struct wlr_xwm_selection_transfer *transfer = data;
 	struct wlr_xwm *xwm = transfer->selection->xwm;
 
-	void *p;
+	// The buffer is kept across chunks, and grows up to the chunk size only
+	// if the data source has that much to send
+	size_t chunk_size = xwm->incr_chunk_size;
 	size_t current = transfer->source_data.size;
-	if (transfer->source_data.size < INCR_CHUNK_SIZE) {
-		p = wl_array_add(&transfer->source_data, INCR_CHUNK_SIZE);
-		if (p == NULL) {
+	if (current == transfer->source_data.alloc &&
+			transfer->source_data.alloc < chunk_size) {
+		size_t grow = current > 0 ? current : INCR_CHUNK_SIZE;
+		if (grow > chunk_size - current) {
+			grow = chunk_size - current;
+		}
+		if (wl_array_add(&transfer->source_data, grow) == NULL) {
 			wlr_log(WLR_ERROR, "Could not allocate selection source_data");
 			goto error_out;
 		}
-	} else {
-		p = (char *)transfer->source_data.data + transfer->source_data.size;
+		transfer->source_data.size = current;
 	}
 
-	size_t available = transfer->source_data.alloc - current;
+	void *p = (char *)transfer->source_data.data + current;
+	size_t alloc = transfer->source_data.alloc;
+	size_t available = (alloc < chunk_size ? alloc : chunk_size) - current;
 	ssize_t len = read(fd, p, available);
 	if (len == -1) {
 		wlr_log_errno(WLR_ERROR, "read error from data source");
@@ -94,12 +102,13 @@ static int xwm_data_source_read(int fd, uint32_t mask, void *data) {
 		available, mask);
 
 	transfer->source_data.size = current + len;
-	if (transfer->source_data.size >= INCR_CHUNK_SIZE) {
+	if (transfer->source_data.size >= chunk_size) {
 		if (!transfer->incr) {
 			wlr_log(WLR_DEBUG, "got %zu bytes, starting incr",
 				transfer->source_data.size);
 
-			size_t incr_chunk_size = INCR_CHUNK_SIZE;
+			// Lower bound on the total size of the selection, as per ICCCM
+			uint32_t incr_chunk_size = chunk_size;
 			xcb_change_property(xwm->xcb_conn,
 				XCB_PROP_MODE_REPLACE,
 				transfer->request.requestor,
@@ -290,6 +299,11 @@ static bool xwm_selection_send_data(struct wlr_xwm_selection *selection,
 	fcntl(p[0], F_SETFL, O_NONBLOCK);
 	fcntl(p[1], F_SETFD, FD_CLOEXEC);
 	fcntl(p[1], F_SETFL, O_NONBLOCK);
+#ifdef F_SETPIPE_SZ
+	// Let the source write a whole chunk before we need to wake up. This may
+	// fail past the per-user pipe size limit, which is fine.
+	fcntl(p[0], F_SETPIPE_SZ, (int)selection->xwm->incr_chunk_size);
+#endif
 
 	transfer->wl_client_fd = p[0];
 
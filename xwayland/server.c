@@ -1,6 +1,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -16,6 +17,7 @@
 #include <wlr/xwayland.h>
 #include "config.h"
 #include "sockets.h"
+#include "util/time.h"
 
 static void safe_close(int fd) {
 	if (fd >= 0) {
@@ -280,7 +282,9 @@ static int xserver_handle_ready(int fd, uint32_t mask, void *data) {
 		wlr_log(WLR_ERROR, "Xwayland startup failed, not setting up xwm");
 		goto error;
 	}
-	wlr_log(WLR_DEBUG, "Xserver is ready");
+	server->ready_nsec = get_current_time_nsec();
+	wlr_log(WLR_DEBUG, "Xserver is ready after %"PRId64" ms",
+		(server->ready_nsec - server->start_nsec) / 1000000);
 
 	close(fd);
 	wl_event_source_remove(server->pipe_source);
@@ -321,6 +325,9 @@ static bool server_start_display(struct wlr_xwayland_server *server,
 }
 
 static bool server_start(struct wlr_xwayland_server *server) {
+	server->start_nsec = get_current_time_nsec();
+	server->spawned_nsec = server->ready_nsec = 0;
+
 	if (socketpair(AF_UNIX, SOCK_STREAM, 0, server->wl_fd) != 0) {
 		wlr_log_errno(WLR_ERROR, "socketpair failed");
 		server_finish_process(server);
@@ -406,18 +413,34 @@ static bool server_start(struct wlr_xwayland_server *server) {
 	safe_close(server->wm_fd[1]);
 	server->wl_fd[1] = server->wm_fd[1] = -1;
 
+	server->spawned_nsec = get_current_time_nsec();
+
 	return true;
 }
 
-static int xwayland_socket_connected(int fd, uint32_t mask, void *data) {
-	struct wlr_xwayland_server *server = data;
+static void server_start_now(struct wlr_xwayland_server *server) {
+	if (server->prespawn_timer != NULL) {
+		wl_event_source_remove(server->prespawn_timer);
+		server->prespawn_timer = NULL;
+	}
 
 	wl_event_source_remove(server->x_fd_read_event[0]);
 	wl_event_source_remove(server->x_fd_read_event[1]);
 	server->x_fd_read_event[0] = server->x_fd_read_event[1] = NULL;
 
 	server_start(server);
+}
+
+static int xwayland_socket_connected(int fd, uint32_t mask, void *data) {
+	struct wlr_xwayland_server *server = data;
+	server_start_now(server);
+	return 0;
+}
 
+static int handle_prespawn_timer(void *data) {
+	struct wlr_xwayland_server *server = data;
+	wlr_log(WLR_DEBUG, "Pre-spawning Xwayland");
+	server_start_now(server);
 	return 0;
 }
 
@@ -453,6 +476,9 @@ void wlr_xwayland_server_destroy(struct wlr_xwayland_server *server) {
 	if (server->idle_source != NULL) {
 		wl_event_source_remove(server->idle_source);
 	}
+	if (server->prespawn_timer != NULL) {
+		wl_event_source_remove(server->prespawn_timer);
+	}
 	server_finish_process(server);
 	server_finish_display(server);
 
@@ -501,6 +527,17 @@ struct wlr_xwayland_server *wlr_xwayland_server_create(
 		if (!server_start_lazy(server)) {
 			goto error_display;
 		}
+
+		if (server->options.prespawn_delay > 0) {
+			struct wl_event_loop *loop = wl_display_get_event_loop(wl_display);
+			server->prespawn_timer = wl_event_loop_add_timer(loop,
+				handle_prespawn_timer, server);
+			if (server->prespawn_timer == NULL) {
+				goto error_lazy;
+			}
+			wl_event_source_timer_update(server->prespawn_timer,
+				server->options.prespawn_delay);
+		}
 	} else {
 		struct wl_event_loop *loop = wl_display_get_event_loop(wl_display);
 		server->idle_source = wl_event_loop_add_idle(loop, handle_idle, server);
@@ -511,6 +548,8 @@ struct wlr_xwayland_server *wlr_xwayland_server_create(
 
 	return server;
 
+error_lazy:
+	server_finish_process(server);
 error_display:
 	server_finish_display(server);
 error_alloc:
@@ -1,5 +1,6 @@
 #include <assert.h>
 #include <fcntl.h>
+#include <inttypes.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdlib.h>
@@ -13,6 +14,7 @@
 #include <wlr/util/log.h>
 #include <wlr/xwayland/shell.h>
 #include <wlr/xwayland/xwayland.h>
+#include "util/time.h"
 #include "xwayland/xwm.h"
 
 static void handle_server_destroy(struct wl_listener *listener, void *data) {
@@ -32,15 +34,26 @@ static void handle_server_start(struct wl_listener *listener, void *data) {
 }
 
 static void xwayland_mark_ready(struct wlr_xwayland *xwayland) {
-	assert(xwayland->server->wm_fd[0] >= 0);
-	xwayland->xwm = xwm_create(xwayland, xwayland->server->wm_fd[0]);
+	struct wlr_xwayland_server *server = xwayland->server;
+	assert(server->wm_fd[0] >= 0);
+	xwayland->xwm = xwm_create(xwayland, server->wm_fd[0]);
 	// xwm_create takes ownership of wm_fd[0] under all circumstances
-	xwayland->server->wm_fd[0] = -1;
+	server->wm_fd[0] = -1;
 
 	if (!xwayland->xwm) {
 		return;
 	}
 
+	if (server->start_nsec != 0) {
+		int64_t now = get_current_time_nsec();
+		wlr_log(WLR_INFO, "Xwayland started in %"PRId64" ms "
+			"(spawn %"PRId64" ms, server init %"PRId64" ms, xwm init %"PRId64" ms)",
+			(now - server->start_nsec) / 1000000,
+			(server->spawned_nsec - server->start_nsec) / 1000000,
+			(server->ready_nsec - server->spawned_nsec) / 1000000,
+			(now - server->ready_nsec) / 1000000);
+	}
+
 	if (xwayland->seat) {
 		xwm_set_seat(xwayland->xwm, xwayland->seat);
 	}
@@ -16,6 +16,7 @@
 #include <xcb/render.h>
 #include <xcb/res.h>
 #include <xcb/xfixes.h>
+#include "util/trace.h"
 #include "xwayland/xwm.h"
 
 static const char *const atom_map[ATOM_LAST] = {
@@ -1997,6 +1998,9 @@ static int read_x11_events(struct wlr_xwm *xwm) {
 	while ((event = xcb_poll_for_event(xwm->xcb_conn))) {
 		count++;
 
+		TRACE_INSTANT(TRACE_XWM_EVENT,
+			event->response_type & XCB_EVENT_RESPONSE_TYPE_MASK);
+
 		if (xwm->xwayland->user_event_handler &&
 				xwm->xwayland->user_event_handler(xwm->xwayland, event)) {
 			free(event);
@@ -2283,10 +2287,37 @@ void xwm_destroy(struct wlr_xwm *xwm) {
 	free(xwm);
 }
 
+static void xwm_get_render_format(struct wlr_xwm *xwm,
+		xcb_render_query_pict_formats_reply_t *reply) {
+	xcb_render_pictforminfo_iterator_t iter =
+		xcb_render_query_pict_formats_formats_iterator(reply);
+	xcb_render_pictforminfo_t *format = NULL;
+	while (iter.rem > 0) {
+		if (iter.data->depth == 32) {
+			format = iter.data;
+			break;
+		}
+
+		xcb_render_pictforminfo_next(&iter);
+	}
+
+	if (format == NULL) {
+		wlr_log(WLR_DEBUG, "No 32 bit render format");
+		return;
+	}
+
+	xwm->render_format_id = format->id;
+}
+
 static void xwm_get_resources(struct wlr_xwm *xwm) {
+	// All requests are sent before waiting for any reply, so that this only
+	// takes two round-trips: one for the extension data, which the version
+	// queries depend on, and one for everything else.
 	xcb_prefetch_extension_data(xwm->xcb_conn, &xcb_xfixes_id);
 	xcb_prefetch_extension_data(xwm->xcb_conn, &xcb_composite_id);
 	xcb_prefetch_extension_data(xwm->xcb_conn, &xcb_res_id);
+	xcb_prefetch_extension_data(xwm->xcb_conn, &xcb_render_id);
+	xcb_prefetch_maximum_request_length(xwm->xcb_conn);
 
 	size_t i;
 	xcb_intern_atom_cookie_t cookies[ATOM_LAST];
@@ -2295,6 +2326,28 @@ static void xwm_get_resources(struct wlr_xwm *xwm) {
 		cookies[i] =
 			xcb_intern_atom(xwm->xcb_conn, 0, strlen(atom_map[i]), atom_map[i]);
 	}
+
+	xwm->xfixes = xcb_get_extension_data(xwm->xcb_conn, &xcb_xfixes_id);
+	if (!xwm->xfixes || !xwm->xfixes->present) {
+		wlr_log(WLR_DEBUG, "xfixes not available");
+	}
+
+	xcb_xfixes_query_version_cookie_t xfixes_cookie =
+		xcb_xfixes_query_version(xwm->xcb_conn, XCB_XFIXES_MAJOR_VERSION,
+			XCB_XFIXES_MINOR_VERSION);
+
+	const xcb_query_extension_reply_t *xres =
+		xcb_get_extension_data(xwm->xcb_conn, &xcb_res_id);
+	bool has_xres = xres && xres->present;
+	xcb_res_query_version_cookie_t xres_cookie = {0};
+	if (has_xres) {
+		xres_cookie = xcb_res_query_version(xwm->xcb_conn,
+			XCB_RES_MAJOR_VERSION, XCB_RES_MINOR_VERSION);
+	}
+
+	xcb_render_query_pict_formats_cookie_t render_cookie =
+		xcb_render_query_pict_formats(xwm->xcb_conn);
+
 	for (i = 0; i < ATOM_LAST; i++) {
 		xcb_generic_error_t *error;
 		xcb_intern_atom_reply_t *reply =
@@ -2308,52 +2361,53 @@ static void xwm_get_resources(struct wlr_xwm *xwm) {
 			wlr_log(WLR_ERROR, "could not resolve atom %s, x11 error code %d",
 				atom_map[i], error->error_code);
 			free(error);
-			return;
 		}
 	}
 
-	xwm->xfixes = xcb_get_extension_data(xwm->xcb_conn, &xcb_xfixes_id);
-
-	if (!xwm->xfixes || !xwm->xfixes->present) {
-		wlr_log(WLR_DEBUG, "xfixes not available");
-	}
-
-	xcb_xfixes_query_version_cookie_t xfixes_cookie;
-	xcb_xfixes_query_version_reply_t *xfixes_reply;
-	xfixes_cookie =
-		xcb_xfixes_query_version(xwm->xcb_conn, XCB_XFIXES_MAJOR_VERSION,
-			XCB_XFIXES_MINOR_VERSION);
-	xfixes_reply =
+	xcb_xfixes_query_version_reply_t *xfixes_reply =
 		xcb_xfixes_query_version_reply(xwm->xcb_conn, xfixes_cookie, NULL);
-
-	wlr_log(WLR_DEBUG, "xfixes version: %" PRIu32 ".%" PRIu32,
-		xfixes_reply->major_version, xfixes_reply->minor_version);
-	xwm->xfixes_major_version = xfixes_reply->major_version;
-
-	free(xfixes_reply);
-
-	const xcb_query_extension_reply_t *xres =
-		xcb_get_extension_data(xwm->xcb_conn, &xcb_res_id);
-	if (!xres || !xres->present) {
-		return;
+	if (xfixes_reply != NULL) {
+		wlr_log(WLR_DEBUG, "xfixes version: %" PRIu32 ".%" PRIu32,
+			xfixes_reply->major_version, xfixes_reply->minor_version);
+		xwm->xfixes_major_version = xfixes_reply->major_version;
+		free(xfixes_reply);
+	}
+
+	xcb_res_query_version_reply_t *xres_reply = NULL;
+	if (has_xres) {
+		xres_reply = xcb_res_query_version_reply(xwm->xcb_conn, xres_cookie, NULL);
+	}
+	if (xres_reply != NULL) {
+		wlr_log(WLR_DEBUG, "xres version: %" PRIu32 ".%" PRIu32,
+			xres_reply->server_major, xres_reply->server_minor);
+		if (xres_reply->server_major > 1 ||
+				(xres_reply->server_major == 1 && xres_reply->server_minor >= 2)) {
+			xwm->xres = xres;
+		}
+		free(xres_reply);
+	}
+
+	// The maximum request length is in 4-byte units, and includes the
+	// ChangeProperty request header
+	size_t max_request_size =
+		(size_t)xcb_get_maximum_request_length(xwm->xcb_conn) * 4;
+	xwm->incr_chunk_size = INCR_CHUNK_SIZE;
+	if (max_request_size > sizeof(xcb_change_property_request_t) + INCR_CHUNK_SIZE) {
+		xwm->incr_chunk_size = max_request_size - sizeof(xcb_change_property_request_t);
+		if (xwm->incr_chunk_size > INCR_MAX_CHUNK_SIZE) {
+			xwm->incr_chunk_size = INCR_MAX_CHUNK_SIZE;
+		}
 	}
+	wlr_log(WLR_DEBUG, "Selection INCR chunk size: %zu bytes", xwm->incr_chunk_size);
 
-	xcb_res_query_version_cookie_t xres_cookie =
-		xcb_res_query_version(xwm->xcb_conn, XCB_RES_MAJOR_VERSION,
-			XCB_RES_MINOR_VERSION);
-	xcb_res_query_version_reply_t *xres_reply =
-		xcb_res_query_version_reply(xwm->xcb_conn, xres_cookie, NULL);
-	if (xres_reply == NULL) {
+	xcb_render_query_pict_formats_reply_t *render_reply =
+		xcb_render_query_pict_formats_reply(xwm->xcb_conn, render_cookie, NULL);
+	if (render_reply == NULL) {
+		wlr_log(WLR_ERROR, "Did not get any reply from xcb_render_query_pict_formats");
 		return;
 	}
-
-	wlr_log(WLR_DEBUG, "xres version: %" PRIu32 ".%" PRIu32,
-		xres_reply->server_major, xres_reply->server_minor);
-	if (xres_reply->server_major > 1 ||
-			(xres_reply->server_major == 1 && xres_reply->server_minor >= 2)) {
-		xwm->xres = xres;
-	}
-	free(xres_reply);
+	xwm_get_render_format(xwm, render_reply);
+	free(render_reply);
 }
 
 static void xwm_create_wm_window(struct wlr_xwm *xwm) {
@@ -2464,37 +2518,6 @@ static void xwm_get_visual_and_colormap(struct wlr_xwm *xwm) {
 		xwm->visual_id);
 }
 
-static void xwm_get_render_format(struct wlr_xwm *xwm) {
-	xcb_render_query_pict_formats_cookie_t cookie =
-		xcb_render_query_pict_formats(xwm->xcb_conn);
-	xcb_render_query_pict_formats_reply_t *reply =
-		xcb_render_query_pict_formats_reply(xwm->xcb_conn, cookie, NULL);
-	if (!reply) {
-		wlr_log(WLR_ERROR, "Did not get any reply from xcb_render_query_pict_formats");
-		return;
-	}
-	xcb_render_pictforminfo_iterator_t iter =
-		xcb_render_query_pict_formats_formats_iterator(reply);
-	xcb_render_pictforminfo_t *format = NULL;
-	while (iter.rem > 0) {
-		if (iter.data->depth == 32) {
-			format = iter.data;
-			break;
-		}
-
-		xcb_render_pictforminfo_next(&iter);
-	}
-
-	if (format == NULL) {
-		wlr_log(WLR_DEBUG, "No 32 bit render format");
-		free(reply);
-		return;
-	}
-
-	xwm->render_format_id = format->id;
-	free(reply);
-}
-
 void xwm_set_cursor(struct wlr_xwm *xwm, struct wlr_buffer *buffer,
 		int32_t hotspot_x, int32_t hotspot_y) {
 	if (!xwm->render_format_id) {
@@ -2599,7 +2622,6 @@ struct wlr_xwm *xwm_create(struct wlr_xwayland *xwayland, int wm_fd) {
 
 	xwm_get_resources(xwm);
 	xwm_get_visual_and_colormap(xwm);
-	xwm_get_render_format(xwm);
 
 	uint32_t values[] = {
 		XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY |